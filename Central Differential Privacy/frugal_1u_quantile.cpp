@@ -14,6 +14,26 @@
 #include <math.h>
 #include <boost/random.hpp>
 #include <boost/random/laplace_distribution.hpp>
+#include "Bootstrap.h"
+#include "CsvImport.h"
+#include "DatasetCache.h"
+#include "Frugal.h"
+#include "GkSketch.h"
+#include "RadixSelect.h"
+#include "ReleaseSampler.h"
+#include "ItemBuffer.h"
+#include "ItemStorage.h"
+#include "OutOfCore.h"
+#include "ResultStore.h"
+#include "StreamInput.h"
+#include "StreamStats.h"
+#include "TruthCache.h"
+#include "Workload.h"
+
+// the columns of a row in a result store; rerr (l) follows with -G, then
+// BOOTSTRAP_HEADER with -B
+#define RESULT_HEADER RESULT_FRUGAL_1U_HEADER
+#define RESULT_TYPES RESULT_FRUGAL_1U_TYPES
 
 
 void usage(void) {
@@ -33,10 +53,51 @@ void usage(void) {
                   "default: depends on selected distribution\n");
   fprintf(stderr, "-s <seed> the seed to be used for pseudo-random number "
                   "generator default: 1234\n");
-  fprintf(stderr, "-f <filename>\n");
+  fprintf(stderr, "-f <filename> CSV file, or a .dpqr result store to append the row to\n");
+  fprintf(stderr, "-i <input stream> read items from a stream instead of generating them: "
+                  "- (stdin), a file or FIFO path, or unix:<socket path>\n");
+  fprintf(stderr, "-m <input format: text|binary|packed|csv> newline delimited values, raw float64, block-compressed items or a column of a CSV file default: text\n");
+  fprintf(stderr, "-c <column> CSV column (0-based index or header name) default: 0\n");
+  fprintf(stderr, "-C <directory> cache generated items in directory default: $DPQ_CACHE\n");
+  fprintf(stderr, "-O <directory> out of core: generate the items in segments and find the true quantiles by passes over them, "
+                  "with at most $DPQ_SCRATCH_MB (default 16384) MB of scratch files in directory\n");
+  fprintf(stderr, "-Q <q1,q2,...> also compute the true values of these quantiles and keep them in the cache\n");
+  fprintf(stderr, "-T <item storage: i32|i16> type the estimator reads the items as default: i32\n");
+  fprintf(stderr, "-N <items> print the current estimate every N input items\n");
+  fprintf(stderr, "-t <milliseconds> print the current estimate every t milliseconds\n");
+  fprintf(stderr, "-R also print a DP release with every estimate (each release spends the privacy budget)\n");
+  fprintf(stderr, "-G <epsilon> with -i, take the true quantile from a Greenwald-Khanna sketch run alongside the estimator, within epsilon * n ranks\n");
+  fprintf(stderr, "-M <samples> draw this many releases of each mechanism from the final estimate and report the "
+                  "quantiles of their error, without running the stream again\n");
+  fprintf(stderr, "-B <replicas> Poisson bootstrap: also run this many replicas of the estimator in the same pass, "
+                  "and report the spread and a 95%% interval of the (non-private) estimate default: 0\n");
 
 }
 
+// log where the len items come from, once per stream, and return the name of
+// the distribution
+const char *describe_items(long len, long dist, float param1, float param2,
+                           long seed, bool cached) {
+  if (cached)
+    fprintf(stderr, "loaded %ld cached items\n", len);
+  else
+    fprintf(stderr, "generated random %ld items\n", len);
+  if (dist_known(dist))
+    fprintf(stderr, "%s\n", dist_description(dist, param1, param2, seed).c_str());
+  return dist_name(dist);
+}
+
+// fill items with len values drawn from the selected distribution, scaled by
+// 1000 (Workload.h), and return the name of the distribution; if cached,
+// items already holds the values and only the name is returned
+const char *generate_items(int *items, long len, long dist, float param1,
+                           float param2, long seed, std::mt19937 &generator,
+                           bool cached) {
+  if (!cached)
+    central_generate(items, len, dist, param1, param2, generator);
+  return describe_items(len, dist, param1, param2, seed, cached);
+}
+
 int main(int argc, char **argv) {
 
   long seed = 1234;
@@ -44,16 +105,33 @@ int main(int argc, char **argv) {
   int *items = NULL;
   long len = 100000000;
   long dist = 1;
-  char *diststr = NULL;
+  const char *diststr = NULL;
   float param1, param2;
   char *filename = NULL;
   FILE *fptr = NULL;
-  int true_quantile;
+  int true_quantile = 0;
+  double reference_eps = 0.0; // rank error of the stream reference sketch, 0 if unused
+  long rank_error = 0;
+  int replicas = 0; // bootstrap replicas of the estimator
+  long release_samples = 0; // Monte Carlo releases of each mechanism
   int estimated_quantile = 0;
   float elapsed = 0.0;
   bool file_output = false;
   bool param1_default = true;
   bool param2_default = true;
+  char *source = NULL;
+  int format = STREAM_TEXT;
+  bool csv_input = false;
+  CsvOptions csv;
+  const char *cache_dir = NULL;
+  const char *scratch_dir = NULL;
+  const char *extra_quantiles = NULL;
+  bool cached = false;
+  int storage = STORE_I32;
+  int base = 0; // offset of i16 items
+  long every_items = 0;
+  long every_ms = 0;
+  bool emit_release = false;
 
   int sensitivity = 2; // this is the sensitivity of the frugal1u algorithm
   float epsilon = 0.1; // small values provide higher privacy, large values provide less privacy
@@ -62,7 +140,9 @@ int main(int argc, char **argv) {
 
   int opt;
 
-  while ((opt = getopt(argc, argv, ":n:q:e:p:r:d:a:b:s:f:h")) != -1) {
+  csv_options_init(&csv);
+
+  while ((opt = getopt(argc, argv, ":n:q:e:p:r:d:a:b:s:f:i:m:c:C:O:Q:G:T:N:t:B:M:Rh")) != -1) {
     switch (opt) {
     case 'n':
       len = strtol(optarg, NULL, 10);
@@ -102,6 +182,61 @@ int main(int argc, char **argv) {
       memcpy(filename, optarg, strlen(optarg));
       file_output = true;
       break;
+    case 'i':
+      source = optarg;
+      break;
+    case 'm':
+      csv_input = !strcmp(optarg, "csv");
+      format = csv_input ? STREAM_TEXT : stream_format(optarg);
+      if (format < 0) {
+        fprintf(stderr, "Unknown input format: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'c':
+      csv.column = optarg;
+      break;
+    case 'C':
+      cache_dir = optarg;
+      break;
+    case 'O':
+      scratch_dir = optarg;
+      break;
+    case 'Q':
+      extra_quantiles = optarg;
+      break;
+    case 'M':
+      release_samples = strtol(optarg, NULL, 10);
+      break;
+    case 'B':
+      replicas = strtol(optarg, NULL, 10);
+      break;
+    case 'G':
+      reference_eps = strtod(optarg, NULL);
+      if (!(reference_eps > 0.0 && reference_eps < 1.0)) {
+        fprintf(stderr, "Bad reference sketch rank error: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'T':
+      storage = storage_type(optarg);
+      if (storage != STORE_I32 && storage != STORE_I16) {
+        fprintf(stderr, "Unknown item storage: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'N':
+      every_items = strtol(optarg, NULL, 10);
+      break;
+    case 't':
+      every_ms = strtol(optarg, NULL, 10);
+      break;
+    case 'R':
+      emit_release = true;
+      break;
     case 'h':
       usage();
       exit(1);
@@ -119,336 +254,375 @@ int main(int argc, char **argv) {
     }
   }
 
-  /* allocate items */
-  items = (int *)calloc(len, sizeof(int));
-  if (!items) {
-    fprintf(stderr, "Not enough memory\n");
+  // set default parameter values depending on the distribution
+  central_dist_defaults(dist, &param1, &param2, param1_default, param2_default);
+
+  std::mt19937 generator(seed);
+  // with -B, replicas fed Poisson(1) resamples in the same pass (Bootstrap.h)
+  Bootstrapped<Frugal1U> frugal(Frugal1U(quantile, seed), replicas, bootstrap_seed(seed, 0),
+                                [&](int r) { return Frugal1U(quantile, bootstrap_seed(seed, r)); });
+
+  if (csv_input && !source) {
+    fprintf(stderr, "-m csv requires an input file (-i)\n");
     exit(1);
   }
-  // unsigned int	seed =
-  // std::chrono::steady_clock::now().time_since_epoch().count();
-
-  // set default parameter values depending on the distribution
-  switch (dist) {
-
-  case 1:
-    if (param1_default)
-      param1 = 50.0;
-    if (param2_default)
-      param2 = 2.0;
-    break;
-  case 2:
-    if (param1_default)
-      param1 = 10000.0;
-    if (param2_default)
-      param2 = 1250.0;
-    break;
-  case 3:
-    if (param1_default)
-      param1 = 0.0;
-    if (param2_default)
-      param2 = 1000.0;
-    break;
-  case 4:
-    if (param1_default)
-      param1 = 0.5;
-    if (param2_default)
-      param2 = -1.0; // not used
-    break;
-  case 5:
-    if (param1_default)
-      param1 = 5.0;
-    if (param2_default)
-      param2 = -1.0; // not used
-    break;
-  case 6:
-    if (param1_default)
-      param1 = 2.0;
-    if (param2_default)
-      param2 = 4.0;
-    break;
-  case 7:
-    if (param1_default)
-      param1 = 1.0;
-    if (param2_default)
-      param2 = 1.5;
-    break;
-  case 8:
-    if (param1_default)
-      param1 = 20.0;
-    if (param2_default)
-      param2 = 2.0;
-    break;
-  default:
-    param1 = 50.0;
-    param2 = 2.0;
-    break;
+  // a CSV file is a finite trace: it is loaded whole and the true quantile
+  // is computed as for generated items
+  if (scratch_dir && source) {
+    fprintf(stderr, "-O generates the items, it cannot read them with -i\n");
+    usage();
+    exit(1);
   }
+  bool streaming = source && !csv_input;
+  // a stream has a true quantile only if the reference sketch follows it
+  bool has_truth = !streaming || reference_eps > 0.0;
 
-  std::mt19937 generator(seed);
+  if (streaming) {
+    StreamInput in;
+    if (stream_open(&in, source, format))
+      exit(1);
 
-  std::normal_distribution<float> normaldistribution(param1, param2);
-  std::cauchy_distribution<float> cauchydistribution(param1, param2);
-  std::uniform_real_distribution<float> uniformrealdistribution(param1, param2);
-  std::exponential_distribution<float> exponentialdistribution(param1);
-  std::chi_squared_distribution<float> chisquareddistribution(param1);
-  std::gamma_distribution<float> gammadistribution(param1, param2);
-  std::lognormal_distribution<float> lognormaldistribution(param1, param2);
-  std::extreme_value_distribution<float> extremevaluedistribution(param1, param2);
+    diststr = "stream";
 
+    GkSketch reference(reference_eps);
 
-  switch (dist) {
+    clock_t begin_time = clock();
 
-  case 1:
-    for (long i = 0; i < len; i++) {
-      items[i] = normaldistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
-    }
-    memcpy(diststr, "normal", sizeof("normal"));
-    break;
-  case 2:
-    for (long i = 0; i < len; i++) {
-      items[i] = cauchydistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
-    }
-    memcpy(diststr, "cauchy", sizeof("cauchy"));
-    break;
-  case 3:
-    for (long i = 0; i < len; i++) {
-      items[i] = uniformrealdistribution(generator) * 1000.0;
-      ;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
-    }
-    memcpy(diststr, "uniform", sizeof("uniform"));
-    break;
-  case 4:
-    for (long i = 0; i < len; i++) {
-      items[i] = exponentialdistribution(generator) * 1000.0;
+    auto emit = [&](long count) {
+      float eq = (float)frugal.estimate / 1000.0;
+      fprintf(stdout, "items %ld estimated quantile: %.6f\n", count, eq);
+      if (emit_release && count > 0) {
+        // every release spends the privacy budget again
+        boost::random::laplace_distribution<float> laplace(0.0, sensitivity / epsilon);
+        std::normal_distribution<float> normal(0.0, sqrt((2 * pow(sensitivity, 2.0) * log(1.25 / delta)) / pow(epsilon, 2.0)));
+        std::normal_distribution<float> normalz(0.0, sqrt(pow(sensitivity, 2.0) / (2.0 * rho)));
+        fprintf(stdout, "items %ld DP Laplace: %.6f DP Gaussian: %.6f DP rho-zCDP: %.6f\n",
+                count, eq + laplace(generator), eq + normal(generator), eq + normalz(generator));
+      }
+      fflush(stdout);
+    };
+
+    auto update = [&](const int *items, long n) {
+      frugal.update(items, n);
+      if (reference_eps > 0.0)
+        reference.update(items, n);
+    };
+
+    if (format == STREAM_PACKED) {
+      if (in.scale != 1000) {
+        fprintf(stderr, "packed items use scale %u, expected 1000\n", in.scale);
+        exit(1);
+      }
+      len = stream_drive_items(&in, every_items, every_ms, update, emit);
+    } else {
+      len = stream_drive_scaled(&in, 1000.0, every_items, every_ms, update,
+                                emit);
     }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+    clock_t end_time = clock();
+    elapsed = (double)(end_time - begin_time) / CLOCKS_PER_SEC;
+
+    stream_close(&in);
+    if (len == 0) {
+      fprintf(stderr, "Empty input stream\n");
       exit(1);
     }
-    memcpy(diststr, "exponential", sizeof("exponential"));
-    break;
-  case 5:
-    for (long i = 0; i < len; i++) {
-      items[i] = chisquareddistribution(generator) * 1000.0;
+    fprintf(stderr, "read %ld items from %s\n", len, source);
+
+    if (reference_eps > 0.0) {
+      true_quantile = (int)reference.query((long)(len * quantile), &rank_error);
+      fprintf(stderr, "the reference quantile %.2f is %.6f, within %ld ranks (%.6f of the items); sketch size %zu KB\n",
+              quantile, (float)true_quantile / 1000.0, rank_error, (double)rank_error / len,
+              reference.bytes() / 1024);
     }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+  } else if (scratch_dir) {
+
+    // out of core: the items are generated OOC_SEGMENT at a time, fed to the
+    // estimator and counted, then generated again by the selection passes
+    DatasetCache cache;
+    if (dataset_cache_open(&cache, cache_dir))
       exit(1);
+    std::string key = dataset_cache_key("f1u-i32-ooc", dist, param1, param2, seed, len);
+    std::vector<int> buffer(std::min(len, OOC_SEGMENT));
+    const std::mt19937 start = generator;
+    auto generate = [&](std::mt19937 &g, auto f) {
+      for (long done = 0; done < len; done += (long)buffer.size()) {
+        const long m = std::min((long)buffer.size(), len - done);
+        central_generate(buffer.data(), m, dist, param1, param2, g);
+        f(buffer.data(), m);
+      }
+    };
+    auto replay = [&](auto f) {
+      std::mt19937 g = start;
+      generate(g, f);
+      fprintf(stderr, "regenerated %ld items for a pass\n", len);
+    };
+
+    if (storage == STORE_I16) {
+      // the offset must be known before the estimator pass
+      double lowest = INFINITY;
+      replay([&](const int *segment, long m) {
+        lowest = std::min(lowest, stream_stats(segment, m).min);
+      });
+      base = (int)lowest;
     }
-    memcpy(diststr, "chisquared", sizeof("chisquared"));
-    break;
-  case 6:
-    for (long i = 0; i < len; i++) {
-      items[i] = gammadistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+    OocSelect<int> select(scratch_dir);
+    generate(generator, [&](const int *segment, long m) {
+      select.update(segment, m);
+      uint16_t *stored = NULL;
+      if (storage == STORE_I16 && !(stored = store_i16(segment, m, base))) {
+        fprintf(stderr, "the items span more than 65535 units, use -T i32\n");
+        exit(1);
+      }
+      clock_t begin_time = clock();
+      if (stored)
+        frugal.update(stored, m);
+      else
+        frugal.update(segment, m);
+      clock_t end_time = clock();
+      elapsed += (double)(end_time - begin_time) / CLOCKS_PER_SEC;
+      item_free(stored);
+    });
+    diststr = describe_items(len, dist, param1, param2, seed, false);
+    fprintf(stderr, "in segments of %zu\n", buffer.size());
+
+    // determine the true quantile, unless the truth cache holds it
+    const long rank = (long)(len * quantile);
+    std::vector<long> ranks;
+    if (truth_ranks(quantile, extra_quantiles,
+                    [&](double q) { return (long)(len * (float)q); }, &ranks)) {
+      fprintf(stderr, "Bad quantile list: %s\n", extra_quantiles);
       exit(1);
     }
-    memcpy(diststr, "gamma", sizeof("gamma"));
-    break;
-  case 7:
-    for (long i = 0; i < len; i++) {
-      items[i] = lognormaldistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+    StreamTruth truth;
+    truth_cache_load(&cache, key, &truth);
+    int passes = 0;
+    bool update = truth_select(&truth, (int *)NULL, len, ranks,
+                               [&](int *, long, const long *r, int m, int *out) {
+                                 passes = select.select(replay, r, m, out);
+                               }) > 0;
+    if (passes < 0) {
+      fprintf(stderr, "cannot write scratch files in %s\n", scratch_dir);
       exit(1);
     }
-    memcpy(diststr, "lognormal", sizeof("lognormal"));
-    break;
-  case 8:
-    for (long i = 0; i < len; i++) {
-      items[i] = extremevaluedistribution(generator) * 1000.0;
+    if (!update)
+      fprintf(stderr, "read the true quantile from the truth cache\n");
+    else
+      truth_cache_store(&cache, key, truth);
+    if (passes > 0)
+      fprintf(stderr, "selected the true quantiles with %d more passes\n", passes);
+    true_quantile = (int)truth.ranks[rank];
+    fprintf(stderr, "the true quantile %.2f is %.6f\n", quantile, (float)true_quantile / 1000.0);
+    fprintf(stderr, "peak memory %ld MB\n", peak_rss_mb());
+
+  } else {
+
+    DatasetCache cache;
+    std::string key;
+
+    if (csv_input) {
+      len = csv_import_items(source, &csv, 1000.0, &items);
+      if (len <= 0) {
+        if (len == 0)
+          fprintf(stderr, "No values in %s\n", source);
+        exit(1);
+      }
+      fprintf(stderr, "read %ld items from %s\n", len, source);
+
+      diststr = "csv";
+    } else {
+      if (dataset_cache_open(&cache, cache_dir))
+        exit(1);
+      key = dataset_cache_key("f1u-i32", dist, param1, param2, seed, len);
+      std::string state;
+
+      items = (int *)dataset_cache_load(&cache, key, sizeof(int), len, &state);
+      cached = (items != NULL);
+      if (cached) {
+        // continue from the generator state after the cached items
+        engine_restore(generator, state);
+      } else {
+        /* allocate items */
+        items = (int *)item_alloc(len * sizeof(int));
+        if (!items) {
+          fprintf(stderr, "Not enough memory\n");
+          exit(1);
+        }
+      }
+
+      diststr = generate_items(items, len, dist, param1, param2, seed, generator, cached);
+
+      if (!cached)
+        dataset_cache_store(&cache, key, items, sizeof(int), len, engine_state(generator));
     }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+    ItemPages pages;
+    if (!cached && !item_pages(items, &pages))
+      fprintf(stderr, "item buffer %ld MB: %ld KB pages, %ld MB in transparent huge pages\n",
+              pages.size_kb >> 10, pages.page_kb, pages.huge_kb >> 10);
+
+    // determine the true quantile, unless the truth cache holds it
+    const long rank = (long)(len * quantile);
+    std::vector<long> ranks;
+    if (truth_ranks(quantile, extra_quantiles,
+                    [&](double q) { return (long)(len * (float)q); }, &ranks)) {
+      fprintf(stderr, "Bad quantile list: %s\n", extra_quantiles);
       exit(1);
     }
-    memcpy(diststr, "extremevalue", sizeof("extremevalue"));
-    break;
-  default:
-    for (long i = 0; i < len; i++) {
-      items[i] = normaldistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
+    StreamTruth truth;
+    if (!csv_input)
+      truth_cache_load(&cache, key, &truth);
+    bool update = truth_select(&truth, items, len, ranks,
+                               [](const int *v, long n, const long *r, int m, int *out) {
+                                 radix_multi_select(v, n, r, m, out);
+                               }) > 0;
+    if (!update)
+      fprintf(stderr, "read the true quantile from the truth cache\n");
+    else if (!csv_input)
+      truth_cache_store(&cache, key, truth);
+    true_quantile = (int)truth.ranks[rank];
+    fprintf(stderr, "the true quantile %.2f is %.6f\n", quantile, (float)true_quantile / 1000.0);
+
+    auto release = [&]() {
+      if (cached)
+        dataset_cache_unmap(items, sizeof(int), len);
+      else
+        item_free(items);
+      items = NULL;
+    };
+
+    uint16_t *stored = NULL;
+    if (storage == STORE_I16) {
+      // the estimators only compare items and move by integer steps, so
+      // running them on items - base gives the same estimate, shifted by base
+      base = (int)stream_stats(items, len).min;
+      stored = store_i16(items, len, base);
+      if (!stored) {
+        fprintf(stderr, "the items span more than 65535 units, use -T i32\n");
+        exit(1);
+      }
+      release();
     }
-    memcpy(diststr, "normal", sizeof("normal"));
-    break;
-  }
 
-  fprintf(stderr, "generated random %ld items\n", len);
-  if (dist == 1)
-    fprintf(stderr,
-            "using the normal distribution with parameters mu=%.6f and sigma=%.6f "
-            "and seed %ld\n",
-            param1, param2, seed);
-  if (dist == 2)
-    fprintf(stderr,
-            "using the cauchy distribution with parameters a=%.6f and b=%.6f and "
-            "seed %ld\n",
-            param1, param2, seed);
-  if (dist == 3)
-    fprintf(stderr,
-            "using the uniform distribution with parameters a=%.6f and b=%.6f and "
-            "seed %ld\n",
-            param1, param2, seed);
-  if (dist == 4)
-    fprintf(
-        stderr,
-        "using the exponential distribution with parameter a=%.6f and seed %ld\n",
-        param1, seed);
-  if (dist == 5)
-    fprintf(
-        stderr,
-        "using the chi squared distribution with parameter a=%.6f and seed %ld\n",
-        param1, seed);
-  if (dist == 6)
-    fprintf(stderr,
-            "using the gamma distribution with parameters a=%.6f and b=%.6f and "
-            "seed %ld\n",
-            param1, param2, seed);
-  if (dist == 7)
-    fprintf(stderr,
-            "using the lognormal distribution with parameters a=%.6f and b=%.6f "
-            "and seed %ld\n",
-            param1, param2, seed);
-  if (dist == 8)
-    fprintf(stderr,
-            "using the extreme value distribution with parameters a=%.6f and "
-            "b=%.6f and seed %ld\n",
-            param1, param2, seed);
-
-  // determine the true quantile
-  std::vector<int> vec(items, items + len);
-  auto q = vec.begin() + vec.size() * quantile;
-  std::nth_element(vec.begin(), q, vec.end());
-  true_quantile = vec[vec.size() * quantile];
-  fprintf(stderr, "the true quantile %.2f is %.6f\n", quantile, (float)true_quantile / 1000.0);
-
-
-  std::mt19937 gen(seed);
-  std::uniform_real_distribution<> dis(0.0, 1.0);
-
-  // set the estimated quantile to the value of the first item
-  estimated_quantile = items[0];
-
-clock_t begin_time = clock();
-
-    for (long i = 1; i < len; ++i) {
-
-      float rnd = dis(gen);
-
-      if (items[i] > estimated_quantile && rnd > 1.0 - quantile)
-        estimated_quantile += 1;
-      else if (items[i] < estimated_quantile && rnd > quantile)
-        estimated_quantile -= 1;
-    }
+    clock_t begin_time = clock();
+
+    if (stored)
+      frugal.update(stored, len);
+    else
+      frugal.update(items, len);
 
     clock_t end_time = clock();
     elapsed = (double)(end_time - begin_time) / CLOCKS_PER_SEC;
 
-  free(items), items = NULL;
+    if (stored)
+      item_free(stored);
+    else
+      release();
+    fprintf(stderr, "peak memory %ld MB\n", peak_rss_mb());
+  }
+
+  estimated_quantile = frugal.estimate + base;
 
   //float relative_error = fabs(((float)estimated_quantile / 1000.0 - (float)true_quantile / 1000.0)) /  fabs((float)true_quantile / 1000.0);
 
   fprintf(stdout, "estimated quantile: %.6f\n", (float)estimated_quantile / 1000.0);
   //fprintf(stdout, "the relative error is: %.6f\n", relative_error);
+  // the replicas of -B are timed apart, in the btime column
+  elapsed -= frugal.replica_seconds;
   fprintf(stdout, "elapsed time %.6f\n", elapsed);
   fprintf(stdout, "updates/s %ld\n", lround(len / elapsed));
 
-  // differentially private release of the estimated quantile
-
-
+  // spread of the estimate over the bootstrap replicas
+  char boot_cols[64] = "";
+  if (replicas > 0) {
+    BootstrapSummary boot = bootstrap_summary(frugal, [&](const Frugal1U &r) { return (float)(r.estimate + base) / 1000.0; });
+    fprintf(stdout, "bootstrap of %d replicas: std %.6f, 95%% interval [%.6f, %.6f], time %.6f\n",
+            replicas, boot.std, boot.lo, boot.hi, frugal.replica_seconds);
+    snprintf(boot_cols, sizeof(boot_cols), ", %.6f, %.6f, %.6f, %.6f", boot.std, boot.lo, boot.hi,
+             frugal.replica_seconds);
+  }
 
-  // Laplace mechanism
-  boost::random::mt19937 rng(seed);
-  boost::random::laplace_distribution<float> laplace(0.0, sensitivity/epsilon);
-  boost::variate_generator <boost::random::mt19937&, boost::random::laplace_distribution<float>> laplace_gen(rng, laplace);
-  float laplace_noise = laplace_gen();
-  float dp_laplace_estimated_quantile = ((float)estimated_quantile / 1000.0) + laplace_noise;
+  // differentially private releases of the estimated quantile (Workload.h):
+  // Laplace, Gaussian and rho-zCDP mechanisms
+  Frugal1URelease dp = frugal_1u_release(estimated_quantile, true_quantile, has_truth, sensitivity,
+                                         epsilon, delta, rho, seed, generator);
   fprintf(stdout, "DP Laplace based: sensitivity = %d epsilon = %.6f\n", sensitivity, epsilon);
-  fprintf(stdout, "DP Laplace based estimated quantile: %.6f\n", dp_laplace_estimated_quantile);
-
-  float dp_laplace_rel_err = fabs((dp_laplace_estimated_quantile - (float)(true_quantile / 1000.0)) / (float)(true_quantile / 1000.0));
-  fprintf(stdout, "the relative error for the DP Laplace estimated quantile is: %.6f\n", dp_laplace_rel_err);
+  fprintf(stdout, "DP Laplace based estimated quantile: %.6f\n", dp.laplace);
+  fprintf(stdout, "the relative error for the DP Laplace estimated quantile is: %.6f\n", dp.laplace_error);
 
-  // Gaussian mechanism
-  float sigma = sqrt((2 * pow(sensitivity, 2.0) * log(1.25/delta))/pow(epsilon, 2.0));
-  std::normal_distribution<float> normal(0.0, sigma);
-  float gaussian_noise = normal(generator);
-  float dp_gaussian_estimated_quantile = ((float)estimated_quantile / 1000.0) + gaussian_noise;
   fprintf(stdout, "DP Gaussian based: sensitivity = %d epsilon = %.6f delta = %.6f\n", sensitivity, epsilon, delta);
-  fprintf(stdout, "DP Gaussian based estimated quantile: %.6f\n", dp_gaussian_estimated_quantile);
+  fprintf(stdout, "DP Gaussian based estimated quantile: %.6f\n", dp.gaussian);
+  fprintf(stdout, "the relative error for the DP Gaussian estimated quantile is: %.6f\n", dp.gaussian_error);
 
-  float dp_gaussian_rel_err = fabs((dp_gaussian_estimated_quantile - (float)(true_quantile / 1000.0)) / (float)(true_quantile / 1000.0));
-  fprintf(stdout, "the relative error for the DP Gaussian estimated quantile is: %.6f\n", dp_gaussian_rel_err);
-
-  // rho-zCDP mechanism
-  sigma = sqrt(pow(sensitivity, 2.0) / (2.0 * rho));
-  std::normal_distribution<float> normalz(0.0, sigma);
-  float znoise = normalz(generator);
-  float dp_z_estimated_quantile = ((float)estimated_quantile / 1000.0) + znoise;
   float cor_eps = rho + 2 * sqrt(rho * log(1/delta));
   fprintf(stdout, "DP rho-zCDP based: sensitivity = %d rho = %.6f epsilon corresponding to delta = %.6f and rho is equal to %.6f\n", sensitivity, rho, delta, cor_eps);
-  fprintf(stdout, "DP rho-zCDP based estimated quantile: %.6f\n", dp_z_estimated_quantile);
-
-  float dp_z_rel_err = fabs((dp_z_estimated_quantile - (float)(true_quantile / 1000.0)) / (float)(true_quantile / 1000.0));
-  fprintf(stdout, "the relative error for the DP rho-zCDP estimated quantile is: %.6f\n", dp_z_rel_err);
+  fprintf(stdout, "DP rho-zCDP based estimated quantile: %.6f\n", dp.zcdp);
+  fprintf(stdout, "the relative error for the DP rho-zCDP estimated quantile is: %.6f\n", dp.zcdp_error);
+
+  // error distribution of each release, sampled from the final estimate
+  // instead of re-running the stream per seed (ReleaseSampler.h)
+  if (release_samples > 0) {
+    clock_t begin_time = clock();
+    const double truth = (float)true_quantile / 1000.0;
+    release_report_header(stdout, release_samples);
+    const double est = (float)estimated_quantile / 1000.0;
+    release_report(stdout, "laplace", RELEASE_LAPLACE, sensitivity / epsilon, est, truth, has_truth,
+                   release_samples, seed);
+    release_report(stdout, "gaussian", RELEASE_GAUSSIAN,
+                   sqrt((2 * pow(sensitivity, 2.0) * log(1.25 / delta)) / pow(epsilon, 2.0)), est, truth,
+                   has_truth, release_samples, seed + 1);
+    release_report(stdout, "zcdp", RELEASE_GAUSSIAN, sqrt(pow(sensitivity, 2.0) / (2.0 * rho)), est, truth,
+                   has_truth, release_samples, seed + 2);
+    fprintf(stdout, "release analysis: %.3f ms\n", (double)(clock() - begin_time) * 1000.0 / CLOCKS_PER_SEC);
+  }
   
 
 
 
   if (file_output) {
 
-    fptr = fopen(filename, "w");
-
-    if (!fptr) {
-      fprintf(stderr, "Error opening file %s\n", filename);
-      free(filename), filename = NULL;
-      exit(1);
-    }
-
     // writing to csv file the following information:
 
    //<n>, <quantile>, <distribution>, <param1>, <param2>, <seed>, <estimated
       //quantile>, <true quantile>, <elapsed time>,
       //<updates/s>, <sensitivity>, <epsilon>, <delta>, <rho>, <laplace dp estimate>, <gaussian dp estimate>, <rho-zCDP estimate>,
       //<laplace estimate relative error>,  <gaussian estimate relative error>, <rho-zCDP estimate relative error>
-      fprintf(fptr, "%ld, %.2f, %s, %.6f, %.6f, %ld, %.6f, %.6f, %.6f, %ld, %d, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f\n",
-              len, quantile, diststr, param1, param2, seed,
-              (float)estimated_quantile / 1000.0, (float)true_quantile / 1000.0,
-              elapsed, lround(len / elapsed), sensitivity, epsilon, delta, rho, dp_laplace_estimated_quantile, dp_gaussian_estimated_quantile, dp_z_estimated_quantile,
-              dp_laplace_rel_err, dp_gaussian_rel_err, dp_z_rel_err);
+      //[, <rank error bound of the reference quantile> (-G only)]
+      //[, <bootstrap std>, <bootstrap interval low>, <bootstrap interval high> (-B only)]
+      std::string row = frugal_1u_row(len, quantile, diststr, param1, param2, seed, estimated_quantile,
+                                      true_quantile, has_truth, elapsed, sensitivity, epsilon, delta,
+                                      rho, dp);
+      if (reference_eps > 0.0)
+        row += ", " + std::to_string(rank_error);
+      row += boot_cols;
+
+    if (result_store(filename)) {
+      // a row of a store shared by many runs (ResultStore.h)
+      std::string line = std::string("frugal_1u, ") + row;
+      std::string header = std::string(RESULT_HEADER) + (reference_eps > 0.0 ? ",rerr" : "") +
+                           (replicas > 0 ? BOOTSTRAP_HEADER : "");
+      std::string types = std::string(RESULT_TYPES) + (reference_eps > 0.0 ? "l" : "") +
+                          (replicas > 0 ? BOOTSTRAP_TYPES : "");
+      if (result_append(filename, header.c_str(), types.c_str(), line.c_str())) {
+        fprintf(stderr, "Error writing store %s\n", filename);
+        free(filename), filename = NULL;
+        exit(1);
+      }
+    } else {
+      fptr = fopen(filename, "w");
+
+      if (!fptr) {
+        fprintf(stderr, "Error opening file %s\n", filename);
+        free(filename), filename = NULL;
+        exit(1);
+      }
+      fprintf(fptr, "%s\n", row.c_str());
       fclose(fptr);
+    }
     free(filename), filename = NULL;
   }
 
-  free(diststr), diststr = NULL;
-
   return 0;
 }
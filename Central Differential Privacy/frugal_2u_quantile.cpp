@@ -13,9 +13,29 @@
 #include <time.h>
 #include <math.h>
 #include <algorithm>
+#include "Bootstrap.h"
+#include "CsvImport.h"
+#include "DatasetCache.h"
+#include "Frugal.h"
+#include "GkSketch.h"
+#include "RadixSelect.h"
+#include "ReleaseSampler.h"
+#include "ItemBuffer.h"
+#include "ItemStorage.h"
+#include "OutOfCore.h"
+#include "ResultStore.h"
+#include "StreamInput.h"
+#include "StreamStats.h"
+#include "TruthCache.h"
+#include "Workload.h"
 #include <boost/random.hpp>
 #include <boost/random/laplace_distribution.hpp>
 
+// the columns of a row in a result store; rerr (l) follows with -G, then
+// BOOTSTRAP_HEADER with -B
+#define RESULT_HEADER RESULT_FRUGAL_2U_HEADER
+#define RESULT_TYPES RESULT_FRUGAL_2U_TYPES
+
 
 void usage(void) {
   fprintf(stderr, "Usage:\n");
@@ -23,8 +43,9 @@ void usage(void) {
   fprintf(stderr, "-q <quantile (0<q<1)> default: 0.99\n");
   fprintf(stderr, "-k <number of chunks (2<= k <= 32)> default: 4\n");
   fprintf(stderr, "-e <epsilon> default: 0.1\n");
-  //fprintf(stderr, "-u <upper value of distribution> default: 5000.0\n");
-  //fprintf(stderr, "-l <lower value of distribution> default: -5000.0\n");
+  fprintf(stderr, "-u <upper value of the public domain> with -l: clamp the items to [lower, upper] and take the DP "
+                  "sensitivity from it instead of from the stream range\n");
+  fprintf(stderr, "-l <lower value of the public domain>\n");
   fprintf(
       stderr,
       "-d <distribution: 1(normal)|2(cauchy)|3(uniform)|4(exponential)|5(chi "
@@ -35,15 +56,50 @@ void usage(void) {
                   "default: depends on selected distribution\n");
   fprintf(stderr, "-s <seed> the seed to be used for pseudo-random number "
                   "generator default: 1234\n");
-  fprintf(stderr, "-f <filename>\n");
+  fprintf(stderr, "-f <filename> CSV file, or a .dpqr result store to append the row to\n");
+  fprintf(stderr, "-i <input stream> read items from a stream instead of generating them: "
+                  "- (stdin), a file or FIFO path, or unix:<socket path>\n");
+  fprintf(stderr, "-m <input format: text|binary|packed|csv> newline delimited values, raw float64, block-compressed items or a column of a CSV file default: text\n");
+  fprintf(stderr, "-c <column> CSV column (0-based index or header name) default: 0\n");
+  fprintf(stderr, "-C <directory> cache generated items in directory default: $DPQ_CACHE\n");
+  fprintf(stderr, "-O <directory> out of core: generate the items in segments and find the true quantiles by passes over them, "
+                  "with at most $DPQ_SCRATCH_MB (default 16384) MB of scratch files in directory\n");
+  fprintf(stderr, "-Q <q1,q2,...> also compute the true values of these quantiles and keep them in the cache\n");
+  fprintf(stderr, "-T <item storage: i32|i16> type the estimator reads the items as default: i32\n");
+  fprintf(stderr, "-N <items> print the current estimate every N input items\n");
+  fprintf(stderr, "-t <milliseconds> print the current estimate every t milliseconds\n");
+  fprintf(stderr, "-R also print a DP release with every estimate (each release spends the privacy budget)\n");
+  fprintf(stderr, "-G <epsilon> with -i, take the true quantile from a Greenwald-Khanna sketch run alongside the estimator, within epsilon * n ranks\n");
+  fprintf(stderr, "-M <samples> draw this many releases of each mechanism from the final estimate and report the "
+                  "quantiles of their error, without running the stream again\n");
+  fprintf(stderr, "-B <replicas> Poisson bootstrap: also run this many replicas of the estimator in the same pass, "
+                  "and report the spread and a 95%% interval of the (non-private) estimate default: 0\n");
+
+}
 
+// log where the len items come from, once per stream, and return the name of
+// the distribution
+const char *describe_items(long len, long dist, float param1, float param2,
+                           long seed, bool cached) {
+  if (cached)
+    fprintf(stderr, "loaded %ld cached items\n", len);
+  else
+    fprintf(stderr, "generated random %ld items\n", len);
+  if (dist_known(dist))
+    fprintf(stderr, "%s\n", dist_description(dist, param1, param2, seed).c_str());
+  return dist_name(dist);
 }
 
-// this function is applied to the step
-// to trade off convergence speed for estimation stability,
-// we apply a constant factor additive update to the step size
-// i.e., f(step) = 1
-int f(int x) { return 1; }
+// fill items with len values drawn from the selected distribution, scaled by
+// 1000 (Workload.h), and return the name of the distribution; if cached,
+// items already holds the values and only the name is returned
+const char *generate_items(int *items, long len, long dist, float param1,
+                           float param2, long seed, std::default_random_engine &generator,
+                           bool cached) {
+  if (!cached)
+    central_generate(items, len, dist, param1, param2, generator);
+  return describe_items(len, dist, param1, param2, seed, cached);
+}
 
 int main(int argc, char **argv) {
 
@@ -52,26 +108,43 @@ int main(int argc, char **argv) {
   int *items = NULL;
   long len = 500000000;
   long dist = 1;
-  char *diststr = NULL;
+  const char *diststr = NULL;
   float param1, param2;
   char *filename = NULL;
   FILE *fptr = NULL;
-  int true_quantile;
-  int *estimated_quantile = NULL;
+  int true_quantile = 0;
+  double reference_eps = 0.0; // rank error of the stream reference sketch, 0 if unused
+  long rank_error = 0;
+  int replicas = 0; // bootstrap replicas of the estimator
+  long release_samples = 0; // Monte Carlo releases of each mechanism
   float elapsed = 0.0;
   bool file_output = false;
   bool param1_default = true;
   bool param2_default = true;
-  int *stepsize = NULL;
-  int *sign = NULL;
   int chunks = 4;
   float upper = INT_MAX;
   float lower = INT_MIN;
+  int bounds = 0; // public domain given: 1 for -u, 2 for -l
   float epsilon = 0.1;
+  char *source = NULL;
+  int format = STREAM_TEXT;
+  bool csv_input = false;
+  CsvOptions csv;
+  const char *cache_dir = NULL;
+  const char *scratch_dir = NULL;
+  const char *extra_quantiles = NULL;
+  bool cached = false;
+  int storage = STORE_I32;
+  int base = 0; // offset of i16 items
+  long every_items = 0;
+  long every_ms = 0;
+  bool emit_release = false;
 
   int opt;
 
-  while ((opt = getopt(argc, argv, ":n:q:k:e:d:a:b:s:f:h")) != -1) {
+  csv_options_init(&csv);
+
+  while ((opt = getopt(argc, argv, ":n:q:k:e:u:l:d:a:b:s:f:i:m:c:C:O:Q:G:T:N:t:B:M:Rh")) != -1) {
     switch (opt) {
     case 'n':
       len = strtol(optarg, NULL, 10);
@@ -85,14 +158,14 @@ int main(int argc, char **argv) {
     case 'e':
       epsilon = strtof(optarg, NULL);
       break;
-#if 0
     case 'u':
       upper = strtof(optarg, NULL);
+      bounds |= 1;
       break;
-	case 'l':
+    case 'l':
       lower = strtof(optarg, NULL);
+      bounds |= 2;
       break;
-#endif
     case 'd':
       dist = strtol(optarg, NULL, 10);
       break;
@@ -116,6 +189,61 @@ int main(int argc, char **argv) {
       memcpy(filename, optarg, strlen(optarg));
       file_output = true;
       break;
+    case 'i':
+      source = optarg;
+      break;
+    case 'm':
+      csv_input = !strcmp(optarg, "csv");
+      format = csv_input ? STREAM_TEXT : stream_format(optarg);
+      if (format < 0) {
+        fprintf(stderr, "Unknown input format: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'c':
+      csv.column = optarg;
+      break;
+    case 'C':
+      cache_dir = optarg;
+      break;
+    case 'O':
+      scratch_dir = optarg;
+      break;
+    case 'Q':
+      extra_quantiles = optarg;
+      break;
+    case 'M':
+      release_samples = strtol(optarg, NULL, 10);
+      break;
+    case 'B':
+      replicas = strtol(optarg, NULL, 10);
+      break;
+    case 'G':
+      reference_eps = strtod(optarg, NULL);
+      if (!(reference_eps > 0.0 && reference_eps < 1.0)) {
+        fprintf(stderr, "Bad reference sketch rank error: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'T':
+      storage = storage_type(optarg);
+      if (storage != STORE_I32 && storage != STORE_I16) {
+        fprintf(stderr, "Unknown item storage: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'N':
+      every_items = strtol(optarg, NULL, 10);
+      break;
+    case 't':
+      every_ms = strtol(optarg, NULL, 10);
+      break;
+    case 'R':
+      emit_release = true;
+      break;
     case 'h':
       usage();
       exit(1);
@@ -133,364 +261,429 @@ int main(int argc, char **argv) {
     }
   }
 
-  /* allocate items */
-  items = (int *)calloc(len, sizeof(int));
-  if (!items) {
-    fprintf(stderr, "Not enough memory\n");
-    exit(1);
-  }
-  // unsigned int	seed =
-  // std::chrono::steady_clock::now().time_since_epoch().count();
-
   // set default parameter values depending on the distribution
-  switch (dist) {
-
-  case 1:
-    if (param1_default)
-      param1 = 50.0;
-    if (param2_default)
-      param2 = 2.0;
-    break;
-  case 2:
-    if (param1_default)
-      param1 = 10000.0;
-    if (param2_default)
-      param2 = 1250.0;
-    break;
-  case 3:
-    if (param1_default)
-      param1 = 0.0;
-    if (param2_default)
-      param2 = 1000.0;
-    break;
-  case 4:
-    if (param1_default)
-      param1 = 0.5;
-    if (param2_default)
-      param2 = -1.0; // not used
-    break;
-  case 5:
-    if (param1_default)
-      param1 = 5.0;
-    if (param2_default)
-      param2 = -1.0; // not used
-    break;
-  case 6:
-    if (param1_default)
-      param1 = 2.0;
-    if (param2_default)
-      param2 = 4.0;
-    break;
-  case 7:
-    if (param1_default)
-      param1 = 1.0;
-    if (param2_default)
-      param2 = 1.5;
-    break;
-  case 8:
-    if (param1_default)
-      param1 = 20.0;
-    if (param2_default)
-      param2 = 2.0;
-    break;
-  default:
-    param1 = 50.0;
-    param2 = 2.0;
-    break;
+  central_dist_defaults(dist, &param1, &param2, param1_default, param2_default);
+
+  if (bounds && (bounds != 3 || !(lower < upper))) {
+    fprintf(stderr, "-u and -l give the public domain together, with lower < upper\n");
+    usage();
+    exit(1);
   }
+  // a public domain bounds the sensitivity, so the stream range is not needed
+  // and the estimator reads the items once
+  bool bounded = (bounds == 3);
 
   std::default_random_engine generator(seed);
 
-  std::normal_distribution<float> normaldistribution(param1, param2);
-  std::cauchy_distribution<float> cauchydistribution(param1, param2);
-  std::uniform_real_distribution<float> uniformrealdistribution(param1, param2);
-  std::exponential_distribution<float> exponentialdistribution(param1);
-  std::chi_squared_distribution<float> chisquareddistribution(param1);
-  std::gamma_distribution<float> gammadistribution(param1, param2);
-  std::lognormal_distribution<float> lognormaldistribution(param1, param2);
-  std::extreme_value_distribution<float> extremevaluedistribution(param1,
-                                                                  param2);
-
-  switch (dist) {
-
-  case 1:
-    for (long i = 0; i < len; i++) {
-      items[i] = normaldistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
-    }
-    memcpy(diststr, "normal", sizeof("normal"));
-    break;
-  case 2:
-    for (long i = 0; i < len; i++) {
-      items[i] = cauchydistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
-    }
-    memcpy(diststr, "cauchy", sizeof("cauchy"));
-    break;
-  case 3:
-    for (long i = 0; i < len; i++) {
-      items[i] = uniformrealdistribution(generator) * 1000.0;
-      ;
+  fprintf(stderr, "Chunks for DP: %d\n", chunks);
+
+  Frugal2U estimator(quantile, chunks, seed);
+  if (bounded) {
+    // i16 items are offsets from the lower bound, clamped when stored
+    if (storage == STORE_I16) {
+      base = (int)lround(lower * 1000.0);
+      if (lround(upper * 1000.0) - base > 65535) {
+        fprintf(stderr, "the public domain spans more than 65535 units, use -T i32\n");
+        exit(1);
+      }
     }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+    estimator.clip((int)lround(lower * 1000.0) - base, (int)lround(upper * 1000.0) - base);
+    fprintf(stderr, "public domain [%.6f, %.6f]: items outside it are clamped\n", lower, upper);
+  }
+  // with -B, replicas fed Poisson(1) resamples in the same pass (Bootstrap.h),
+  // clamped as the estimator is
+  Bootstrapped<Frugal2U> frugal(estimator, replicas, bootstrap_seed(seed, 0), [&](int r) {
+    Frugal2U replica(estimator);
+    replica.gen.seed(bootstrap_seed(seed, r));
+    return replica;
+  });
+
+  if (csv_input && !source) {
+    fprintf(stderr, "-m csv requires an input file (-i)\n");
+    exit(1);
+  }
+  // a CSV file is a finite trace: it is loaded whole and the true quantile
+  // is computed as for generated items
+  if (scratch_dir && source) {
+    fprintf(stderr, "-O generates the items, it cannot read them with -i\n");
+    usage();
+    exit(1);
+  }
+  bool streaming = source && !csv_input;
+  // a stream has a true quantile only if the reference sketch follows it
+  bool has_truth = !streaming || reference_eps > 0.0;
+
+  if (streaming) {
+    StreamInput in;
+    if (stream_open(&in, source, format))
       exit(1);
+
+    diststr = "stream";
+
+    int max = INT_MIN;
+    int min = INT_MAX;
+
+    GkSketch reference(reference_eps);
+
+    clock_t begin_time = clock();
+
+    auto emit = [&](long count) {
+      float eq = frugal.mean() / 1000.0;
+      fprintf(stdout, "items %ld estimated quantile: %.6f\n", count, eq);
+      if (emit_release && count > 0) {
+        // every release spends the privacy budget again
+        const float width = bounded ? upper - lower : max / 1000.0 - min / 1000.0;
+        boost::random::laplace_distribution<float> laplace(0.0, width / (chunks * epsilon));
+        fprintf(stdout, "items %ld DP Laplace: %.6f\n", count, eq + laplace(generator));
+      }
+      fflush(stdout);
+    };
+
+    auto update = [&](const int *items, long n) {
+      for (long i = 0; i < n && !bounded; i++) {
+        max = (items[i] > max) ? items[i] : max;
+        min = (items[i] < min) ? items[i] : min;
+      }
+      frugal.update(items, n);
+      if (reference_eps > 0.0)
+        reference.update(items, n);
+    };
+
+    if (format == STREAM_PACKED) {
+      if (in.scale != 1000) {
+        fprintf(stderr, "packed items use scale %u, expected 1000\n", in.scale);
+        exit(1);
+      }
+      len = stream_drive_items(&in, every_items, every_ms, update, emit);
+    } else {
+      len = stream_drive_scaled(&in, 1000.0, every_items, every_ms, update,
+                                emit);
     }
-    memcpy(diststr, "uniform", sizeof("uniform"));
-    break;
-  case 4:
-    for (long i = 0; i < len; i++) {
-      items[i] = exponentialdistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+    clock_t end_time = clock();
+    elapsed = (double)(end_time - begin_time) / CLOCKS_PER_SEC;
+
+    stream_close(&in);
+    if (len == 0) {
+      fprintf(stderr, "Empty input stream\n");
       exit(1);
     }
-    memcpy(diststr, "exponential", sizeof("exponential"));
-    break;
-  case 5:
-    for (long i = 0; i < len; i++) {
-      items[i] = chisquareddistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
+    fprintf(stderr, "read %ld items from %s\n", len, source);
+
+    if (reference_eps > 0.0) {
+      true_quantile = (int)reference.query((long)(len * quantile), &rank_error);
+      fprintf(stderr, "the reference quantile %.2f is %.6f, within %ld ranks (%.6f of the items); sketch size %zu KB\n",
+              quantile, (float)true_quantile / 1000.0, rank_error, (double)rank_error / len,
+              reference.bytes() / 1024);
     }
-    memcpy(diststr, "chisquared", sizeof("chisquared"));
-    break;
-  case 6:
-    for (long i = 0; i < len; i++) {
-      items[i] = gammadistribution(generator) * 1000.0;
+
+    if (!bounded) {
+      upper = (float) (max / 1000.0);
+      lower = (float) (min / 1000.0);
+      fprintf(stderr, "maximum value: %.6f minimum value: %.6f\n", upper, lower);
     }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+  } else if (scratch_dir) {
+
+    // out of core: the items are generated OOC_SEGMENT at a time, fed to the
+    // estimator and counted, then generated again by the selection passes
+    DatasetCache cache;
+    if (dataset_cache_open(&cache, cache_dir))
       exit(1);
+    std::string key = dataset_cache_key("f2u-i32-ooc", dist, param1, param2, seed, len);
+    std::vector<int> buffer(std::min(len, OOC_SEGMENT));
+    const std::default_random_engine start = generator;
+    auto generate = [&](std::default_random_engine &g, auto f) {
+      for (long done = 0; done < len; done += (long)buffer.size()) {
+        const long m = std::min((long)buffer.size(), len - done);
+        central_generate(buffer.data(), m, dist, param1, param2, g);
+        f(buffer.data(), m);
+      }
+    };
+    auto replay = [&](auto f) {
+      std::default_random_engine g = start;
+      generate(g, f);
+      fprintf(stderr, "regenerated %ld items for a pass\n", len);
+    };
+
+    if (storage == STORE_I16 && !bounded) {
+      // the offset must be known before the estimator pass
+      double lowest = INFINITY;
+      replay([&](const int *segment, long m) {
+        lowest = std::min(lowest, stream_stats(segment, m).min);
+      });
+      base = (int)lowest;
     }
-    memcpy(diststr, "gamma", sizeof("gamma"));
-    break;
-  case 7:
-    for (long i = 0; i < len; i++) {
-      items[i] = lognormaldistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+
+    OocSelect<int> select(scratch_dir);
+    StreamStats stats = {0, INFINITY, -INFINITY, 0.0};
+    generate(generator, [&](const int *segment, long m) {
+      select.update(segment, m);
+      if (!bounded) {
+        StreamStats s = stream_stats(segment, m);
+        stats.min = std::min(stats.min, s.min);
+        stats.max = std::max(stats.max, s.max);
+      }
+      uint16_t *stored = NULL;
+      if (storage == STORE_I16 && !(stored = store_i16(segment, m, base, bounded))) {
+        fprintf(stderr, "the items span more than 65535 units, use -T i32\n");
+        exit(1);
+      }
+      clock_t begin_time = clock();
+      if (stored)
+        frugal.update(stored, m);
+      else
+        frugal.update(segment, m);
+      clock_t end_time = clock();
+      elapsed += (double)(end_time - begin_time) / CLOCKS_PER_SEC;
+      item_free(stored);
+    });
+    diststr = describe_items(len, dist, param1, param2, seed, false);
+    fprintf(stderr, "in segments of %zu\n", buffer.size());
+
+    // determine the true quantile, maximum and minimum values, unless the truth cache holds them
+    const long rank = (long)(len * quantile);
+    std::vector<long> ranks;
+    if (truth_ranks(quantile, extra_quantiles,
+                    [&](double q) { return (long)(len * (float)q); }, &ranks)) {
+      fprintf(stderr, "Bad quantile list: %s\n", extra_quantiles);
       exit(1);
     }
-    memcpy(diststr, "lognormal", sizeof("lognormal"));
-    break;
-  case 8:
-    for (long i = 0; i < len; i++) {
-      items[i] = extremevaluedistribution(generator) * 1000.0;
-    }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
+    StreamTruth truth;
+    truth_cache_load(&cache, key, &truth);
+    int passes = 0;
+    bool update = truth_select(&truth, (int *)NULL, len, ranks,
+                               [&](int *, long, const long *r, int m, int *out) {
+                                 passes = select.select(replay, r, m, out);
+                               }) > 0;
+    if (passes < 0) {
+      fprintf(stderr, "cannot write scratch files in %s\n", scratch_dir);
       exit(1);
     }
-    memcpy(diststr, "extremevalue", sizeof("extremevalue"));
-    break;
-  default:
-    for (long i = 0; i < len; i++) {
-      items[i] = normaldistribution(generator) * 1000.0;
+    if (!bounded && !truth.has_range) {
+      truth.min = stats.min;
+      truth.max = stats.max;
+      truth.has_range = true;
+      update = true;
     }
-    diststr = (char *)calloc(16, sizeof(char));
-    if (!diststr) {
-      fprintf(stderr, "not enough memory\n");
-      exit(1);
+    if (!update)
+      fprintf(stderr, "read the true quantile and range from the truth cache\n");
+    else
+      truth_cache_store(&cache, key, truth);
+    if (passes > 0)
+      fprintf(stderr, "selected the true quantiles with %d more passes\n", passes);
+    true_quantile = (int)truth.ranks[rank];
+    fprintf(stderr, "the true quantile %.2f is %.6f\n", quantile, (float)true_quantile / 1000.0);
+    if (!bounded) {
+      upper = (float) (truth.max / 1000.0);
+      lower = (float) (truth.min / 1000.0);
+      fprintf(stderr, "maximum value: %.6f minimum value: %.6f\n", upper, lower);
     }
-    memcpy(diststr, "normal", sizeof("normal"));
-    break;
-  }
-
-  fprintf(stderr, "generated random %ld items\n", len);
-  if (dist == 1)
-    fprintf(stderr,
-            "using the normal distribution with parameters mu=%.6f and sigma=%.6f "
-            "and seed %ld\n",
-            param1, param2, seed);
-  if (dist == 2)
-    fprintf(stderr,
-            "using the cauchy distribution with parameters a=%.6f and b=%.6f and "
-            "seed %ld\n",
-            param1, param2, seed);
-  if (dist == 3)
-    fprintf(stderr,
-            "using the uniform distribution with parameters a=%.6f and b=%.6f and "
-            "seed %ld\n",
-            param1, param2, seed);
-  if (dist == 4)
-    fprintf(
-        stderr,
-        "using the exponential distribution with parameter a=%.6f and seed %ld\n",
-        param1, seed);
-  if (dist == 5)
-    fprintf(
-        stderr,
-        "using the chi squared distribution with parameter a=%.6f and seed %ld\n",
-        param1, seed);
-  if (dist == 6)
-    fprintf(stderr,
-            "using the gamma distribution with parameters a=%.6f and b=%.6f and "
-            "seed %ld\n",
-            param1, param2, seed);
-  if (dist == 7)
-    fprintf(stderr,
-            "using the lognormal distribution with parameters a=%.6f and b=%.6f "
-            "and seed %ld\n",
-            param1, param2, seed);
-  if (dist == 8)
-    fprintf(stderr,
-            "using the extreme value distribution with parameters a=%.6f and "
-            "b=%.6f and seed %ld\n",
-            param1, param2, seed);
+    fprintf(stderr, "peak memory %ld MB\n", peak_rss_mb());
 
-  fprintf(stderr, "Chunks for DP: %d\n", chunks);
-
-  // determine the true quantile, maximum and minimum values
-  std::vector<int> vec(items, items + len);
-  auto q = vec.begin() + vec.size() * quantile;
-  std::nth_element(vec.begin(), q, vec.end());
-  true_quantile = vec[vec.size() * quantile];
-  upper = (float) (*max_element(vec.begin(), vec.end()) / 1000.0);
-  lower = (float) (*min_element(vec.begin(), vec.end()) / 1000.0);
-  fprintf(stderr, "the true quantile %.2f is %.6f\n", quantile, (float)true_quantile / 1000.0);
-  fprintf(stderr, "maximum value: %.6f minimum value: %.6f\n", upper, lower);
-
-  std::mt19937 gen(seed);
-  std::uniform_real_distribution<> dis(0.0, 1.0);
-
-  // set the estimated quantile to the value of the first item
-  estimated_quantile = (int *) calloc(chunks, sizeof(int));
-  stepsize = (int *) calloc(chunks, sizeof(int));
-  sign = (int *) calloc(chunks, sizeof(int));
-
-  if(!estimated_quantile || !stepsize || !sign){
-  	fprintf(stderr, "Not enough memory\n");
-  	exit(1);
-  }
-
-  memset(sign, 1, chunks);
-
-
-  for(int i = 0; i < chunks; i++)
-  	estimated_quantile[i] = items[i];
-
- clock_t begin_time = clock();
-
-	int idx;
+  } else {
 
-    for (long i = chunks; i < len; ++i) {
+    DatasetCache cache;
+    std::string key;
 
-      float rnd = dis(gen);
-	  idx = (i % chunks);
-
-      if (items[i] > estimated_quantile[idx] && rnd > 1.0 - quantile) {
-        stepsize[idx] += (sign[idx] > 0) ? f(stepsize[idx]) : -f(stepsize[idx]);
-        estimated_quantile[idx] += (stepsize[idx] > 0) ? stepsize[idx] : 1;
-        sign[idx] = 1;
-
-        if (estimated_quantile[idx] > items[i]) {
-          stepsize[idx] += items[i] - estimated_quantile[idx];
-          estimated_quantile[idx] = items[i];
-
-        }
+    if (csv_input) {
+      len = csv_import_items(source, &csv, 1000.0, &items);
+      if (len <= 0) {
+        if (len == 0)
+          fprintf(stderr, "No values in %s\n", source);
+        exit(1);
+      }
+      fprintf(stderr, "read %ld items from %s\n", len, source);
 
+      diststr = "csv";
+    } else {
+      if (dataset_cache_open(&cache, cache_dir))
+        exit(1);
+      key = dataset_cache_key("f2u-i32", dist, param1, param2, seed, len);
+      std::string state;
+
+      items = (int *)dataset_cache_load(&cache, key, sizeof(int), len, &state);
+      cached = (items != NULL);
+      if (cached) {
+        // continue from the generator state after the cached items
+        engine_restore(generator, state);
       } else {
-        if (items[i] < estimated_quantile[idx] && rnd > quantile) {
-
-          stepsize[idx] += (sign[idx] < 0) ? f(stepsize[idx]) : -f(stepsize[idx]);
-          estimated_quantile[idx] -= (stepsize[idx] > 0) ? stepsize[idx] : 1;
-          sign[idx] = -1;
+        /* allocate items */
+        items = (int *)item_alloc(len * sizeof(int));
+        if (!items) {
+          fprintf(stderr, "Not enough memory\n");
+          exit(1);
+        }
+      }
 
-          if (estimated_quantile[idx] < items[i]) {
-            stepsize[idx] += estimated_quantile[idx] - items[i];
-            estimated_quantile[idx] = items[i];
+      diststr = generate_items(items, len, dist, param1, param2, seed, generator, cached);
 
+      if (!cached)
+        dataset_cache_store(&cache, key, items, sizeof(int), len, engine_state(generator));
+    }
 
-          }
-        }
-      }
+    ItemPages pages;
+    if (!cached && !item_pages(items, &pages))
+      fprintf(stderr, "item buffer %ld MB: %ld KB pages, %ld MB in transparent huge pages\n",
+              pages.size_kb >> 10, pages.page_kb, pages.huge_kb >> 10);
+
+    // determine the true quantile, maximum and minimum values, unless the truth cache holds them
+    const long rank = (long)(len * quantile);
+    std::vector<long> ranks;
+    if (truth_ranks(quantile, extra_quantiles,
+                    [&](double q) { return (long)(len * (float)q); }, &ranks)) {
+      fprintf(stderr, "Bad quantile list: %s\n", extra_quantiles);
+      exit(1);
+    }
+    StreamTruth truth;
+    if (!csv_input)
+      truth_cache_load(&cache, key, &truth);
+    bool update = truth_select(&truth, items, len, ranks,
+                               [](const int *v, long n, const long *r, int m, int *out) {
+                                 radix_multi_select(v, n, r, m, out);
+                               }) > 0;
+    if (!bounded && !truth.has_range) {
+      StreamStats stats = stream_stats(items, len);
+      truth.min = stats.min;
+      truth.max = stats.max;
+      truth.has_range = true;
+      update = true;
+    }
+    if (!update)
+      fprintf(stderr, "read the true quantile and range from the truth cache\n");
+    else if (!csv_input)
+      truth_cache_store(&cache, key, truth);
+    true_quantile = (int)truth.ranks[rank];
+    fprintf(stderr, "the true quantile %.2f is %.6f\n", quantile, (float)true_quantile / 1000.0);
+    if (!bounded) {
+      upper = (float) (truth.max / 1000.0);
+      lower = (float) (truth.min / 1000.0);
+      fprintf(stderr, "maximum value: %.6f minimum value: %.6f\n", upper, lower);
+    }
 
-      if ((estimated_quantile[idx] - items[i]) * sign[idx] < 0 && stepsize[idx] > 1){
-        stepsize[idx] = 1;
+    auto release = [&]() {
+      if (cached)
+        dataset_cache_unmap(items, sizeof(int), len);
+      else
+        item_free(items);
+      items = NULL;
+    };
+
+    uint16_t *stored = NULL;
+    if (storage == STORE_I16) {
+      // the estimators only compare items and move by integer steps, so
+      // running them on items - base gives the same estimate, shifted by base
+      if (!bounded)
+        base = (int)truth.min;
+      stored = store_i16(items, len, base, bounded);
+      if (!stored) {
+        fprintf(stderr, "the items span more than 65535 units, use -T i32\n");
+        exit(1);
       }
-
+      release();
     }
 
+    clock_t begin_time = clock();
+
+    if (stored)
+      frugal.update(stored, len);
+    else
+      frugal.update(items, len);
 
     clock_t end_time = clock();
     elapsed = (double)(end_time - begin_time) / CLOCKS_PER_SEC;
 
-  free(items), items = NULL;
-
-  float eq = 0;
-  for(int i = 0; i < chunks; i++)
-  	eq += estimated_quantile[i];
+    if (stored)
+      item_free(stored);
+    else
+      release();
+    fprintf(stderr, "peak memory %ld MB\n", peak_rss_mb());
+  }
 
-  eq /= chunks;
+  float eq = frugal.mean() + base;
 
   //float relative_error = fabs((eq / 1000.0 - (float)true_quantile / 1000.0)) / fabs((float)true_quantile / 1000.0);
 
   fprintf(stdout, "estimated quantile: %.6f\n", eq / 1000.0);
   //fprintf(stdout, "the relative error is: %.6f\n", relative_error);
+  // the replicas of -B are timed apart, in the btime column
+  elapsed -= frugal.replica_seconds;
   fprintf(stdout, "elapsed time %.6f\n", elapsed);
   fprintf(stdout, "updates/s %ld\n", lround(len / elapsed));
 
-  // differentially private release of the estimated quantile
+  // spread of the estimate over the bootstrap replicas
+  char boot_cols[64] = "";
+  if (replicas > 0) {
+    BootstrapSummary boot = bootstrap_summary(frugal, [&](const Frugal2U &r) { return (r.mean() + base) / 1000.0; });
+    fprintf(stdout, "bootstrap of %d replicas: std %.6f, 95%% interval [%.6f, %.6f], time %.6f\n",
+            replicas, boot.std, boot.lo, boot.hi, frugal.replica_seconds);
+    snprintf(boot_cols, sizeof(boot_cols), ", %.6f, %.6f, %.6f, %.6f", boot.std, boot.lo, boot.hi,
+             frugal.replica_seconds);
+  }
+
+  // differentially private release of the estimated quantile (Workload.h):
   // Laplace mechanism
-  boost::random::mt19937 rng(seed);
-  boost::random::laplace_distribution<float> laplace(0.0, (upper - lower)/(chunks * epsilon));
-  boost::variate_generator <boost::random::mt19937&, boost::random::laplace_distribution<float>> laplace_gen(rng, laplace);
-  float laplace_noise = laplace_gen();
-  float dp_laplace_estimated_quantile = (eq / 1000.0) + laplace_noise;
+  Frugal2URelease dp = frugal_2u_release(eq, true_quantile, has_truth, lower, upper, chunks, epsilon, seed);
   fprintf(stdout, "DP epsilon: %.6f\n", epsilon);
-  fprintf(stdout, "DP Laplace based estimated sensitivity: %.6f\n", (upper - lower)/ chunks);
-  fprintf(stdout, "DP Laplace based estimated quantile: %.6f\n", dp_laplace_estimated_quantile);
-
-  float dp_rel_err = fabs((dp_laplace_estimated_quantile - (float)(true_quantile / 1000.0)) / (float)(true_quantile / 1000.0));
-  fprintf(stdout, "the relative error for the DP estimated quantile is: %.6f\n", dp_rel_err);
+  fprintf(stdout, "DP Laplace based estimated sensitivity: %.6f\n", dp.sensitivity);
+  fprintf(stdout, "DP Laplace based estimated quantile: %.6f\n", dp.laplace);
+  fprintf(stdout, "the relative error for the DP estimated quantile is: %.6f\n", dp.laplace_error);
+
+  // error distribution of each release, sampled from the final estimate
+  // instead of re-running the stream per seed (ReleaseSampler.h)
+  if (release_samples > 0) {
+    clock_t begin_time = clock();
+    const double truth = (float)true_quantile / 1000.0;
+    release_report_header(stdout, release_samples);
+    release_report(stdout, "laplace", RELEASE_LAPLACE, (upper - lower) / (chunks * epsilon), eq / 1000.0,
+                   truth, has_truth, release_samples, seed);
+    fprintf(stdout, "release analysis: %.3f ms\n", (double)(clock() - begin_time) * 1000.0 / CLOCKS_PER_SEC);
+  }
 
 
 
 
   if (file_output) {
 
-    fptr = fopen(filename, "w");
-
-    if (!fptr) {
-      fprintf(stderr, "Error opening file %s\n", filename);
-      free(filename), filename = NULL;
-      exit(1);
-    }
-
     // writing to csv file the following information:
 
     //<n>, <quantile>, <distribution>, <param1>, <param2>, <seed>, <estimated
       //quantile>, <true quantile>, <elapsed time>,
       //<updates/s>, <epsilon>, <estimated sensitivity>, <chunks>, <laplace dp estimate>, <DP relative error>
-      fprintf(fptr, "%ld, %.2f, %s, %.6f, %.6f, %ld, %.6f, %.6f, %.6f, %ld, %.6f, %.6f, %d, %.6f, %.6f\n",
-              len, quantile, diststr, param1, param2, seed,
-              eq / 1000.0, (float)true_quantile / 1000.0,
-              elapsed, lround(len / elapsed), epsilon, (upper - lower)/ chunks, chunks, dp_laplace_estimated_quantile, dp_rel_err);
+      //[, <rank error bound of the reference quantile> (-G only)]
+      //[, <bootstrap std>, <bootstrap interval low>, <bootstrap interval high> (-B only)]
+      std::string row = frugal_2u_row(len, quantile, diststr, param1, param2, seed, eq, true_quantile,
+                                      has_truth, elapsed, epsilon, chunks, dp);
+      if (reference_eps > 0.0)
+        row += ", " + std::to_string(rank_error);
+      row += boot_cols;
+
+    if (result_store(filename)) {
+      // a row of a store shared by many runs (ResultStore.h)
+      std::string line = std::string("frugal_2u, ") + row;
+      std::string header = std::string(RESULT_HEADER) + (reference_eps > 0.0 ? ",rerr" : "") +
+                           (replicas > 0 ? BOOTSTRAP_HEADER : "");
+      std::string types = std::string(RESULT_TYPES) + (reference_eps > 0.0 ? "l" : "") +
+                          (replicas > 0 ? BOOTSTRAP_TYPES : "");
+      if (result_append(filename, header.c_str(), types.c_str(), line.c_str())) {
+        fprintf(stderr, "Error writing store %s\n", filename);
+        free(filename), filename = NULL;
+        exit(1);
+      }
+    } else {
+      fptr = fopen(filename, "w");
+
+      if (!fptr) {
+        fprintf(stderr, "Error opening file %s\n", filename);
+        free(filename), filename = NULL;
+        exit(1);
+      }
+      fprintf(fptr, "%s\n", row.c_str());
       fclose(fptr);
+    }
     free(filename), filename = NULL;
 
   }
 
-  free(diststr), diststr = NULL;
-
   return 0;
 }
@@ -35,7 +35,7 @@ def test_on_quantiles(outdir):
         proc = []
         for seed in range(seed_base, seed_base + (step_num * seed_step), seed_step):
             outputfile = outputdir + "/test_stream_quantile_" + str(test_count) + "_" + str(seed_count) + ".csv"
-            proc.append(sbc.run([exec_name, "-n", ni_default, "-q" , q, "-d", d_default, "-e", eps_default, "-p", delta_default, "-r", rho_default, "-f", outputfile, "-s", str(seed)]))
+            proc.append(sbc.run([exec_name, "-n", ni_default, "-q" , q, "-Q", ",".join(q_values), "-d", d_default, "-e", eps_default, "-p", delta_default, "-r", rho_default, "-f", outputfile, "-s", str(seed)]))
             seed_count = seed_count + 1
             print_to_stderr("#")
 
@@ -0,0 +1,159 @@
+/*
+ * Online Poisson bootstrap of a streaming estimator: error bars from a
+ * single pass instead of one run per seed.
+ *
+ * Bootstrapped<E> is an estimator E (any of Frugal.h or LdpKernels.h) that
+ * also feeds B replicas of E in the same pass. Each item goes to each
+ * replica a Poisson(1) number of times, drawn from a SplitMix64 generator,
+ * so that every replica sees a resample of the stream, as if drawn with
+ * replacement. The items are resampled BOOTSTRAP_BLOCK at a time, while the
+ * block is in cache, into a buffer handed to the replica's own update(); the
+ * estimators are unchanged. The replicas draw their own noise: a factory
+ * builds each one with seeds of its own.
+ *
+ * After the pass, bootstrap_summary() gives the standard deviation of the
+ * replica estimates and a percentile confidence interval of the estimate.
+ * A replica costs about as much as the estimator itself, so B replicas cost
+ * B + 1 updates per item in one pass, rather than a generation, a range scan
+ * and a selection per seed. The processor time of the replicas is kept
+ * apart, so the binaries time the estimator alone and report the replicas
+ * in a column of their own.
+ *
+ */
+
+#ifndef __BOOTSTRAP_H__
+#define __BOOTSTRAP_H__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#define BOOTSTRAP_BLOCK 4096
+#define BOOTSTRAP_LEVEL 0.95
+#define BOOTSTRAP_MAX_WEIGHT 15 // P(Poisson(1) > 15) < 1e-13
+
+// the columns the binaries append to their rows with -B, and their types
+#define BOOTSTRAP_HEADER ",bstd,bcil,bcir,btime"
+#define BOOTSTRAP_TYPES "dddd"
+
+struct SplitMix64 {
+  uint64_t state;
+
+  explicit SplitMix64(uint64_t seed) : state(seed) {}
+  uint64_t operator()() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+};
+
+// Poisson(1) weights by inversion: weight k for a uniform 64-bit draw below
+// the k-th cumulative probability, scaled to 2^64
+struct PoissonOne {
+  uint64_t cdf[BOOTSTRAP_MAX_WEIGHT];
+
+  PoissonOne() {
+    double p = exp(-1.0), sum = 0.0;
+    for (int k = 0; k < BOOTSTRAP_MAX_WEIGHT; k++) {
+      sum += p;
+      p /= k + 1;
+      // clamped below 2^64, which does not fit a uint64_t
+      cdf[k] = (uint64_t)std::min(ldexp(sum, 64), ldexp(1.0, 64) - 4096.0);
+    }
+  }
+  int operator()(uint64_t u) const {
+    int k = 0;
+    while (k < BOOTSTRAP_MAX_WEIGHT && u >= cdf[k])
+      k++;
+    return k;
+  }
+};
+
+// a seed for replica r of a run seeded with seed, unrelated to the seeds of
+// other runs (which the scripts space by small steps)
+inline long bootstrap_seed(long seed, int r) {
+  SplitMix64 mix((uint64_t)seed * 0x9e3779b97f4a7c15ull + (uint64_t)r);
+  return (long)(mix() >> 33);
+}
+
+template <typename E> struct Bootstrapped : E {
+  std::vector<E> replicas;
+  SplitMix64 gen;
+  PoissonOne poisson;
+  double replica_seconds; // processor time spent on the replicas
+
+  // make(r) builds replica r, 1 to replicas, with seeds of its own
+  template <typename Make>
+  Bootstrapped(const E &estimator, int count, uint64_t seed, Make make)
+      : E(estimator), gen(seed), replica_seconds(0.0) {
+    for (int r = 1; r <= count; r++)
+      replicas.push_back(make(r));
+  }
+
+  template <typename T, typename... Norm>
+  void update(const T *items, long n, Norm... norm) {
+    if (replicas.empty()) {
+      E::update(items, n, norm...);
+      return;
+    }
+    std::vector<T> resample;
+    resample.reserve(2 * BOOTSTRAP_BLOCK);
+    for (long i = 0; i < n; i += BOOTSTRAP_BLOCK) {
+      const long m = std::min((long)BOOTSTRAP_BLOCK, n - i);
+      E::update(items + i, m, norm...);
+      const clock_t begin_time = clock();
+      for (E &replica : replicas) {
+        resample.clear();
+        for (long j = i; j < i + m; j++)
+          for (int w = poisson(gen()); w > 0; w--)
+            resample.push_back(items[j]);
+        replica.update(resample.data(), (long)resample.size(), norm...);
+      }
+      replica_seconds += (double)(clock() - begin_time) / CLOCKS_PER_SEC;
+    }
+  }
+};
+
+struct BootstrapSummary {
+  double std; // of the replica estimates
+  double lo;  // percentile confidence interval
+  double hi;
+};
+
+// Summary of the replica estimates in values (reordered); NaN if there are
+// fewer than two.
+inline BootstrapSummary bootstrap_summary(std::vector<double> &values,
+                                          double level = BOOTSTRAP_LEVEL) {
+  BootstrapSummary s = {NAN, NAN, NAN};
+  const long b = (long)values.size();
+  if (b < 2)
+    return s;
+  double mean = 0.0, ss = 0.0;
+  for (double v : values)
+    mean += v;
+  mean /= b;
+  for (double v : values)
+    ss += (v - mean) * (v - mean);
+  s.std = sqrt(ss / (b - 1));
+  std::sort(values.begin(), values.end());
+  const double tail = 0.5 * (1.0 - level) * (b - 1);
+  s.lo = values[(long)floor(tail)];
+  s.hi = values[(long)ceil((b - 1) - tail)];
+  return s;
+}
+
+// summary of value(replica) over the replicas of estimator
+template <typename E, typename Value>
+BootstrapSummary bootstrap_summary(const Bootstrapped<E> &estimator,
+                                   Value value,
+                                   double level = BOOTSTRAP_LEVEL) {
+  std::vector<double> values;
+  for (const E &replica : estimator.replicas)
+    values.push_back(value(replica));
+  return bootstrap_summary(values, level);
+}
+
+#endif //__BOOTSTRAP_H__
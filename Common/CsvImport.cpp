@@ -0,0 +1,232 @@
+/*
+ * Parallel importer for CSV/text traces.
+ *
+ */
+
+#include "CsvImport.h"
+#include "ItemBuffer.h"
+#include "StreamInput.h"
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+void csv_options_init(CsvOptions *opt) {
+  opt->column = NULL;
+  opt->delim = ',';
+  opt->threads = 0;
+  opt->rejected = 0;
+}
+
+// Finds field col of the row [p, e) and trims blanks, '\r' and quotes.
+// Returns false if the row has fewer fields.
+static bool csv_field(const char *p, const char *e, char delim, int col,
+                      const char **fb, const char **fe) {
+  for (int c = 0; c < col; c++) {
+    const char *d = (const char *)memchr(p, delim, e - p);
+    if (!d)
+      return false;
+    p = d + 1;
+  }
+  const char *d = (const char *)memchr(p, delim, e - p);
+  if (d)
+    e = d;
+
+  while (p < e && (*p == ' ' || *p == '\t'))
+    p++;
+  while (e > p && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\r'))
+    e--;
+  if (e - p >= 2 && *p == '"' && e[-1] == '"')
+    p++, e--;
+  *fb = p;
+  *fe = e;
+  return true;
+}
+
+// one past the end of the row starting at p
+static const char *row_end(const char *p, const char *e) {
+  const char *nl = (const char *)memchr(p, '\n', e - p);
+  return nl ? nl : e;
+}
+
+static long count_rows(const char *p, const char *e) {
+  long rows = 0;
+  while (p < e) {
+    p = row_end(p, e) + 1;
+    rows++;
+  }
+  return rows;
+}
+
+// Resolves the selected column and whether the first row is a header.
+static int csv_column(const char *data, const char *end, const CsvOptions *opt,
+                      bool *header) {
+  const char *column = opt->column ? opt->column : "0";
+  const char *first_end = row_end(data, end);
+  const char *fb, *fe;
+  char *endptr;
+
+  long col = strtol(column, &endptr, 10);
+  if (*column && !*endptr) {
+    double v;
+    if (col < 0 || col > INT_MAX) {
+      fprintf(stderr, "Invalid column %s\n", column);
+      return -1;
+    }
+    *header = csv_field(data, first_end, opt->delim, (int)col, &fb, &fe) &&
+              !parse_value(fb, fe, &v);
+    return (int)col;
+  }
+
+  *header = true;
+  for (int c = 0; csv_field(data, first_end, opt->delim, c, &fb, &fe); c++)
+    if (std::string(fb, fe) == column)
+      return c;
+  fprintf(stderr, "Column %s not found in the header\n", column);
+  return -1;
+}
+
+template <typename T, typename Convert>
+static long csv_parse(const char *path, CsvOptions *opt, Convert convert,
+                      T **out) {
+  *out = NULL;
+  opt->rejected = 0;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Error opening input %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+    fprintf(stderr, "%s is not a regular file\n", path);
+    close(fd);
+    return -1;
+  }
+  size_t size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    *out = (T *)item_alloc(sizeof(T));
+    return 0;
+  }
+  char *data = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Error mapping %s: %s\n", path, strerror(errno));
+    return -1;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  const char *end = data + size;
+
+  bool header;
+  int col = csv_column(data, end, opt, &header);
+  if (col < 0) {
+    munmap(data, size);
+    return -1;
+  }
+  const char *start = header ? row_end(data, end) + 1 : data;
+  if (start > end)
+    start = end;
+
+  int threads = opt->threads;
+  if (threads <= 0)
+    threads = std::thread::hardware_concurrency();
+  if (threads <= 0)
+    threads = 1;
+  // ranges below 1 MiB are not worth a thread
+  long max_threads = (end - start) / (1 << 20) + 1;
+  if (threads > max_threads)
+    threads = (int)max_threads;
+
+  // newline-aligned range boundaries
+  std::vector<const char *> bound(threads + 1);
+  bound[0] = start;
+  bound[threads] = end;
+  for (int t = 1; t < threads; t++) {
+    const char *b = start + (end - start) * t / threads;
+    if (b < bound[t - 1])
+      b = bound[t - 1];
+    bound[t] = (b > start && b[-1] != '\n') ? row_end(b, end) + 1 : b;
+    if (bound[t] > end)
+      bound[t] = end;
+  }
+
+  std::vector<long> rows(threads), offset(threads + 1), parsed(threads);
+  std::vector<std::thread> pool;
+
+  for (int t = 0; t < threads; t++)
+    pool.emplace_back(
+        [&, t]() { rows[t] = count_rows(bound[t], bound[t + 1]); });
+  for (auto &th : pool)
+    th.join();
+  pool.clear();
+
+  offset[0] = 0;
+  for (int t = 0; t < threads; t++)
+    offset[t + 1] = offset[t] + rows[t];
+
+  T *values = (T *)item_alloc((offset[threads] ? offset[threads] : 1) * sizeof(T));
+  if (!values) {
+    fprintf(stderr, "Not enough memory\n");
+    munmap(data, size);
+    return -1;
+  }
+
+  const char delim = opt->delim;
+  for (int t = 0; t < threads; t++)
+    pool.emplace_back([&, t]() {
+      T *v = values + offset[t];
+      long n = 0;
+      const char *p = bound[t];
+      const char *e = bound[t + 1];
+      while (p < e) {
+        const char *re = row_end(p, e);
+        const char *fb, *fe;
+        double x;
+        if (csv_field(p, re, delim, col, &fb, &fe) && fb < fe &&
+            parse_value(fb, fe, &x))
+          v[n++] = convert(x);
+        p = re + 1;
+      }
+      parsed[t] = n;
+    });
+  for (auto &th : pool)
+    th.join();
+
+  munmap(data, size);
+
+  // close the gaps left by skipped rows
+  long n = parsed[0];
+  for (int t = 1; t < threads; t++) {
+    if (n != offset[t])
+      memmove(values + n, values + offset[t], parsed[t] * sizeof(T));
+    n += parsed[t];
+  }
+  opt->rejected = offset[threads] - n;
+  if (opt->rejected)
+    fprintf(stderr, "skipped %ld rows without a valid value in column %d\n",
+            opt->rejected, col);
+
+  *out = values;
+  return n;
+}
+
+long csv_import(const char *path, CsvOptions *opt, double **values) {
+  return csv_parse(path, opt, [](double x) { return x; }, values);
+}
+
+long csv_import_items(const char *path, CsvOptions *opt, double scale,
+                      int **items) {
+  return csv_parse(path, opt, [scale](double x) { return (int)lround(x * scale); },
+                   items);
+}
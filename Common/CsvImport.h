@@ -0,0 +1,36 @@
+/*
+ * Parallel importer for CSV/text traces.
+ *
+ * The file is mapped into memory and split into newline-aligned ranges, one
+ * per thread. A first pass counts the rows of every range, so that the second
+ * pass can parse each range straight into its slice of the output array; row
+ * order is preserved. A column is selected by 0-based index or by header name.
+ * The first row is taken to be a header when the column is selected by name,
+ * or when its selected field is not a number. Quotes around a field are
+ * stripped, but quoted fields may not contain the delimiter. Rows whose field
+ * is missing or malformed are skipped and counted.
+ *
+ */
+
+#ifndef __CSVIMPORT_H__
+#define __CSVIMPORT_H__
+
+struct CsvOptions {
+  const char *column; // index or header name, "0" if NULL
+  char delim;         // field delimiter, ',' by default
+  int threads;        // 0 uses all available cores
+  long rejected;      // set on return: rows skipped
+};
+
+void csv_options_init(CsvOptions *opt);
+
+// Imports the selected column as doubles into an array from item_alloc
+// (ItemBuffer.h) stored in *values. Returns the number of values, -1 (with a message on stderr) on
+// failure.
+long csv_import(const char *path, CsvOptions *opt, double **values);
+
+// As csv_import, storing lround(value * scale) as fixed-point items.
+long csv_import_items(const char *path, CsvOptions *opt, double scale,
+                      int **items);
+
+#endif //__CSVIMPORT_H__
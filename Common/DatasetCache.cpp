@@ -0,0 +1,208 @@
+/*
+ * On-disk cache of generated item streams.
+ *
+ */
+
+#include "DatasetCache.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+struct CacheHeader {
+  char magic[4]; // "DPQC"
+  uint32_t version;
+  uint64_t item_size;
+  uint64_t count;
+  uint64_t state_len; // generator state text following the header
+  char key[CACHE_KEY_SIZE];
+};
+
+static uint64_t fnv1a(const std::string &s) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static std::string entry_path(const DatasetCache *c, const std::string &key) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.dpqc", (unsigned long long)fnv1a(key));
+  return c->dir + "/" + name;
+}
+
+int dataset_cache_open(DatasetCache *c, const char *dir) {
+  c->enabled = false;
+  c->dir.clear();
+  if (!dir)
+    dir = getenv("DPQ_CACHE");
+  if (!dir || !*dir)
+    return 0;
+
+  if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+    fprintf(stderr, "Error creating cache directory %s: %s\n", dir,
+            strerror(errno));
+    return -1;
+  }
+  c->dir = dir;
+  const char *mb = getenv("DPQ_CACHE_MB");
+  c->budget = (mb ? atoll(mb) : CACHE_DEFAULT_MB) * 1024LL * 1024LL;
+  c->enabled = true;
+  return 0;
+}
+
+std::string dataset_cache_key(const char *generator, long dist, double param1,
+                              double param2, long seed, long len) {
+  char key[CACHE_KEY_SIZE];
+  // %a prints the parameters exactly
+  snprintf(key, sizeof(key), "%s d=%ld a=%a b=%a s=%ld n=%ld", generator, dist,
+           param1, param2, seed, len);
+  return key;
+}
+
+void *dataset_cache_load(DatasetCache *c, const std::string &key,
+                         size_t item_size, long count, std::string *state) {
+  if (!c->enabled)
+    return NULL;
+
+  std::string path = entry_path(c, key);
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  size_t size = CACHE_DATA_OFFSET + item_size * count;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size != size) {
+    close(fd);
+    return NULL;
+  }
+  char *base =
+      (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+
+  CacheHeader h;
+  memcpy(&h, base, sizeof(h));
+  if (memcmp(h.magic, "DPQC", 4) || h.version != CACHE_VERSION ||
+      h.item_size != item_size || h.count != (uint64_t)count ||
+      strncmp(h.key, key.c_str(), CACHE_KEY_SIZE) ||
+      h.state_len > CACHE_DATA_OFFSET - sizeof(h)) {
+    munmap(base, size);
+    close(fd);
+    return NULL;
+  }
+  state->assign(base + sizeof(h), h.state_len);
+  madvise(base + CACHE_DATA_OFFSET, item_size * count, MADV_WILLNEED);
+
+  // mark the entry as recently used
+  futimens(fd, NULL);
+  close(fd);
+  return base + CACHE_DATA_OFFSET;
+}
+
+void dataset_cache_unmap(void *items, size_t item_size, long count) {
+  munmap((char *)items - CACHE_DATA_OFFSET,
+         CACHE_DATA_OFFSET + item_size * count);
+}
+
+// Removes the least recently used entries, except keep, until the cache fits
+// the budget.
+static void dataset_cache_evict(DatasetCache *c, const std::string &keep) {
+  struct Entry {
+    std::string path;
+    time_t used;
+    long long size;
+  };
+  std::vector<Entry> entries;
+  long long total = 0;
+
+  DIR *d = opendir(c->dir.c_str());
+  if (!d)
+    return;
+  struct dirent *de;
+  while ((de = readdir(d))) {
+    size_t len = strlen(de->d_name);
+    if (len < 5 || strcmp(de->d_name + len - 5, ".dpqc"))
+      continue;
+    std::string path = c->dir + "/" + de->d_name;
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0)
+      continue;
+    total += st.st_size;
+    if (path != keep)
+      entries.push_back({path, st.st_mtime, (long long)st.st_size});
+  }
+  closedir(d);
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.used < b.used; });
+  for (size_t i = 0; i < entries.size() && total > c->budget; i++) {
+    if (unlink(entries[i].path.c_str()) == 0) {
+      total -= entries[i].size;
+      fprintf(stderr, "evicted cached items %s\n", entries[i].path.c_str());
+    }
+  }
+}
+
+int dataset_cache_store(DatasetCache *c, const std::string &key,
+                        const void *items, size_t item_size, long count,
+                        const std::string &state) {
+  if (!c->enabled)
+    return 0;
+
+  CacheHeader h;
+  size_t bytes = item_size * count;
+  if (key.size() >= CACHE_KEY_SIZE ||
+      state.size() > CACHE_DATA_OFFSET - sizeof(h) ||
+      (long long)(CACHE_DATA_OFFSET + bytes) > c->budget)
+    return -1;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, "DPQC", 4);
+  h.version = CACHE_VERSION;
+  h.item_size = item_size;
+  h.count = count;
+  h.state_len = state.size();
+  strncpy(h.key, key.c_str(), CACHE_KEY_SIZE - 1);
+
+  std::string path = entry_path(c, key);
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp%ld", (long)getpid());
+  std::string tmp = path + suffix;
+
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  if (!fp) {
+    fprintf(stderr, "Error creating cache entry %s: %s\n", tmp.c_str(),
+            strerror(errno));
+    return -1;
+  }
+  std::vector<char> head(CACHE_DATA_OFFSET, 0);
+  memcpy(head.data(), &h, sizeof(h));
+  memcpy(head.data() + sizeof(h), state.data(), state.size());
+  bool ok = fwrite(head.data(), 1, head.size(), fp) == head.size() &&
+            fwrite(items, 1, bytes, fp) == bytes;
+  ok = (fclose(fp) == 0) && ok;
+
+  // the rename makes the complete entry visible at once to concurrent runs
+  if (!ok || rename(tmp.c_str(), path.c_str()) < 0) {
+    fprintf(stderr, "Error writing cache entry %s\n", path.c_str());
+    unlink(tmp.c_str());
+    return -1;
+  }
+
+  dataset_cache_evict(c, path);
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * On-disk cache of generated item streams.
+ *
+ * A stream is identified by a key naming the generator (the item type and
+ * the code that draws the items) and its inputs: distribution, parameters,
+ * seed and length. Entries are stored in the cache directory under the FNV-1a
+ * hash of the key, together with the key itself (checked on load) and the
+ * state the generator had after drawing the items, so that a run reading a
+ * cached stream draws the same noise afterwards as one generating it.
+ *
+ * Loading maps the file privately: the binaries may reorder the items in
+ * place without touching the cached copy. Every hit refreshes the file
+ * modification time; when a store exceeds the disk budget the least recently
+ * used entries are removed.
+ *
+ * The cache directory is given with -C or the DPQ_CACHE environment variable,
+ * the budget in megabytes with DPQ_CACHE_MB (default 4096).
+ *
+ */
+
+#ifndef __DATASETCACHE_H__
+#define __DATASETCACHE_H__
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+#define CACHE_VERSION 1
+#define CACHE_KEY_SIZE 224
+// items start at this offset, a multiple of the page size
+#define CACHE_DATA_OFFSET 16384
+#define CACHE_DEFAULT_MB 4096
+
+struct DatasetCache {
+  std::string dir;
+  long long budget; // bytes
+  bool enabled;
+};
+
+// Uses dir, or $DPQ_CACHE if dir is NULL; the cache is disabled if neither
+// is set. Returns 0 on success, -1 if the directory cannot be created.
+int dataset_cache_open(DatasetCache *c, const char *dir);
+
+// formats the key of a generated stream
+std::string dataset_cache_key(const char *generator, long dist, double param1,
+                              double param2, long seed, long len);
+
+// Returns a private mapping of the count items cached under key and stores
+// the saved generator state in state, or NULL on a miss.
+void *dataset_cache_load(DatasetCache *c, const std::string &key,
+                         size_t item_size, long count, std::string *state);
+
+// Stores the items under key and evicts entries over the budget. Returns 0
+// on success, -1 on failure (the cache is left unchanged).
+int dataset_cache_store(DatasetCache *c, const std::string &key,
+                        const void *items, size_t item_size, long count,
+                        const std::string &state);
+
+// releases items returned by dataset_cache_load
+void dataset_cache_unmap(void *items, size_t item_size, long count);
+
+template <typename Engine> std::string engine_state(const Engine &e) {
+  std::ostringstream os;
+  os << e;
+  return os.str();
+}
+
+template <typename Engine>
+void engine_restore(Engine &e, const std::string &state) {
+  std::istringstream is(state);
+  is >> e;
+}
+
+#endif //__DATASETCACHE_H__
@@ -0,0 +1,143 @@
+/*
+ * Frugal-1U and Frugal-2U streaming quantile estimators used by the central
+ * differential privacy binaries. Items are integers (values scaled by 1000),
+ * stored as int or any narrower integer type.
+ * Both estimators can be fed incrementally, one batch at a time; feeding a
+ * whole array in one call or in consecutive pieces gives the same estimate.
+ *
+ */
+
+#ifndef __FRUGAL_H__
+#define __FRUGAL_H__
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <random>
+#include <vector>
+
+struct Frugal1U {
+  float quantile;
+  int estimate;
+  long count;
+  std::mt19937 gen;
+  std::uniform_real_distribution<> dis;
+
+  Frugal1U(float quantile, long seed)
+      : quantile(quantile), estimate(0), count(0), gen(seed), dis(0.0, 1.0) {}
+
+  template <typename T> void update(const T *items, long n) {
+    long i = 0;
+
+    // set the estimated quantile to the value of the first item
+    if (count == 0 && n > 0) {
+      estimate = items[0];
+      i = 1;
+    }
+
+    for (; i < n; ++i) {
+
+      float rnd = dis(gen);
+
+      if (items[i] > estimate && rnd > 1.0 - quantile)
+        estimate += 1;
+      else if (items[i] < estimate && rnd > quantile)
+        estimate -= 1;
+    }
+
+    count += n;
+  }
+};
+
+// Frugal-2U run independently on chunks interleaved item by item: item i
+// updates chunk i % chunks. The released estimate is the chunk average.
+// Items are clamped to [lo, hi], the whole int range unless clip() narrows
+// it to a public domain; the chunk estimates then stay in it, which bounds
+// the sensitivity of their average without knowing the stream range.
+struct Frugal2U {
+  float quantile;
+  int chunks;
+  std::vector<int> estimate;
+  std::vector<int> stepsize;
+  std::vector<int> sign;
+  long count;
+  int lo;
+  int hi;
+  std::mt19937 gen;
+  std::uniform_real_distribution<> dis;
+
+  Frugal2U(float quantile, int chunks, long seed)
+      : quantile(quantile), chunks(chunks), estimate(chunks), stepsize(chunks),
+        sign(chunks), count(0), lo(INT_MIN), hi(INT_MAX), gen(seed),
+        dis(0.0, 1.0) {
+    memset(sign.data(), 1, chunks);
+  }
+
+  void clip(int lower, int upper) {
+    lo = lower;
+    hi = upper;
+  }
+
+  // this function is applied to the step
+  // to trade off convergence speed for estimation stability,
+  // we apply a constant factor additive update to the step size
+  // i.e., f(step) = 1
+  static int f(int x) { return 1; }
+
+  template <typename T> void update(const T *items, long n) {
+    long i = 0;
+
+    // the first item of every chunk is its initial estimate
+    for (; i < n && count < chunks; ++i, ++count)
+      estimate[count] = std::min(std::max((int)items[i], lo), hi);
+
+    int idx;
+
+    for (; i < n; ++i, ++count) {
+
+      float rnd = dis(gen);
+      idx = (count % chunks);
+      const int item = std::min(std::max((int)items[i], lo), hi);
+
+      if (item > estimate[idx] && rnd > 1.0 - quantile) {
+        stepsize[idx] += (sign[idx] > 0) ? f(stepsize[idx]) : -f(stepsize[idx]);
+        estimate[idx] += (stepsize[idx] > 0) ? stepsize[idx] : 1;
+        sign[idx] = 1;
+
+        if (estimate[idx] > item) {
+          stepsize[idx] += item - estimate[idx];
+          estimate[idx] = item;
+        }
+
+      } else {
+        if (item < estimate[idx] && rnd > quantile) {
+
+          stepsize[idx] += (sign[idx] < 0) ? f(stepsize[idx]) : -f(stepsize[idx]);
+          estimate[idx] -= (stepsize[idx] > 0) ? stepsize[idx] : 1;
+          sign[idx] = -1;
+
+          if (estimate[idx] < item) {
+            stepsize[idx] += estimate[idx] - item;
+            estimate[idx] = item;
+          }
+        }
+      }
+
+      if ((estimate[idx] - item) * sign[idx] < 0 && stepsize[idx] > 1) {
+        stepsize[idx] = 1;
+      }
+    }
+  }
+
+  // average of the chunk estimates (scaled, as the items)
+  float mean() const {
+    float eq = 0;
+    for (int i = 0; i < chunks; i++)
+      eq += estimate[i];
+
+    eq /= chunks;
+    return eq;
+  }
+};
+
+#endif //__FRUGAL_H__
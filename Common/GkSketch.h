@@ -0,0 +1,130 @@
+/*
+ * Greenwald-Khanna quantile summary, the reference estimator of the streaming
+ * modes: their items are never stored, so no exact ground truth exists. The
+ * summary answers any quantile of the n items seen with an item whose rank is
+ * within eps * n of the requested one, deterministically, in
+ * O(1/eps log(eps n)) tuples.
+ *
+ * Items are buffered, sorted and merged into the summary GK_BUFFER at a time,
+ * after which adjacent tuples are merged while the GK invariant
+ * g + delta <= 2 eps n allows (as in Spark's QuantileSummaries). Feeding the
+ * items in one call or in pieces gives the same summary; a query merges the
+ * buffer first.
+ *
+ */
+
+#ifndef __GKSKETCH_H__
+#define __GKSKETCH_H__
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#define GK_BUFFER 2048
+
+// g: items between the previous tuple and this one, delta: uncertainty of
+// the rank of value
+struct GkTuple {
+  double value;
+  long g;
+  long delta;
+};
+
+struct GkSketch {
+  double eps;
+  long count; // items merged into tuples
+  std::vector<GkTuple> tuples;
+  std::vector<double> buffer;
+
+  GkSketch(double eps) : eps(eps), count(0) { buffer.reserve(GK_BUFFER); }
+
+  template <typename T> void update(const T *items, long n) {
+    for (long i = 0; i < n; i++) {
+      buffer.push_back((double)items[i]);
+      if (buffer.size() == GK_BUFFER)
+        flush();
+    }
+  }
+
+  void flush() {
+    if (buffer.empty())
+      return;
+    std::sort(buffer.begin(), buffer.end());
+
+    std::vector<GkTuple> merged;
+    merged.reserve(tuples.size() + buffer.size());
+    size_t t = 0;
+    for (size_t b = 0; b < buffer.size(); b++) {
+      while (t < tuples.size() && tuples[t].value <= buffer[b])
+        merged.push_back(tuples[t++]);
+      count++;
+      // the new minimum and maximum have exact ranks
+      const bool edge =
+          merged.empty() || (t == tuples.size() && b == buffer.size() - 1);
+      merged.push_back({buffer[b], 1, edge ? 0 : (long)(2 * eps * count)});
+    }
+    merged.insert(merged.end(), tuples.begin() + t, tuples.end());
+    buffer.clear();
+    compress(merged);
+  }
+
+  // merges each tuple into its successor while g + g' + delta' stays below
+  // 2 eps n, keeping the first and last tuples
+  void compress(std::vector<GkTuple> &merged) {
+    const long threshold = (long)(2 * eps * count);
+    tuples.clear();
+    if (merged.empty())
+      return;
+    GkTuple head = merged.back();
+    for (long i = (long)merged.size() - 2; i >= 1; i--) {
+      if (merged[i].g + head.g + head.delta < threshold) {
+        head.g += merged[i].g;
+      } else {
+        tuples.push_back(head);
+        head = merged[i];
+      }
+    }
+    tuples.push_back(head);
+    if (merged.size() > 1)
+      tuples.push_back(merged[0]);
+    std::reverse(tuples.begin(), tuples.end());
+  }
+
+  // Item of 0-based rank k, approximately; *error (if not NULL) is a bound
+  // on the difference between the rank of the returned item and k.
+  double query(long k, long *error) {
+    flush();
+    if (tuples.empty()) {
+      if (error)
+        *error = 0;
+      return NAN;
+    }
+    const long r = std::min(std::max(k, 0L), count - 1) + 1; // 1-based
+    long target = 0;
+    for (const GkTuple &t : tuples)
+      target = std::max(target, t.g + t.delta);
+    target /= 2;
+
+    long min_rank = 0;
+    size_t i = 0;
+    for (; i + 1 < tuples.size(); i++) {
+      min_rank += tuples[i].g;
+      const long max_rank = min_rank + tuples[i].delta;
+      if (max_rank - target <= r && r <= min_rank + target)
+        break;
+    }
+    if (i + 1 == tuples.size())
+      min_rank = count;
+    if (error)
+      *error = std::max(std::max(r - min_rank, min_rank + tuples[i].delta - r),
+                        0L);
+    return tuples[i].value;
+  }
+
+  size_t bytes() const {
+    return tuples.capacity() * sizeof(GkTuple) +
+           buffer.capacity() * sizeof(double);
+  }
+};
+
+#endif //__GKSKETCH_H__
@@ -0,0 +1,143 @@
+/*
+ * Huge-page item buffers with parallel first touch.
+ *
+ */
+
+#include "ItemBuffer.h"
+#include "ParallelSelect.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+
+// mapped buffers and their mapped lengths; calloc buffers are not listed
+static std::map<void *, size_t> mapped;
+static std::mutex mapped_lock;
+
+// bytes of the default hugetlbfs page, and of the pages free in its pool
+static void hugetlb_pool(long *page, long *free_bytes) {
+  *page = 0;
+  *free_bytes = 0;
+  FILE *fp = fopen("/proc/meminfo", "r");
+  if (!fp)
+    return;
+  char line[256];
+  long pages = 0, kb;
+  while (fgets(line, sizeof(line), fp)) {
+    if (sscanf(line, "HugePages_Free: %ld", &kb) == 1)
+      pages = kb;
+    else if (sscanf(line, "Hugepagesize: %ld kB", &kb) == 1)
+      *page = kb * 1024;
+  }
+  fclose(fp);
+  *free_bytes = pages * *page;
+}
+
+static void *map_pages(size_t bytes, size_t *length) {
+  const char *env = getenv("DPQ_HUGEPAGES");
+  const bool huge = !env || strcmp(env, "0");
+
+#ifdef MAP_HUGETLB
+  long page, free_bytes;
+  hugetlb_pool(&page, &free_bytes);
+  if (huge && page > 0 && free_bytes >= (long)bytes) {
+    *length = (bytes + page - 1) / page * page;
+    void *p = mmap(NULL, *length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+      return p;
+  }
+#endif
+
+  // align to a huge page, so that the whole buffer can be backed by them
+  *length = (bytes + ITEM_HUGE_PAGE - 1) / ITEM_HUGE_PAGE * ITEM_HUGE_PAGE;
+  char *raw = (char *)mmap(NULL, *length + ITEM_HUGE_PAGE,
+                           PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                           -1, 0);
+  if (raw == MAP_FAILED)
+    return NULL;
+  char *p = (char *)(((uintptr_t)raw + ITEM_HUGE_PAGE - 1) &
+                     ~(uintptr_t)(ITEM_HUGE_PAGE - 1));
+  if (p > raw)
+    munmap(raw, p - raw);
+  munmap(p + *length, raw + ITEM_HUGE_PAGE - p);
+#ifdef MADV_HUGEPAGE
+  if (huge)
+    madvise(p, *length, MADV_HUGEPAGE);
+#endif
+  return p;
+}
+
+void *item_alloc(size_t bytes, bool spread) {
+  if ((long)bytes < ITEM_HUGE_PAGE)
+    return calloc(bytes ? bytes : 1, 1);
+
+  size_t length;
+  char *p = (char *)map_pages(bytes, &length);
+  if (!p)
+    return calloc(bytes, 1);
+
+  // first touch, split across the pinned threads as the passes split the
+  // items, one write per page of the mapping
+  ItemPages got;
+  const long page = (item_pages(p, &got) == 0) ? got.page_kb * 1024 : 4096;
+  const long pages = (long)(length / page);
+  if (spread)
+    pselect_parallel(pselect_threads(0), pages,
+                     [&](int t, long begin, long end) {
+                       for (long i = begin; i < end; i++)
+                         ((volatile char *)p)[i * page] = 0;
+                     });
+
+  std::lock_guard<std::mutex> guard(mapped_lock);
+  mapped[p] = length;
+  return p;
+}
+
+void item_free(void *p) {
+  if (!p)
+    return;
+  {
+    std::lock_guard<std::mutex> guard(mapped_lock);
+    auto it = mapped.find(p);
+    if (it != mapped.end()) {
+      munmap(p, it->second);
+      mapped.erase(it);
+      return;
+    }
+  }
+  free(p);
+}
+
+int item_pages(const void *p, ItemPages *pages) {
+  FILE *fp = fopen("/proc/self/smaps", "r");
+  if (!fp)
+    return -1;
+  char line[512];
+  bool inside = false, found = false;
+  unsigned long begin, end;
+  long kb;
+  while (fgets(line, sizeof(line), fp)) {
+    // mapping lines start with its address range, field lines with a name
+    if (sscanf(line, "%lx-%lx ", &begin, &end) == 2) {
+      if (found)
+        break;
+      inside = (uintptr_t)p >= begin && (uintptr_t)p < end;
+      if (inside) {
+        found = true;
+        *pages = {4, 0, (long)((end - begin) / 1024)};
+      }
+    } else if (inside) {
+      if (sscanf(line, "KernelPageSize: %ld kB", &kb) == 1)
+        pages->page_kb = kb;
+      else if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+        pages->huge_kb = kb;
+    }
+  }
+  fclose(fp);
+  return found ? 0 : -1;
+}
@@ -0,0 +1,46 @@
+/*
+ * Allocation of the large item buffers (generated or imported streams and
+ * their narrower storage copies).
+ *
+ * item_alloc() maps the buffer instead of taking it from calloc: anonymous
+ * pages are zero already, so nothing is cleared twice. Buffers of at least
+ * ITEM_HUGE_PAGE bytes are backed by huge pages when the system has them,
+ * from the hugetlbfs pool if pages are reserved there, else as transparent
+ * huge pages (MADV_HUGEPAGE), which cuts the TLB misses of the passes over
+ * them. Every page is then touched first by the thread that will read its
+ * share in the multi-threaded passes (ParallelSelect.h, StreamStats.h),
+ * pinned to the same core in each, so that on NUMA machines each share
+ * lands on the node of its thread.
+ *
+ * Smaller buffers, and any buffer when mapping fails, come from calloc;
+ * item_free() releases either kind. item_pages() reports the pages a buffer
+ * actually got.
+ *
+ */
+
+#ifndef __ITEMBUFFER_H__
+#define __ITEMBUFFER_H__
+
+#include <cstddef>
+
+#define ITEM_HUGE_PAGE (2L << 20)
+
+// Zeroed buffer of bytes bytes, NULL if out of memory. With spread false its
+// pages are left to the first thread that writes them: a buffer that one
+// thread fills and its own tasks read then stays on that thread's node.
+void *item_alloc(size_t bytes, bool spread = true);
+
+// releases a buffer from item_alloc (NULL is ignored)
+void item_free(void *p);
+
+struct ItemPages {
+  long page_kb; // kernel page size of the mapping
+  long huge_kb; // part of it in transparent huge pages
+  long size_kb;
+};
+
+// Pages backing the buffer at p, read from /proc/self/smaps. Returns -1 if
+// they cannot be read (a calloc buffer is reported with its mapping).
+int item_pages(const void *p, ItemPages *pages);
+
+#endif //__ITEMBUFFER_H__
@@ -0,0 +1,284 @@
+/*
+ * Block-compressed format for integer (fixed-point) items.
+ *
+ */
+
+#include "ItemCodec.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ITEM_X86 1
+#endif
+
+int item_codec_simd = 1;
+
+typedef void (*unpack_fn)(const uint32_t *in, int mode, int32_t reference,
+                          int *out);
+
+static inline uint32_t zigzag(int32_t x) {
+  return ((uint32_t)x << 1) ^ (uint32_t)(x >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t x) {
+  return (int32_t)((x >> 1) ^ (0u - (x & 1)));
+}
+
+template <int W> static inline uint32_t width_mask() {
+  return (W == 32) ? 0xffffffffu : ((1u << W) - 1);
+}
+
+template <int W>
+static void unpack_scalar(const uint32_t *in, int mode, int32_t reference,
+                          int *out) {
+  uint32_t prev[ITEM_LANES];
+  for (int l = 0; l < ITEM_LANES; l++)
+    prev[l] = (uint32_t)reference;
+
+  for (int k = 0; k < ITEM_BLOCK / ITEM_LANES; k++) {
+    const int off = k * W;
+    const int word = off >> 5;
+    const int shift = off & 31;
+    for (int l = 0; l < ITEM_LANES; l++) {
+      uint32_t v = 0;
+      if (W > 0) {
+        v = in[word * ITEM_LANES + l] >> shift;
+        if (shift + W > 32)
+          v |= in[(word + 1) * ITEM_LANES + l] << (32 - shift);
+        v &= width_mask<W>();
+      }
+      if (mode == ITEM_DELTA) {
+        prev[l] += (uint32_t)unzigzag(v);
+        out[k * ITEM_LANES + l] = (int32_t)prev[l];
+      } else {
+        out[k * ITEM_LANES + l] = (int32_t)((uint32_t)reference + v);
+      }
+    }
+  }
+}
+
+#ifdef ITEM_X86
+template <int W>
+__attribute__((target("avx2"))) static void
+unpack_avx2(const uint32_t *in, int mode, int32_t reference, int *out) {
+  const __m256i mask = _mm256_set1_epi32((int)width_mask<W>());
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i ref = _mm256_set1_epi32(reference);
+  __m256i prev = ref;
+
+  for (int k = 0; k < ITEM_BLOCK / ITEM_LANES; k++) {
+    const int off = k * W;
+    const int word = off >> 5;
+    const int shift = off & 31;
+    __m256i v = _mm256_setzero_si256();
+    if (W > 0) {
+      v = _mm256_srli_epi32(
+          _mm256_loadu_si256((const __m256i *)(in + word * ITEM_LANES)), shift);
+      if (shift + W > 32)
+        v = _mm256_or_si256(
+            v, _mm256_slli_epi32(_mm256_loadu_si256((const __m256i *)(
+                                     in + (word + 1) * ITEM_LANES)),
+                                 32 - shift));
+      v = _mm256_and_si256(v, mask);
+    }
+    if (mode == ITEM_DELTA) {
+      // unzigzag: (v >> 1) ^ -(v & 1)
+      __m256i d = _mm256_xor_si256(
+          _mm256_srli_epi32(v, 1),
+          _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(v, one)));
+      prev = _mm256_add_epi32(prev, d);
+      _mm256_storeu_si256((__m256i *)(out + k * ITEM_LANES), prev);
+    } else {
+      _mm256_storeu_si256((__m256i *)(out + k * ITEM_LANES),
+                          _mm256_add_epi32(v, ref));
+    }
+  }
+}
+#endif
+
+#define UNPACK_ROW(f, b) f<b>, f<b + 1>, f<b + 2>, f<b + 3>
+#define UNPACK_TABLE(f)                                                        \
+  {                                                                            \
+    UNPACK_ROW(f, 0), UNPACK_ROW(f, 4), UNPACK_ROW(f, 8), UNPACK_ROW(f, 12),   \
+        UNPACK_ROW(f, 16), UNPACK_ROW(f, 20), UNPACK_ROW(f, 24),               \
+        UNPACK_ROW(f, 28), f<32>                                               \
+  }
+
+static const unpack_fn scalar_table[33] = UNPACK_TABLE(unpack_scalar);
+#ifdef ITEM_X86
+static const unpack_fn avx2_table[33] = UNPACK_TABLE(unpack_avx2);
+#endif
+
+int item_codec_has_simd(void) {
+#ifdef ITEM_X86
+  return __builtin_cpu_supports("avx2") != 0;
+#else
+  return 0;
+#endif
+}
+
+static int bit_width(uint32_t x) { return x ? 32 - __builtin_clz(x) : 0; }
+
+static void pack(const uint32_t *vals, int width, uint32_t *out) {
+  memset(out, 0, 32 * width);
+  if (!width)
+    return;
+  for (int k = 0; k < ITEM_BLOCK / ITEM_LANES; k++) {
+    const int off = k * width;
+    const int word = off >> 5;
+    const int shift = off & 31;
+    for (int l = 0; l < ITEM_LANES; l++) {
+      uint32_t v = vals[k * ITEM_LANES + l];
+      out[word * ITEM_LANES + l] |= v << shift;
+      if (shift + width > 32)
+        out[(word + 1) * ITEM_LANES + l] |= v >> (32 - shift);
+    }
+  }
+}
+
+size_t item_encode_block(const int *items, int count, unsigned char *out) {
+  int32_t block[ITEM_BLOCK];
+  uint32_t forv[ITEM_BLOCK];
+  uint32_t delta[ITEM_BLOCK];
+
+  // pad a partial block by repeating its last item
+  memcpy(block, items, count * sizeof(int));
+  for (int i = count; i < ITEM_BLOCK; i++)
+    block[i] = items[count - 1];
+
+  int32_t min = block[0];
+  for (int i = 1; i < ITEM_BLOCK; i++)
+    min = (block[i] < min) ? block[i] : min;
+
+  uint32_t for_or = 0;
+  uint32_t delta_or = 0;
+  for (int i = 0; i < ITEM_BLOCK; i++) {
+    forv[i] = (uint32_t)block[i] - (uint32_t)min;
+    int32_t before = (i < ITEM_LANES) ? block[0] : block[i - ITEM_LANES];
+    delta[i] = zigzag((int32_t)((uint32_t)block[i] - (uint32_t)before));
+    for_or |= forv[i];
+    delta_or |= delta[i];
+  }
+
+  ItemBlockHeader h;
+  h.count = count;
+  if (bit_width(delta_or) < bit_width(for_or)) {
+    h.mode = ITEM_DELTA;
+    h.width = bit_width(delta_or);
+    h.reference = block[0];
+  } else {
+    h.mode = ITEM_FOR;
+    h.width = bit_width(for_or);
+    h.reference = min;
+  }
+
+  memcpy(out, &h, sizeof(h));
+  pack((h.mode == ITEM_DELTA) ? delta : forv, h.width,
+       (uint32_t *)(out + sizeof(h)));
+  return sizeof(h) + 32 * h.width;
+}
+
+size_t item_block_size(const unsigned char *in) {
+  return sizeof(ItemBlockHeader) + 32 * in[2];
+}
+
+int item_block_check(const unsigned char *in) {
+  ItemBlockHeader h;
+  memcpy(&h, in, sizeof(h));
+  if (h.count == 0 || h.count > ITEM_BLOCK || h.width > 32 ||
+      h.mode > ITEM_DELTA)
+    return -1;
+  return 0;
+}
+
+int item_decode_block(const unsigned char *in, int *out) {
+  ItemBlockHeader h;
+  memcpy(&h, in, sizeof(h));
+  if (item_block_check(in))
+    return -1;
+  const uint32_t *payload = (const uint32_t *)(in + sizeof(h));
+
+#ifdef ITEM_X86
+  static const int simd = item_codec_has_simd();
+  if (simd && item_codec_simd) {
+    avx2_table[h.width](payload, h.mode, h.reference, out);
+    return h.count;
+  }
+#endif
+  scalar_table[h.width](payload, h.mode, h.reference, out);
+  return h.count;
+}
+
+void item_header_init(ItemFileHeader *h, uint32_t scale, uint64_t count) {
+  memset(h, 0, sizeof(*h));
+  memcpy(h->magic, "DPQI", 4);
+  h->version = ITEM_VERSION;
+  h->block = ITEM_BLOCK;
+  h->scale = scale;
+  h->count = count;
+}
+
+int item_header_check(const ItemFileHeader *h) {
+  if (memcmp(h->magic, "DPQI", 4))
+    return -1;
+  if (h->version != ITEM_VERSION || h->block != ITEM_BLOCK)
+    return -1;
+  return 0;
+}
+
+int item_writer_open(ItemWriter *w, const char *path, uint32_t scale) {
+  ItemFileHeader h;
+
+  memset(w, 0, sizeof(*w));
+  w->scale = scale;
+  w->fp = strcmp(path, "-") ? fopen(path, "wb") : stdout;
+  if (!w->fp) {
+    fprintf(stderr, "Error opening file %s\n", path);
+    return -1;
+  }
+  item_header_init(&h, scale, 0);
+  if (fwrite(&h, sizeof(h), 1, w->fp) != 1)
+    return -1;
+  w->bytes = sizeof(h);
+  return 0;
+}
+
+static int item_writer_flush(ItemWriter *w) {
+  unsigned char out[ITEM_MAX_BLOCK_BYTES];
+  size_t n = item_encode_block(w->pending, w->fill, out);
+  if (fwrite(out, 1, n, w->fp) != n)
+    return -1;
+  w->bytes += n;
+  w->fill = 0;
+  return 0;
+}
+
+int item_writer_put(ItemWriter *w, const int *items, long n) {
+  for (long i = 0; i < n; i++) {
+    w->pending[w->fill++] = items[i];
+    if (w->fill == ITEM_BLOCK && item_writer_flush(w))
+      return -1;
+  }
+  w->count += n;
+  return 0;
+}
+
+int item_writer_close(ItemWriter *w) {
+  int ret = 0;
+
+  if (w->fill && item_writer_flush(w))
+    ret = -1;
+  if (w->fp != stdout && fseek(w->fp, 0, SEEK_SET) == 0) {
+    ItemFileHeader h;
+    item_header_init(&h, w->scale, w->count);
+    if (fwrite(&h, sizeof(h), 1, w->fp) != 1)
+      ret = -1;
+  }
+  if (w->fp != stdout)
+    fclose(w->fp);
+  else
+    fflush(stdout);
+  w->fp = NULL;
+  return ret;
+}
@@ -0,0 +1,95 @@
+/*
+ * Block-compressed format for integer (fixed-point) items.
+ *
+ * A file is a 32 byte header followed by blocks of up to ITEM_BLOCK items.
+ * Every block has an 8 byte header (item count, bit width, mode, reference
+ * value) and a payload of 32 * width bytes. Items are bit-packed vertically
+ * in 8 lanes: item k * 8 + l is the k-th value of lane l, and the w-bit
+ * values of a lane are packed into 32-bit words interleaved with the other
+ * lanes, so a decoder can unpack 8 items with one vector shift and mask.
+ *
+ * ITEM_FOR blocks store item - reference, with reference the block minimum.
+ * ITEM_DELTA blocks store zigzag(item[i] - item[i - 8]), with the 8 items
+ * before the block taken to be equal to the reference; they suit smooth
+ * traces. The encoder picks the mode giving the smaller width.
+ *
+ * All fields are in native byte order, as ResultStore.h writes its blocks:
+ * a file is read on hosts of the byte order of the one that wrote it.
+ *
+ */
+
+#ifndef __ITEMCODEC_H__
+#define __ITEMCODEC_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#define ITEM_BLOCK 256
+#define ITEM_LANES 8
+#define ITEM_MAX_BLOCK_BYTES (8 + 32 * 32)
+#define ITEM_VERSION 1
+
+#define ITEM_FOR 0
+#define ITEM_DELTA 1
+
+struct ItemFileHeader {
+  char magic[4]; // "DPQI"
+  uint32_t version;
+  uint32_t block;  // items per block
+  uint32_t scale;  // fixed-point scale of the items (1000 for the binaries)
+  uint64_t count;  // number of items, 0 if unknown (e.g. written to a pipe)
+  uint64_t reserved;
+};
+
+struct ItemBlockHeader {
+  uint16_t count;
+  uint8_t width;
+  uint8_t mode;
+  int32_t reference;
+};
+
+// set to 0 to force the scalar decoder (used by the benchmark)
+extern int item_codec_simd;
+
+// 1 if the running CPU supports the vectorised decoder
+int item_codec_has_simd(void);
+
+// Encodes 1 <= count <= ITEM_BLOCK items into out, which must have room for
+// ITEM_MAX_BLOCK_BYTES. Returns the number of bytes written.
+size_t item_encode_block(const int *items, int count, unsigned char *out);
+
+// Returns 0 if the block header starting at in is one the encoder can
+// write: 1 <= count <= ITEM_BLOCK, width <= 32 and a known mode.
+int item_block_check(const unsigned char *in);
+
+// Returns the size in bytes of the block whose header starts at in. It is
+// meaningless for a width above 32: nothing after such a block can be framed.
+size_t item_block_size(const unsigned char *in);
+
+// Decodes the block starting at in into out, which must have room for
+// ITEM_BLOCK items. Returns the number of items in the block, or -1 without
+// decoding anything if its header fails item_block_check().
+int item_decode_block(const unsigned char *in, int *out);
+
+void item_header_init(ItemFileHeader *h, uint32_t scale, uint64_t count);
+
+// returns 0 if h is a valid header this version can read
+int item_header_check(const ItemFileHeader *h);
+
+struct ItemWriter {
+  FILE *fp;
+  int pending[ITEM_BLOCK];
+  int fill;
+  uint32_t scale;
+  uint64_t count;
+  uint64_t bytes;
+};
+
+int item_writer_open(ItemWriter *w, const char *path, uint32_t scale);
+int item_writer_put(ItemWriter *w, const int *items, long n);
+// flushes the last partial block and records the item count when the
+// output is seekable
+int item_writer_close(ItemWriter *w);
+
+#endif //__ITEMCODEC_H__
@@ -0,0 +1,213 @@
+/*
+ * Storage types for the item buffers read by the estimators.
+ *
+ * Items are generated (or imported) at full precision, which also gives the
+ * exact ground truth; the estimators can then run on a narrower copy:
+ *
+ *   LDP binaries:     f64 (double, default), f32 (float), q16 (16-bit
+ *                     fixed-point fraction of the stream range)
+ *   central binaries: i32 (int, default), i16 (16-bit offset from the
+ *                     minimum item, if the items span at most 65535 units)
+ *
+ * The full-precision buffer is released once the copy is made, so the
+ * estimator pass reads 2x (f32, i16) or 4x (q16) fewer bytes. Copies come
+ * from item_alloc (ItemBuffer.h) and are released with item_free.
+ *
+ */
+
+#ifndef __ITEMSTORAGE_H__
+#define __ITEMSTORAGE_H__
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <sys/resource.h>
+
+#include "ItemBuffer.h"
+#include "LdpKernels.h"
+#include "StreamInput.h"
+
+#define STORE_F64 0
+#define STORE_F32 1
+#define STORE_Q16 2
+#define STORE_I32 3
+#define STORE_I16 4
+
+// returns the STORE_* constant for name, -1 if unknown
+inline int storage_type(const char *name) {
+  static const char *names[] = {"f64", "f32", "q16", "i32", "i16"};
+  for (int i = 0; i < 5; i++)
+    if (!strcmp(name, names[i]))
+      return i;
+  return -1;
+}
+
+inline const char *storage_name(int type) {
+  static const char *names[] = {"f64", "f32", "q16", "i32", "i16"};
+  return names[type];
+}
+
+// float copy of items; *max_error is the largest rounding error
+inline float *store_f32(const double *items, long n, double *max_error) {
+  float *out = (float *)item_alloc(n * sizeof(float));
+  double err = 0.0;
+  if (!out)
+    return NULL;
+  for (long i = 0; i < n; i++) {
+    out[i] = (float)items[i];
+    double e = fabs((double)out[i] - items[i]);
+    err = (e > err) ? e : err;
+  }
+  *max_error = err;
+  return out;
+}
+
+// 16-bit fixed-point fractions of [smin, smin + range]; items outside it
+// (only with a public domain) are clamped to it, which is not counted as a
+// storage error
+inline uint16_t *store_q16(const double *items, long n, double smin,
+                           double range, double *max_error) {
+  uint16_t *out = (uint16_t *)item_alloc(n * sizeof(uint16_t));
+  const double scale = 65535.0 / range, step = range / 65535.0;
+  double err = 0.0;
+  if (!out)
+    return NULL;
+  for (long i = 0; i < n; i++) {
+    const double x = (items[i] - smin) * scale;
+    out[i] = (uint16_t)lround((x < 0.0) ? 0.0 : (x > 65535.0) ? 65535.0 : x);
+    const double v = (x < 0.0) ? smin : (x > 65535.0) ? smin + range : items[i];
+    double e = fabs(smin + out[i] * step - v);
+    err = (e > err) ? e : err;
+  }
+  *max_error = err;
+  return out;
+}
+
+// items - base as 16-bit unsigned offsets, NULL if some item is out of range
+// (unless clamp, which stores it as the nearest offset instead)
+inline uint16_t *store_i16(const int *items, long n, int base,
+                           bool clamp = false) {
+  uint16_t *out = (uint16_t *)item_alloc(n * sizeof(uint16_t));
+  if (!out)
+    return NULL;
+  for (long i = 0; i < n; i++) {
+    long v = (long)items[i] - base;
+    if (clamp)
+      v = (v < 0) ? 0 : (v > 65535) ? 65535 : v;
+    if (v < 0 || v > 65535) {
+      item_free(out);
+      return NULL;
+    }
+    out[i] = (uint16_t)v;
+  }
+  return out;
+}
+
+// peak resident set size of the process in megabytes
+inline long peak_rss_mb(void) {
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru))
+    return -1;
+  return ru.ru_maxrss / 1024; // kilobytes on Linux
+}
+
+// Parses the public domain of the LDP items, "<lo>,<hi>" with lo < hi.
+// Returns 0 on success, -1 on a malformed domain.
+inline int ldp_domain(const char *arg, double *lo, double *hi) {
+  char *end;
+  *lo = strtod(arg, &end);
+  if (end == arg || *end != ',')
+    return -1;
+  arg = end + 1;
+  *hi = strtod(arg, &end);
+  if (end == arg || *end != '\0' || !(*lo < *hi))
+    return -1;
+  return 0;
+}
+
+// feeds items to kernel, normalised with NormClip if clip, else NormRange
+template <typename Kernel, typename T>
+void ldp_update(Kernel &kernel, const T *items, long n, double smin,
+                double range, bool clip) {
+  if (clip)
+    kernel.update(items, n, NormClip{smin, 1.0 / range});
+  else
+    kernel.update(items, n, NormRange{smin, 1.0 / range});
+}
+
+// Feeds the n full-precision items of an LDP stream to kernel, after copying
+// them to the storage type and calling release() to free the originals.
+// [smin, smin + range] is the stream range, or a public domain whose outside
+// items are clamped to it if clip. Returns the processor time of the kernel
+// pass in seconds, or -1 if the copy cannot be allocated; *max_error is the
+// largest storage error.
+template <typename Kernel, typename Release>
+double ldp_run(Kernel &kernel, int type, double *items, long n, double smin,
+               double range, bool clip, Release release, double *max_error) {
+  clock_t begin_time, end_time;
+
+  *max_error = 0.0;
+  if (type == STORE_F32) {
+    float *stored = store_f32(items, n, max_error);
+    release();
+    if (!stored)
+      return -1;
+    begin_time = clock();
+    ldp_update(kernel, stored, n, smin, range, clip);
+    end_time = clock();
+    item_free(stored);
+  } else if (type == STORE_Q16) {
+    uint16_t *stored = store_q16(items, n, smin, range, max_error);
+    release();
+    if (!stored)
+      return -1;
+    begin_time = clock();
+    kernel.update(stored, n, NormQ16());
+    end_time = clock();
+    item_free(stored);
+  } else {
+    begin_time = clock();
+    ldp_update(kernel, items, n, smin, range, clip);
+    end_time = clock();
+    release();
+  }
+
+  return (double)(end_time - begin_time) / CLOCKS_PER_SEC;
+}
+
+// Feeds a text, binary or packed stream to kernel, as ldp_run feeds stored
+// items. A stream cannot be scanned for its range first: its items are
+// clamped to the public domain [smin, smin + range] with NormClip. Packed
+// items are fixed-point values, normalised without converting them back.
+// emit(count) is called as by stream_drive. Returns the number of items read;
+// *elapsed is the processor time of the pass, parsing included.
+template <typename Kernel, typename Emit>
+long ldp_stream(Kernel &kernel, StreamInput *in, double smin, double range,
+                long every_items, long every_ms, Emit emit, double *elapsed) {
+  clock_t begin_time = clock();
+  long n;
+
+  if (in->format == STREAM_PACKED) {
+    const double scale = in->scale;
+    n = stream_drive_items(
+        in, every_items, every_ms,
+        [&](const int *items, long m) {
+          kernel.update(items, m, NormClip{smin * scale, 1.0 / (range * scale)});
+        },
+        emit);
+  } else {
+    n = stream_drive(
+        in, every_items, every_ms,
+        [&](const double *values, long m) {
+          kernel.update(values, m, NormClip{smin, 1.0 / range});
+        },
+        emit);
+  }
+
+  *elapsed = (double)(clock() - begin_time) / CLOCKS_PER_SEC;
+  return n;
+}
+
+#endif //__ITEMSTORAGE_H__
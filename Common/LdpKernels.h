@@ -0,0 +1,348 @@
+/*
+ * Local differential privacy quantile estimators: EasyQuantile and Frugal-2U
+ * with the Square Wave mechanism, Frugal-1U with Randomized Response, and
+ * LDPQ. Every user perturbs its own item, normalised to [0, 1], before the
+ * estimator sees it.
+ *
+ * The estimators are fed incrementally, like those of Frugal.h, and are
+ * templated on the item storage type: a normaliser maps stored items to
+ * [0, 1] (NormRange for items stored as values, NormClip for values clamped
+ * to a public domain, NormQ16 for items stored as 16-bit fixed-point
+ * fractions of the range). Each estimator owns the generators it draws from,
+ * seeded as the binaries always seeded them.
+ *
+ */
+
+#ifndef __LDPKERNELS_H__
+#define __LDPKERNELS_H__
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#define EZQ_TOGGLE_THRESHOLD 0.7 // EasyQuantile: MAX_MIN mode above it
+
+// The Square Wave parameters the binaries derive from eps: l, the half width
+// of the wave (the binaries take it from -l if given), and q, the density
+// outside it.
+inline double square_wave_l(double eps) {
+  return (eps * exp(eps) - exp(eps) + 1) /
+         (2.0 * exp(eps) * (exp(eps) - 1 - eps));
+}
+
+inline double square_wave_q(double eps, double l) {
+  return 1 / (2 * l * exp(eps) + 1);
+}
+
+inline void square_wave_params(double eps, double *q, double *l) {
+  *l = square_wave_l(eps);
+  *q = square_wave_q(eps, *l);
+}
+
+// the EasyQuantile mode for quantile: MAX_MIN = 1, AVERAGE = 2
+inline int ezq_mode(double quantile) {
+  return (quantile > EZQ_TOGGLE_THRESHOLD) ? 1 : 2;
+}
+
+inline double square_wave_randomizer(double q, double l, double v,
+                                     std::mt19937 &gen1) {
+  std::uniform_real_distribution<double> unif(0, 1.0);
+  double u = unif(gen1);
+
+  double v_tilde = 0.0;
+  if (u >= 0 && u < v * q) {
+    v_tilde = u / q - l;
+  } else if (u >= v * q && v < (1 + (v - 1) * q)) {
+    v_tilde = 2 * l * (u - v * q) / (1 - q) + v - l;
+  } else if (u >= (1 + (v - 1) * q) && u <= 1) {
+    v_tilde = (u - 1 - (v - 1) * q) / q + v + l;
+  }
+
+  return v_tilde;
+}
+
+inline int randomized_response(int q, double p, int x, std::mt19937 &gen1) {
+  std::bernoulli_distribution bernoulli_p(p);
+  int u = bernoulli_p(gen1);
+
+  if (u) {
+    return (x > q) ? 1 : 0;
+  } else {
+    return (x > q) ? 0 : 1;
+  }
+}
+
+inline int ldp_randomized_response(double q, double r, double x,
+                                   std::mt19937 &gen1, std::mt19937 &gen2) {
+  std::bernoulli_distribution bernoulli_r(r);
+  std::bernoulli_distribution bernoulli_one_half(0.5);
+  int u = bernoulli_r(gen1);
+  int v = bernoulli_one_half(gen2);
+
+  if (u == 1) {
+    if (x > q)
+      return 1;
+    else
+      return 0;
+  } else {
+    return v;
+  }
+}
+
+// items stored as values in [smin, smin + range]; scale is 1 / range, so
+// that the per-item division becomes a multiplication
+struct NormRange {
+  double smin;
+  double scale;
+
+  template <typename T> double operator()(T v) const {
+    return ((double)v - smin) * scale;
+  }
+};
+
+// items of a public domain [smin, smin + range] that the stream may leave:
+// the normalised item is clamped to [0, 1], which keeps the mechanisms'
+// privacy guarantees for any item without a pass to find the stream range
+struct NormClip {
+  double smin;
+  double scale;
+
+  template <typename T> double operator()(T v) const {
+    const double x = ((double)v - smin) * scale;
+    return (x < 0.0) ? 0.0 : (x > 1.0) ? 1.0 : x;
+  }
+};
+
+// items stored as round((value - smin) / range * 65535)
+struct NormQ16 {
+  double operator()(uint16_t v) const { return v * (1.0 / 65535.0); }
+};
+
+struct EasyQuantile {
+  double quantile;
+  double q;
+  double l;
+  int mode; // MAX_MIN = 1, AVERAGE = 2
+  double norm_quantile;
+  double sum;
+  double min; // range of the perturbed items
+  double max;
+  double counter_low;
+  double counter_high;
+  long count;
+  std::mt19937 gen1;
+
+  EasyQuantile(double quantile, double q, double l, int mode, long seed)
+      : quantile(quantile), q(q), l(l), mode(mode), norm_quantile(0.0),
+        sum(0.0), min(std::numeric_limits<double>::max()),
+        max(std::numeric_limits<double>::min()), counter_low(0.0),
+        counter_high(0.0), count(0), gen1(seed) {}
+
+  template <typename T, typename Norm>
+  void update(const T *items, long n, Norm norm) {
+    for (long i = 0; i < n; ++i) {
+
+      double norm_item = norm(items[i]);
+
+      double number = square_wave_randomizer(q, l, norm_item, gen1);
+
+      count += 1;
+
+      if (count <= 1) {
+        norm_quantile = number;
+        continue;
+      }
+
+      double threshold = count * quantile;
+      double lambda = 0.0;
+
+      if (number < min)
+        min = number;
+      if (number > max)
+        max = number;
+
+      sum += number;
+
+      if (mode == 2)
+        lambda = ((sum / ((double)count)) / ((double)count - 1.0)) * 2.0;
+      if (mode == 1)
+        lambda = (max - min) / ((double)count);
+
+      int direction = number > norm_quantile;
+
+      if (!direction)
+        if (counter_low + 1.0 > threshold) {
+          norm_quantile -= lambda;
+          counter_high += 1.0;
+        } else
+          counter_low += 1.0;
+      else if (counter_high + 1.0 > (double)count - threshold) {
+        norm_quantile += lambda;
+        counter_low += 1.0;
+      } else
+        counter_high += 1.0;
+    }
+  }
+};
+
+// The first item initialises the estimate as is; every later item is
+// perturbed with the Square Wave mechanism and scaled to an integer by prec.
+struct Frugal2USW {
+  double quantile;
+  double q;
+  double l;
+  double prec;
+  int sign;
+  int stepsize;
+  int integer_norm_quantile;
+  int min; // range of the perturbed integer items
+  int max;
+  long count;
+  std::mt19937 gen1; // randomizer
+  std::mt19937 gen2; // update coin
+  std::uniform_real_distribution<> dis;
+
+  Frugal2USW(double quantile, double q, double l, double prec, long seed1,
+             long seed2)
+      : quantile(quantile), q(q), l(l), prec(prec), sign(1), stepsize(1),
+        integer_norm_quantile(0), min(std::numeric_limits<int>::max()),
+        max(std::numeric_limits<int>::min()), count(0), gen1(seed1),
+        gen2(seed2), dis(0.0, 1.0) {}
+
+  static int f(int x) { return 1; }
+
+  template <typename T, typename Norm>
+  void update(const T *items, long n, Norm norm) {
+    long i = 0;
+
+    // set the estimated quantile to the value of the first item
+    if (count == 0 && n > 0) {
+      integer_norm_quantile = norm(items[0]) * prec;
+      i = 1;
+    }
+
+    for (; i < n; ++i) {
+
+      float rnd = dis(gen2);
+
+      // 1. normalize item, 2. randomize, 3. make randomized item an integer
+      double norm_item = norm(items[i]);
+      double number = square_wave_randomizer(q, l, norm_item, gen1);
+      int integer_norm_item = number * prec;
+      min = (integer_norm_item < min) ? integer_norm_item : min;
+      max = (integer_norm_item > max) ? integer_norm_item : max;
+
+      if (integer_norm_item > integer_norm_quantile && rnd > 1.0 - quantile) {
+        stepsize += (sign > 0) ? f(stepsize) : -f(stepsize);
+        integer_norm_quantile += (stepsize > 0) ? stepsize : 1;
+        sign = 1;
+
+        if (integer_norm_quantile > integer_norm_item) {
+          stepsize += integer_norm_item - integer_norm_quantile;
+          integer_norm_quantile = integer_norm_item;
+        }
+      } else {
+        if (integer_norm_item < integer_norm_quantile && rnd > quantile) {
+
+          stepsize += (sign < 0) ? f(stepsize) : -f(stepsize);
+          integer_norm_quantile -= (stepsize > 0) ? stepsize : 1;
+          sign = -1;
+
+          if (integer_norm_quantile < integer_norm_item) {
+            stepsize += integer_norm_quantile - integer_norm_item;
+            integer_norm_quantile = integer_norm_item;
+          }
+        }
+      }
+
+      if ((integer_norm_quantile - integer_norm_item) * sign < 0 &&
+          stepsize > 1) {
+        stepsize = 1;
+      }
+    }
+
+    count += n;
+  }
+};
+
+// The first item initialises the estimate as is; every later user answers
+// whether its item is above the current estimate with Randomized Response.
+struct Frugal1URR {
+  double quantile;
+  double p;
+  double prec;
+  int integer_norm_quantile;
+  long count;
+  std::mt19937 gen1; // randomized response
+  std::mt19937 gen3; // update coin
+  std::uniform_real_distribution<> dis;
+
+  Frugal1URR(double quantile, double eps, double prec, long seed1, long seed3)
+      : quantile(quantile), p(exp(eps) / (exp(eps) + 1)), prec(prec),
+        integer_norm_quantile(0), count(0), gen1(seed1), gen3(seed3),
+        dis(0.0, 1.0) {}
+
+  template <typename T, typename Norm>
+  void update(const T *items, long n, Norm norm) {
+    long i = 0;
+
+    // set the estimated quantile to the value of the first item
+    if (count == 0 && n > 0) {
+      integer_norm_quantile = norm(items[0]) * prec;
+      i = 1;
+    }
+
+    for (; i < n; ++i) {
+
+      double norm_item = norm(items[i]);
+      int integer_norm_item = norm_item * prec;
+      int s = randomized_response(integer_norm_quantile, p, integer_norm_item,
+                                  gen1);
+
+      float rnd = dis(gen3);
+      if (s && rnd > 1.0 - quantile)
+        integer_norm_quantile += 1;
+      else if (!s && rnd > quantile)
+        integer_norm_quantile -= 1;
+    }
+
+    count += n;
+  }
+};
+
+// qn is the stochastic approximation iterate, Qn its running average (the
+// released estimate)
+struct LDPQ {
+  double quantile;
+  double r;
+  long n;
+  double qn;
+  double Qn;
+  std::mt19937 gen1;
+  std::mt19937 gen2;
+
+  LDPQ(double quantile, double eps, long seed1, long seed2)
+      : quantile(quantile), r(std::tanh(eps / 2.0)), n(0), qn(0.0), Qn(0.0),
+        gen1(seed1), gen2(seed2) {}
+
+  template <typename T, typename Norm>
+  void update(const T *items, long len, Norm norm) {
+    for (long i = 0; i < len; i++) {
+      n = n + 1;
+      double stepsize = 2 / (std::pow((double)n, 0.51) + 100.0);
+
+      double norm_item = norm(items[i]);
+
+      int s = ldp_randomized_response(qn, r, norm_item, gen1, gen2);
+      if (s == 1)
+        qn = qn + ((1.0 - r + 2.0 * quantile * r) / 2.0) * stepsize;
+      else
+        qn = qn - ((1.0 + r - 2.0 * quantile * r) / 2.0) * stepsize;
+
+      Qn = ((n - 1) * Qn + qn) / n;
+    }
+  }
+};
+
+#endif //__LDPKERNELS_H__
@@ -0,0 +1,270 @@
+/*
+ * Out-of-core runs: streams of more items than fit in memory are produced a
+ * segment at a time by a replayable source and never held whole. replay(f)
+ * must call f(items, m) on consecutive segments of the same items every time
+ * it is called; the binaries replay generated items by restarting the
+ * generator from its initial state.
+ *
+ * OocSelect finds the exact items of given ranks with a few passes over the
+ * source. Items map to order-preserving 64-bit keys, resolved OOC_BITS at a
+ * time as in RadixSelect.h: update() counts the top bits of every item during
+ * the estimator pass, and each later pass counts, for the ranks still open,
+ * the next bits of the items whose key starts with the bits found so far.
+ * Once the items sharing a prefix fit in OOC_GATHER_MB they are gathered by
+ * one more pass and selected in memory; the prefixes gathered in one pass
+ * share that budget, and those left out are counted further meanwhile. A
+ * prefix holding more items than that, but no more than the scratch budget,
+ * is first spilled to a file in the scratch directory, and its later passes
+ * read the file instead of replaying the source.
+ *
+ * Scratch files take at most $DPQ_SCRATCH_MB megabytes (default
+ * OOC_SCRATCH_MB) and are unlinked as soon as they are created; memory is
+ * bounded by OOC_GATHER_MB plus a histogram of 512 KB per open rank.
+ *
+ */
+
+#ifndef __OUTOFCORE_H__
+#define __OUTOFCORE_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "QuickSelect.h"
+
+#define OOC_SEGMENT (1L << 22) // items generated or read at a time
+#define OOC_GATHER_MB 1024
+#define OOC_SCRATCH_MB 16384
+#define OOC_BITS 16
+#define OOC_BUCKETS (1L << OOC_BITS)
+
+inline uint64_t ooc_key(int x) {
+  return (uint64_t)((uint32_t)x ^ 0x80000000u) << 32;
+}
+
+inline uint64_t ooc_key(double x) {
+  uint64_t b;
+  memcpy(&b, &x, sizeof(b));
+  return (b >> 63) ? ~b : b | (1ull << 63);
+}
+
+inline void ooc_item(uint64_t key, int *x) {
+  *x = (int)((uint32_t)(key >> 32) ^ 0x80000000u);
+}
+
+inline void ooc_item(uint64_t key, double *x) {
+  uint64_t b = (key >> 63) ? key & ~(1ull << 63) : ~key;
+  memcpy(x, &b, sizeof(b));
+}
+
+// a scratch file in dir, already unlinked; NULL on failure
+inline FILE *ooc_scratch_open(const std::string &dir) {
+  std::string path = dir + "/dpq-scratch-XXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  int fd = mkstemp(name.data());
+  if (fd < 0)
+    return NULL;
+  unlink(name.data());
+  FILE *f = fdopen(fd, "w+b");
+  if (!f)
+    close(fd);
+  return f;
+}
+
+template <typename T> struct OocSelect {
+  std::string scratch_dir;
+  long scratch_items; // scratch budget left
+  long gather_items; // gather budget of a pass
+  long n;                // items given to update
+  std::vector<long> top; // counts of the top OOC_BITS bits of their keys
+
+  OocSelect(const char *dir)
+      : scratch_dir(dir), gather_items(OOC_GATHER_MB * (1L << 20) / sizeof(T)),
+        n(0), top(OOC_BUCKETS, 0) {
+    const char *env = getenv("DPQ_SCRATCH_MB");
+    long mb = env ? strtol(env, NULL, 10) : OOC_SCRATCH_MB;
+    scratch_items = mb * (1L << 20) / (long)sizeof(T);
+  }
+
+  void update(const T *items, long m) {
+    for (long i = 0; i < m; i++)
+      top[ooc_key(items[i]) >> (64 - OOC_BITS)]++;
+    n += m;
+  }
+
+  // Items sharing the first bits bits of their keys, all read from one
+  // source (-1 for the replayed stream, else a scratch file). Its ranks are
+  // local to it and ascending.
+  struct Node {
+    int source;
+    uint64_t prefix;
+    int bits;
+    long count;
+    std::vector<int> members;
+    int action;
+    std::vector<long> hist;
+    std::vector<T> items;
+    int file; // scratch file being written, for SPILL
+  };
+  enum { COUNT, GATHER, SPILL };
+
+  // Stores in out[i] the item of rank ranks[i] (0-based, ascending) of the n
+  // items given to update. Returns the number of passes it took, or -1 if a
+  // scratch file cannot be written.
+  template <typename Replay>
+  int select(Replay replay, const long *ranks, int m, T *out) {
+    std::vector<uint64_t> prefix(m);
+    std::vector<int> bits(m, OOC_BITS), source(m, -1);
+    std::vector<long> local(m), count(m);
+    std::vector<char> open(m, 1);
+    std::vector<FILE *> files;
+
+    for (int i = 0; i < m; i++) {
+      local[i] = (ranks[i] < n) ? ranks[i] : n - 1;
+      long b = 0;
+      while (local[i] >= top[b])
+        local[i] -= top[b++];
+      prefix[i] = (uint64_t)b << (64 - OOC_BITS);
+      count[i] = top[b];
+    }
+
+    // ooc_key(int) leaves the low 32 bits zero
+    const int key_bits = 8 * (int)sizeof(T);
+    int passes = 0, status = 0;
+    for (;;) {
+      // group the open ranks by prefix
+      std::vector<Node> nodes;
+      for (int i = 0; i < m; i++) {
+        if (!open[i])
+          continue;
+        if (bits[i] == key_bits) {
+          // every key bit is known: the items are all equal
+          ooc_item(prefix[i], &out[i]);
+          open[i] = 0;
+          continue;
+        }
+        if (nodes.empty() || nodes.back().source != source[i] ||
+            nodes.back().prefix != prefix[i] || nodes.back().bits != bits[i])
+          nodes.push_back({source[i], prefix[i], bits[i], count[i], {}, COUNT,
+                           {}, {}, -1});
+        nodes.back().members.push_back(i);
+      }
+      if (nodes.empty())
+        break;
+
+      long gather_left = gather_items;
+      for (Node &node : nodes) {
+        if (node.count <= gather_left) {
+          node.action = GATHER;
+          node.items.reserve(node.count);
+          gather_left -= node.count;
+        } else if (node.count <= gather_items) {
+          // gathered by a later pass, once smaller
+          node.action = COUNT;
+          node.hist.assign(OOC_BUCKETS, 0);
+        } else if (node.source < 0 && node.count <= scratch_items) {
+          FILE *f = ooc_scratch_open(scratch_dir);
+          if (!f) {
+            status = -1;
+            break;
+          }
+          node.action = SPILL;
+          node.file = (int)files.size();
+          files.push_back(f);
+          scratch_items -= node.count;
+        } else {
+          node.action = COUNT;
+          node.hist.assign(OOC_BUCKETS, 0);
+        }
+      }
+      if (status < 0)
+        break;
+
+      // one pass over every source some node reads
+      std::vector<int> sources;
+      for (const Node &node : nodes)
+        sources.push_back(node.source);
+      std::sort(sources.begin(), sources.end());
+      sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+      for (int s : sources) {
+        auto scan = [&](const T *items, long k) {
+          for (Node &node : nodes) {
+            if (node.source != s)
+              continue;
+            const int shift = 64 - node.bits;
+            const uint64_t want = node.prefix >> shift;
+            for (long j = 0; j < k; j++) {
+              const uint64_t key = ooc_key(items[j]);
+              if ((key >> shift) != want)
+                continue;
+              if (node.action == COUNT)
+                node.hist[(key >> (shift - OOC_BITS)) & (OOC_BUCKETS - 1)]++;
+              else if (node.action == GATHER)
+                node.items.push_back(items[j]);
+              else if (fwrite(&items[j], sizeof(T), 1, files[node.file]) != 1)
+                status = -1;
+            }
+          }
+        };
+        if (s < 0) {
+          replay(scan);
+        } else {
+          std::vector<T> buf(OOC_SEGMENT);
+          rewind(files[s]);
+          long k;
+          while ((k = fread(buf.data(), sizeof(T), OOC_SEGMENT, files[s])) > 0)
+            scan(buf.data(), k);
+        }
+        passes++;
+      }
+      if (status < 0)
+        break;
+
+      for (Node &node : nodes) {
+        if (node.action == GATHER) {
+          std::vector<long> r;
+          std::vector<T> o(node.members.size());
+          for (int i : node.members)
+            r.push_back(local[i]);
+          multi_select(node.items.data(), (long)node.items.size(), r.data(),
+                       (int)r.size(), o.data());
+          for (size_t j = 0; j < node.members.size(); j++) {
+            out[node.members[j]] = o[j];
+            open[node.members[j]] = 0;
+          }
+        } else if (node.action == SPILL) {
+          if (fflush(files[node.file])) {
+            status = -1;
+            break;
+          }
+          for (int i : node.members)
+            source[i] = node.file;
+        } else {
+          const int shift = 64 - node.bits - OOC_BITS;
+          for (int i : node.members) {
+            long b = 0;
+            while (local[i] >= node.hist[b])
+              local[i] -= node.hist[b++];
+            prefix[i] |= (uint64_t)b << shift;
+            bits[i] += OOC_BITS;
+            count[i] = node.hist[b];
+          }
+        }
+      }
+      if (status < 0)
+        break;
+    }
+
+    for (FILE *f : files)
+      fclose(f);
+    return (status < 0) ? -1 : passes;
+  }
+};
+
+#endif //__OUTOFCORE_H__
@@ -0,0 +1,284 @@
+/*
+ * Multi-threaded exact selection: parallel_select(items, n, k) returns the
+ * k-th smallest (0-based) of the n items, the value std::nth_element would
+ * place at position k. The items are not modified.
+ *
+ * A sorted sample of the items gives up to PSELECT_SPLITTERS distinct
+ * splitters, which cut the value domain into buckets: one bucket for each
+ * splitter value and one for each open interval between them. The threads
+ * count the items of every bucket over their share of the array; the bucket
+ * holding rank k is found from the merged counts. If it is a splitter value
+ * that is the answer, otherwise its items are gathered (in parallel, at
+ * offsets given by the per-thread counts) and the search recurses on them.
+ * Buckets of at most PSELECT_SERIAL items are finished with introselect.
+ *
+ * parallel_multi_select does the same for several ranks at once: one
+ * counting pass places all of them, and the buckets holding any are gathered
+ * in one more pass.
+ *
+ * Equality buckets keep heavily duplicated inputs from stalling the
+ * recursion; the sample is drawn at pseudo-random positions so that sorted
+ * or periodic inputs do not bias the splitters.
+ *
+ * Thread t of a pass is pinned to the t-th core the process may run on, as
+ * worker t of a TaskPool is, so the first touch of an item buffer
+ * (ItemBuffer.h) and every later pass over it split it the same way.
+ *
+ */
+
+#ifndef __PARALLELSELECT_H__
+#define __PARALLELSELECT_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+#include "QuickSelect.h"
+
+#define PSELECT_SERIAL (1L << 18)
+#define PSELECT_SPLITTERS 255 // 2^b - 1
+#define PSELECT_SAMPLE 8192
+
+// The cores this process may run on, thread t going to the t-th of them;
+// empty unless each of threads threads can have its own.
+inline std::vector<int> pselect_cpus(int threads) {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    for (int c = 0; c < CPU_SETSIZE; c++)
+      if (CPU_ISSET(c, &set))
+        cpus.push_back(c);
+  if ((int)cpus.size() < threads)
+    cpus.clear();
+  return cpus;
+}
+
+// pins the calling thread to cpu
+inline void pselect_pin(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// runs f(t, begin, end) on threads contiguous shares of [0, n), thread t
+// pinned to pselect_cpus(threads)[t]
+template <typename F> void pselect_parallel(int threads, long n, F f) {
+  if (threads == 1) {
+    f(0, 0L, n);
+    return;
+  }
+  const std::vector<int> cpus = pselect_cpus(threads);
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++)
+    pool.emplace_back([&, t]() {
+      if (!cpus.empty())
+        pselect_pin(cpus[t]);
+      f(t, n * t / threads, n * (t + 1) / threads);
+    });
+  for (auto &th : pool)
+    th.join();
+}
+
+inline int pselect_threads(int threads) {
+  if (threads <= 0)
+    threads = std::thread::hardware_concurrency();
+  return (threads > 0) ? threads : 1;
+}
+
+// Bucket of x given j, the number of the first PSELECT_SPLITTERS padded
+// splitters less than x.
+template <typename T>
+inline long pselect_bucket(const T *sp, long m, long j, T x) {
+  j += (sp[j] < x);
+  if (j >= m)
+    return (sp[m - 1] < x) ? 2 * m : 2 * m - 1;
+  return 2 * j + !(x < sp[j]);
+}
+
+// Selects the ranks (ascending) among the n items at src into out. work is
+// src when the items are a scratch copy that may be reordered, else NULL.
+template <typename T>
+void pselect_multi(const T *src, T *work, long n, const long *ranks, int m,
+                   T *out, int threads, uint64_t *state) {
+  if (n <= PSELECT_SERIAL) {
+    std::vector<T> copy;
+    if (!work) {
+      copy.assign(src, src + n);
+      work = copy.data();
+    }
+    multi_select(work, n, ranks, m, out);
+    return;
+  }
+
+  // splitters: evenly spaced order statistics of a random sample
+  std::vector<T> sample(PSELECT_SAMPLE);
+  for (long i = 0; i < PSELECT_SAMPLE; i++) {
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    sample[i] = src[(*state >> 11) % (uint64_t)n];
+  }
+  std::sort(sample.begin(), sample.end());
+  std::vector<T> splitters;
+  for (long j = 1; j <= PSELECT_SPLITTERS; j++) {
+    T s = sample[j * PSELECT_SAMPLE / (PSELECT_SPLITTERS + 1)];
+    if (splitters.empty() || splitters.back() < s)
+      splitters.push_back(s);
+  }
+  const long m_split = splitters.size();
+  const long buckets = 2 * m_split + 1;
+
+  // pad to PSELECT_SPLITTERS + 1 entries for the branchless search
+  std::vector<T> padded(splitters);
+  padded.resize(PSELECT_SPLITTERS + 1, splitters.back());
+  const T *sp = padded.data();
+
+  // bucket 2j + 1 holds the items equal to splitter j, bucket 2j those
+  // between splitters j - 1 and j
+  std::vector<long> counts(threads * buckets, 0);
+  pselect_parallel(threads, n, [&](int t, long begin, long end) {
+    long *c = counts.data() + t * buckets;
+    long i = begin;
+    // four independent searches at a time hide the load latency
+    for (; i + 4 <= end; i += 4) {
+      const T x0 = src[i], x1 = src[i + 1], x2 = src[i + 2], x3 = src[i + 3];
+      long j0 = 0, j1 = 0, j2 = 0, j3 = 0;
+      for (long step = (PSELECT_SPLITTERS + 1) / 2; step > 0; step >>= 1) {
+        j0 += (sp[j0 + step - 1] < x0) ? step : 0;
+        j1 += (sp[j1 + step - 1] < x1) ? step : 0;
+        j2 += (sp[j2 + step - 1] < x2) ? step : 0;
+        j3 += (sp[j3 + step - 1] < x3) ? step : 0;
+      }
+      c[pselect_bucket(sp, m_split, j0, x0)]++;
+      c[pselect_bucket(sp, m_split, j1, x1)]++;
+      c[pselect_bucket(sp, m_split, j2, x2)]++;
+      c[pselect_bucket(sp, m_split, j3, x3)]++;
+    }
+    for (; i < end; i++) {
+      const T x = src[i];
+      long j = 0;
+      for (long step = (PSELECT_SPLITTERS + 1) / 2; step > 0; step >>= 1)
+        j += (sp[j + step - 1] < x) ? step : 0;
+      c[pselect_bucket(sp, m_split, j, x)]++;
+    }
+  });
+
+  // Walk the buckets and the ranks together. A rank in a splitter bucket is
+  // that splitter; the ranks in an open interval form a group, whose items
+  // are gathered and searched again.
+  struct Group {
+    long bucket;
+    int first; // index of its first rank
+    int count;
+    long size;
+  };
+  std::vector<Group> groups;
+  std::vector<long> local(ranks, ranks + m);
+  long before = 0;
+  int r = 0;
+  for (long b = 0; b < buckets && r < m; b++) {
+    long total = 0;
+    for (int t = 0; t < threads; t++)
+      total += counts[t * buckets + b];
+    int first = r;
+    while (r < m && ranks[r] < before + total) {
+      if (b & 1)
+        out[r] = splitters[b / 2];
+      local[r++] -= before;
+    }
+    if (r > first && !(b & 1))
+      groups.push_back({b, first, r - first, total});
+    before += total;
+  }
+  if (groups.empty())
+    return;
+  if (groups.size() == 1 && groups[0].size == n) {
+    // no progress, e.g. a degenerate sample
+    std::vector<T> copy;
+    if (!work) {
+      copy.assign(src, src + n);
+      work = copy.data();
+    }
+    multi_select(work, n, ranks, m, out);
+    return;
+  }
+
+  // gather every group at per-thread offsets, in one pass
+  const int g_count = groups.size();
+  std::vector<std::vector<T>> gathered(g_count);
+  std::vector<long> offset(g_count * (threads + 1), 0);
+  std::vector<T> lo(g_count), hi(g_count);
+  std::vector<char> has_lo(g_count), has_hi(g_count);
+  for (int g = 0; g < g_count; g++) {
+    const long j = groups[g].bucket / 2;
+    has_lo[g] = (j > 0);
+    has_hi[g] = (j < m_split);
+    lo[g] = has_lo[g] ? splitters[j - 1] : T();
+    hi[g] = has_hi[g] ? splitters[j] : T();
+    long *o = offset.data() + g * (threads + 1);
+    for (int t = 0; t < threads; t++)
+      o[t + 1] = o[t] + counts[t * buckets + groups[g].bucket];
+    gathered[g].resize(groups[g].size);
+  }
+  if (g_count == 1) {
+    pselect_parallel(threads, n, [&](int t, long begin, long end) {
+      T *o = gathered[0].data() + offset[t];
+      for (long i = begin; i < end; i++) {
+        const T x = src[i];
+        if ((!has_lo[0] || lo[0] < x) && (!has_hi[0] || x < hi[0]))
+          *o++ = x;
+      }
+    });
+  } else {
+    // find the bucket of every item again, then its group through slot
+    std::vector<int> slot(buckets, -1);
+    for (int g = 0; g < g_count; g++)
+      slot[groups[g].bucket] = g;
+    pselect_parallel(threads, n, [&](int t, long begin, long end) {
+      std::vector<T *> o(g_count);
+      for (int g = 0; g < g_count; g++)
+        o[g] = gathered[g].data() + offset[g * (threads + 1) + t];
+      for (long i = begin; i < end; i++) {
+        const T x = src[i];
+        long j = 0;
+        for (long step = (PSELECT_SPLITTERS + 1) / 2; step > 0; step >>= 1)
+          j += (sp[j + step - 1] < x) ? step : 0;
+        const int g = slot[pselect_bucket(sp, m_split, j, x)];
+        if (g >= 0)
+          *o[g]++ = x;
+      }
+    });
+  }
+
+  for (int g = 0; g < g_count; g++) {
+    const Group &gr = groups[g];
+    pselect_multi(gathered[g].data(), gathered[g].data(), gr.size,
+                  local.data() + gr.first, gr.count, out + gr.first, threads,
+                  state);
+    std::vector<T>().swap(gathered[g]);
+  }
+}
+
+// Stores in out[i] the item of rank ranks[i] (0-based, ascending) of the n
+// items, which are not modified.
+template <typename T>
+void parallel_multi_select(const T *items, long n, const long *ranks, int m,
+                           T *out, int threads = 0) {
+  uint64_t state = 0x9e3779b97f4a7c15ull;
+  pselect_multi(items, (T *)NULL, n, ranks, m, out, pselect_threads(threads),
+                &state);
+}
+
+template <typename T>
+T parallel_select(const T *items, long n, long k, int threads = 0) {
+  if (k >= n)
+    k = n - 1;
+  T result = T();
+  parallel_multi_select(items, n, &k, 1, &result, threads);
+  return result;
+}
+
+#endif //__PARALLELSELECT_H__
@@ -0,0 +1,286 @@
+/*
+ * Vectorised partitioning for introselect.
+ *
+ */
+
+#include "QuickSelect.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define QSELECT_X86 1
+#endif
+
+int quickselect_simd = QSELECT_AVX512;
+
+int quickselect_has_simd(void) {
+#ifdef QSELECT_X86
+  static const int level = __builtin_cpu_supports("avx512f")
+                               ? QSELECT_AVX512
+                               : (__builtin_cpu_supports("avx2") ? QSELECT_AVX2
+                                                                 : QSELECT_SCALAR);
+  return level;
+#else
+  return QSELECT_SCALAR;
+#endif
+}
+
+static int simd_level(void) {
+  int level = quickselect_has_simd();
+  return (quickselect_simd < level) ? quickselect_simd : level;
+}
+
+#ifdef QSELECT_X86
+
+// Lane permutations for AVX2, which has no compress instruction: entry m
+// moves the lanes set in mask m to the bottom and the others to the top, both
+// in order. Each byte is the index of a 32-bit lane; a 64-bit lane l is
+// moved as the 32-bit lanes 2l and 2l + 1.
+struct PermTable {
+  uint64_t perm[256];
+};
+
+static constexpr PermTable perm_table(int lanes) {
+  PermTable t = {};
+  const int width = 8 / lanes;
+  for (int m = 0; m < (1 << lanes); m++) {
+    int pos = 0;
+    for (int pass = 0; pass < 2; pass++)
+      for (int l = 0; l < lanes; l++)
+        if (((m >> l) & 1) == (pass == 0)) {
+          for (int k = 0; k < width; k++)
+            t.perm[m] |= (uint64_t)(l * width + k) << (8 * (pos * width + k));
+          pos++;
+        }
+  }
+  return t;
+}
+
+static constexpr PermTable perm8 = perm_table(8);
+static constexpr PermTable perm4 = perm_table(4);
+
+#define AVX2 __attribute__((target("avx2,popcnt")))
+#define AVX512 __attribute__((target("avx512f,popcnt")))
+
+// The full-width stores of the AVX2 kernels write garbage past the items
+// they place; the partition loop keeps a vector of free room on both sides.
+struct Avx2Int {
+  typedef int type;
+  typedef __m256i vec;
+  enum { lanes = 8 };
+  AVX2 static vec load(const int *p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+  }
+  AVX2 static vec set1(int x) { return _mm256_set1_epi32(x); }
+  AVX2 static unsigned left(vec x, vec p, bool le) {
+    if (le)
+      return ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, p))) &
+             0xff;
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(p, x)));
+  }
+  AVX2 static void store(int *&lw, int *&rw, vec x, unsigned m) {
+    const __m256i idx =
+        _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)perm8.perm[m]));
+    const vec y = _mm256_permutevar8x32_epi32(x, idx);
+    const int c = _mm_popcnt_u32(m);
+    _mm256_storeu_si256((__m256i *)lw, y);
+    _mm256_storeu_si256((__m256i *)(rw - lanes), y);
+    lw += c;
+    rw -= lanes - c;
+  }
+};
+
+struct Avx2Float {
+  typedef float type;
+  typedef __m256 vec;
+  enum { lanes = 8 };
+  AVX2 static vec load(const float *p) { return _mm256_loadu_ps(p); }
+  AVX2 static vec set1(float x) { return _mm256_set1_ps(x); }
+  AVX2 static unsigned left(vec x, vec p, bool le) {
+    return _mm256_movemask_ps(le ? _mm256_cmp_ps(x, p, _CMP_LE_OQ)
+                                 : _mm256_cmp_ps(x, p, _CMP_LT_OQ));
+  }
+  AVX2 static void store(float *&lw, float *&rw, vec x, unsigned m) {
+    const __m256i idx =
+        _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)perm8.perm[m]));
+    const vec y = _mm256_permutevar8x32_ps(x, idx);
+    const int c = _mm_popcnt_u32(m);
+    _mm256_storeu_ps(lw, y);
+    _mm256_storeu_ps(rw - lanes, y);
+    lw += c;
+    rw -= lanes - c;
+  }
+};
+
+struct Avx2Double {
+  typedef double type;
+  typedef __m256d vec;
+  enum { lanes = 4 };
+  AVX2 static vec load(const double *p) { return _mm256_loadu_pd(p); }
+  AVX2 static vec set1(double x) { return _mm256_set1_pd(x); }
+  AVX2 static unsigned left(vec x, vec p, bool le) {
+    return _mm256_movemask_pd(le ? _mm256_cmp_pd(x, p, _CMP_LE_OQ)
+                                 : _mm256_cmp_pd(x, p, _CMP_LT_OQ));
+  }
+  AVX2 static void store(double *&lw, double *&rw, vec x, unsigned m) {
+    const __m256i idx =
+        _mm256_cvtepu8_epi32(_mm_cvtsi64_si128((long long)perm4.perm[m]));
+    const vec y = _mm256_castps_pd(
+        _mm256_permutevar8x32_ps(_mm256_castpd_ps(x), idx));
+    const int c = _mm_popcnt_u32(m);
+    _mm256_storeu_pd(lw, y);
+    _mm256_storeu_pd(rw - lanes, y);
+    lw += c;
+    rw -= lanes - c;
+  }
+};
+
+// AVX-512 compresses the two sides and stores them with exact masks.
+struct Avx512Int {
+  typedef int type;
+  typedef __m512i vec;
+  enum { lanes = 16 };
+  AVX512 static vec load(const int *p) { return _mm512_loadu_si512(p); }
+  AVX512 static vec set1(int x) { return _mm512_set1_epi32(x); }
+  AVX512 static unsigned left(vec x, vec p, bool le) {
+    return le ? _mm512_cmple_epi32_mask(x, p) : _mm512_cmplt_epi32_mask(x, p);
+  }
+  AVX512 static void store(int *&lw, int *&rw, vec x, unsigned m) {
+    const int c = _mm_popcnt_u32(m);
+    rw -= lanes - c;
+    _mm512_mask_storeu_epi32(lw, (__mmask16)((1u << c) - 1),
+                             _mm512_maskz_compress_epi32((__mmask16)m, x));
+    _mm512_mask_storeu_epi32(rw, (__mmask16)((1u << (lanes - c)) - 1),
+                             _mm512_maskz_compress_epi32((__mmask16)~m, x));
+    lw += c;
+  }
+};
+
+struct Avx512Float {
+  typedef float type;
+  typedef __m512 vec;
+  enum { lanes = 16 };
+  AVX512 static vec load(const float *p) { return _mm512_loadu_ps(p); }
+  AVX512 static vec set1(float x) { return _mm512_set1_ps(x); }
+  AVX512 static unsigned left(vec x, vec p, bool le) {
+    return le ? _mm512_cmp_ps_mask(x, p, _CMP_LE_OQ)
+              : _mm512_cmp_ps_mask(x, p, _CMP_LT_OQ);
+  }
+  AVX512 static void store(float *&lw, float *&rw, vec x, unsigned m) {
+    const int c = _mm_popcnt_u32(m);
+    rw -= lanes - c;
+    _mm512_mask_storeu_ps(lw, (__mmask16)((1u << c) - 1),
+                          _mm512_maskz_compress_ps((__mmask16)m, x));
+    _mm512_mask_storeu_ps(rw, (__mmask16)((1u << (lanes - c)) - 1),
+                          _mm512_maskz_compress_ps((__mmask16)~m, x));
+    lw += c;
+  }
+};
+
+struct Avx512Double {
+  typedef double type;
+  typedef __m512d vec;
+  enum { lanes = 8 };
+  AVX512 static vec load(const double *p) { return _mm512_loadu_pd(p); }
+  AVX512 static vec set1(double x) { return _mm512_set1_pd(x); }
+  AVX512 static unsigned left(vec x, vec p, bool le) {
+    return le ? _mm512_cmp_pd_mask(x, p, _CMP_LE_OQ)
+              : _mm512_cmp_pd_mask(x, p, _CMP_LT_OQ);
+  }
+  AVX512 static void store(double *&lw, double *&rw, vec x, unsigned m) {
+    const int c = _mm_popcnt_u32(m);
+    rw -= lanes - c;
+    _mm512_mask_storeu_pd(lw, (__mmask8)((1u << c) - 1),
+                          _mm512_maskz_compress_pd((__mmask8)m, x));
+    _mm512_mask_storeu_pd(rw, (__mmask8)((1u << (lanes - c)) - 1),
+                          _mm512_maskz_compress_pd((__mmask8)~m, x));
+    lw += c;
+  }
+};
+
+// In-place vectorised partition. The first and last vectors are set aside,
+// which leaves 2 * lanes free slots between what has been read and what has
+// been written; each vector is read from the side with fewer free slots, so
+// both sides have a full vector of room when it is written back. The items
+// left when less than a vector remains, and the two set aside, are placed one
+// at a time. n must be at least 2 * lanes. The loop is defined once per
+// instruction set because the target attribute cannot be a template argument.
+#define PARTITION_KERNEL(name, isa)                                            \
+  template <typename Ops>                                                      \
+  isa static long name(typename Ops::type *a, long n,                          \
+                       typename Ops::type pivot, bool le) {                    \
+    typedef typename Ops::type T;                                              \
+    const long W = Ops::lanes;                                                 \
+    const typename Ops::vec p = Ops::set1(pivot);                              \
+    T saved[2 * W];                                                            \
+    for (long i = 0; i < W; i++) {                                             \
+      saved[i] = a[i];                                                         \
+      saved[W + i] = a[n - W + i];                                             \
+    }                                                                          \
+    T *lr = a + W, *rr = a + n - W; /* unread: [lr, rr) */                     \
+    T *lw = a, *rw = a + n;         /* placed: [a, lw) and [rw, a + n) */      \
+    while (rr - lr >= W) {                                                     \
+      typename Ops::vec x;                                                     \
+      if (lr - lw <= rw - rr) {                                                \
+        x = Ops::load(lr);                                                     \
+        lr += W;                                                               \
+      } else {                                                                 \
+        rr -= W;                                                               \
+        x = Ops::load(rr);                                                     \
+      }                                                                        \
+      Ops::store(lw, rw, x, Ops::left(x, p, le));                              \
+    }                                                                          \
+    while (lr < rr) {                                                          \
+      const T x = (lr - lw <= rw - rr) ? *lr++ : *--rr;                        \
+      if (qselect_left(x, pivot, le))                                          \
+        *lw++ = x;                                                             \
+      else                                                                     \
+        *--rw = x;                                                             \
+    }                                                                          \
+    for (long i = 0; i < 2 * W; i++) {                                         \
+      if (qselect_left(saved[i], pivot, le))                                   \
+        *lw++ = saved[i];                                                      \
+      else                                                                     \
+        *--rw = saved[i];                                                      \
+    }                                                                          \
+    return lw - a;                                                             \
+  }
+
+PARTITION_KERNEL(partition_avx2, AVX2)
+PARTITION_KERNEL(partition_avx512, AVX512)
+
+#endif // QSELECT_X86
+
+template <typename Avx2Ops, typename Avx512Ops, typename T>
+static long partition(T *a, long n, T pivot, bool le) {
+#ifdef QSELECT_X86
+  const int level = simd_level();
+  if (level == QSELECT_AVX512 && n >= 4 * Avx512Ops::lanes)
+    return partition_avx512<Avx512Ops>(a, n, pivot, le);
+  if (level >= QSELECT_AVX2 && n >= 4 * Avx2Ops::lanes)
+    return partition_avx2<Avx2Ops>(a, n, pivot, le);
+#endif
+  return qselect_split<T *, T>(a, a + n, pivot, le) - a;
+}
+
+#ifndef QSELECT_X86
+struct Avx2Int {};
+struct Avx2Float {};
+struct Avx2Double {};
+struct Avx512Int {};
+struct Avx512Float {};
+struct Avx512Double {};
+#endif
+
+long quickselect_partition(int *a, long n, int pivot, bool le) {
+  return partition<Avx2Int, Avx512Int>(a, n, pivot, le);
+}
+
+long quickselect_partition(float *a, long n, float pivot, bool le) {
+  return partition<Avx2Float, Avx512Float>(a, n, pivot, le);
+}
+
+long quickselect_partition(double *a, long n, double pivot, bool le) {
+  return partition<Avx2Double, Avx512Double>(a, n, pivot, le);
+}
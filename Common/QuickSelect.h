@@ -0,0 +1,238 @@
+/*
+ * Introselect: quickselect with a worst-case fallback and vectorised
+ * partitioning.
+ *
+ * introselect(first, nth, last) has the contract of std::nth_element for any
+ * random access iterator over an ordered type: *nth becomes the item a full
+ * sort would put there, items before it are not greater and items after it
+ * are not smaller. quickselect(data, len, pos) keeps the interface of the
+ * Numerical Recipes routine it replaces and returns data[pos].
+ *
+ * Pivots are the median of 3 items (or the ninther of 9 on larger ranges);
+ * the range is partitioned by value, so a range holding many copies of the
+ * pivot is split off in one pass instead of degrading. Partitions that keep
+ * more than 7/8 of the range count against a budget of log2(n); once it is
+ * spent the pivots are chosen by median of medians, which bounds the work
+ * at O(n) whatever the input order.
+ *
+ * multi_select finds several ranks at once: each partition sends every rank
+ * to the side holding it, so the items are partitioned once for all of them
+ * until a side holds a single rank, which is left to introselect.
+ *
+ * Ranges of int, float or double given as pointers are partitioned with
+ * AVX-512 or AVX2 (QuickSelect.cpp) when the CPU supports them.
+ *
+ */
+
+#ifndef __QSELECT_H__
+#define __QSELECT_H__
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#define QSELECT_SMALL 16  // ranges finished by insertion sort
+#define QSELECT_NINTHER 128
+
+#define QSELECT_SCALAR 0
+#define QSELECT_AVX2 1
+#define QSELECT_AVX512 2
+
+// highest instruction set the partition may use (QSELECT_*); lowered by the
+// benchmark to compare them
+extern int quickselect_simd;
+
+// highest instruction set supported by the running CPU
+int quickselect_has_simd(void);
+
+// Reorders a[0, n) so that the items going left (less than pivot, or not
+// greater than pivot if le) come first; returns their number.
+long quickselect_partition(int *a, long n, int pivot, bool le);
+long quickselect_partition(float *a, long n, float pivot, bool le);
+long quickselect_partition(double *a, long n, double pivot, bool le);
+
+template <typename T> inline bool qselect_left(T x, T pivot, bool le) {
+  return le ? !(pivot < x) : x < pivot;
+}
+
+template <typename It, typename T>
+It qselect_split(It first, It last, T pivot, bool le) {
+  for (;;) {
+    while (first != last && qselect_left(*first, pivot, le))
+      ++first;
+    if (first == last)
+      return first;
+    --last;
+    while (first != last && !qselect_left(*last, pivot, le))
+      --last;
+    if (first == last)
+      return first;
+    std::iter_swap(first, last);
+    ++first;
+  }
+}
+
+inline int *qselect_split(int *first, int *last, int pivot, bool le) {
+  return first + quickselect_partition(first, last - first, pivot, le);
+}
+
+inline float *qselect_split(float *first, float *last, float pivot, bool le) {
+  return first + quickselect_partition(first, last - first, pivot, le);
+}
+
+inline double *qselect_split(double *first, double *last, double pivot,
+                             bool le) {
+  return first + quickselect_partition(first, last - first, pivot, le);
+}
+
+template <typename It> void qselect_insertion(It first, It last) {
+  if (first == last)
+    return;
+  for (It i = first + 1; i != last; ++i) {
+    auto x = std::move(*i);
+    It j = i;
+    for (; j != first && x < *(j - 1); --j)
+      *j = std::move(*(j - 1));
+    *j = std::move(x);
+  }
+}
+
+template <typename T> inline T qselect_median3(T a, T b, T c) {
+  if (b < a)
+    std::swap(a, b);
+  if (c < b)
+    b = (c < a) ? a : c;
+  return b;
+}
+
+template <typename It>
+typename std::iterator_traits<It>::value_type qselect_sample(It first,
+                                                             It last) {
+  const long n = last - first;
+  if (n < QSELECT_NINTHER)
+    return qselect_median3(*first, *(first + n / 2), *(last - 1));
+  const long s = n / 8;
+  It mid = first + n / 2;
+  return qselect_median3(qselect_median3(*first, *(first + s), *(first + 2 * s)),
+                         qselect_median3(*(mid - s), *mid, *(mid + s)),
+                         qselect_median3(*(last - 1 - 2 * s), *(last - 1 - s),
+                                         *(last - 1)));
+}
+
+template <typename It> void qselect_loop(It first, It nth, It last, int budget);
+
+// Median of medians of groups of 5: at least 3/10 of the items are not
+// smaller and 3/10 not greater than the returned value. Reorders the range.
+template <typename It>
+typename std::iterator_traits<It>::value_type qselect_mom(It first, It last) {
+  const long n = last - first;
+  if (n <= 5) {
+    qselect_insertion(first, last);
+    return *(first + (n - 1) / 2);
+  }
+  long groups = 0;
+  for (It g = first; last - g >= 5; g += 5, groups++) {
+    qselect_insertion(g, g + 5);
+    std::iter_swap(first + groups, g + 2);
+  }
+  qselect_loop(first, first + groups / 2, first + groups, -1);
+  return *(first + groups / 2);
+}
+
+// a negative budget selects every pivot by median of medians
+template <typename It>
+void qselect_loop(It first, It nth, It last, int budget) {
+  typedef typename std::iterator_traits<It>::value_type T;
+  // every item of the range is not smaller than lower, if has_lower
+  T lower = T();
+  bool has_lower = false;
+
+  while (last - first > QSELECT_SMALL) {
+    const long n = last - first;
+    const T pivot = (budget > 0) ? qselect_sample(first, last)
+                                 : qselect_mom(first, last);
+
+    if (has_lower && !(lower < pivot)) {
+      // the pivot is the smallest item: split off its copies
+      It mid = qselect_split(first, last, pivot, true);
+      if (nth < mid)
+        return;
+      first = mid;
+    } else {
+      It mid = qselect_split(first, last, pivot, false);
+      if (nth < mid) {
+        last = mid;
+      } else {
+        first = mid;
+        lower = pivot;
+        has_lower = true;
+      }
+    }
+
+    if (budget > 0 && last - first > n - n / 8)
+      budget--;
+  }
+  qselect_insertion(first, last);
+}
+
+template <typename It> void introselect(It first, It nth, It last) {
+  if (nth == last || last - first < 2)
+    return;
+  int budget = 1;
+  for (long n = last - first; n > 1; n >>= 1)
+    budget++;
+  qselect_loop(first, nth, last, budget);
+}
+
+template <typename T> T quickselect(T *data, long len, long pos) {
+  introselect(data, data + pos, data + len);
+  return data[pos];
+}
+
+// selects the ranks (absolute, ascending) that fall in items[lo, hi)
+template <typename T>
+void qselect_multi(T *items, long lo, long hi, const long *ranks, int m,
+                   T *out, int depth) {
+  if (m == 0)
+    return;
+  if (m == 1) {
+    introselect(items + lo, items + ranks[0], items + hi);
+    out[0] = items[ranks[0]];
+    return;
+  }
+  if (hi - lo <= QSELECT_SMALL || depth == 0) {
+    std::sort(items + lo, items + hi);
+    for (int i = 0; i < m; i++)
+      out[i] = items[ranks[i]];
+    return;
+  }
+
+  // [lo, lt) < pivot, [lt, le) == pivot, [le, hi) > pivot
+  const T pivot = qselect_sample(items + lo, items + hi);
+  const long lt = qselect_split(items + lo, items + hi, pivot, false) - items;
+  const long le = qselect_split(items + lt, items + hi, pivot, true) - items;
+
+  int left = 0;
+  while (left < m && ranks[left] < lt)
+    left++;
+  int right = left;
+  while (right < m && ranks[right] < le)
+    out[right++] = pivot;
+
+  qselect_multi(items, lo, lt, ranks, left, out, depth - 1);
+  qselect_multi(items, le, hi, ranks + right, m - right, out + right,
+                depth - 1);
+}
+
+// Stores in out[i] the item of rank ranks[i] (0-based, ascending) of the n
+// items, which are reordered.
+template <typename T>
+void multi_select(T *items, long n, const long *ranks, int m, T *out) {
+  // past this depth the pivots are failing: sort what is left
+  int depth = 4;
+  for (long k = n; k > 1; k >>= 1)
+    depth += 2;
+  qselect_multi(items, 0L, n, ranks, m, out, depth);
+}
+
+#endif //__QSELECT_H__
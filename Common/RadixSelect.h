@@ -0,0 +1,139 @@
+/*
+ * Exact selection on integer items by radix histograms: radix_select(items,
+ * n, k) returns the k-th smallest (0-based) of the n items, which must be an
+ * integer type of at most 32 bits. The items are neither copied nor moved.
+ *
+ * Items are mapped to order-preserving unsigned 32-bit keys. A first pass
+ * counts the keys by their top RADIX_BITS bits and finds the bucket holding
+ * rank k; a second pass counts the keys of that bucket by their low bits,
+ * which gives the item itself. Both passes are split across threads, each
+ * filling its own histogram, and the histograms are summed at the end.
+ * radix_multi_select finds several ranks with the same two passes.
+ *
+ */
+
+#ifndef __RADIXSELECT_H__
+#define __RADIXSELECT_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "ParallelSelect.h"
+
+#define RADIX_BITS 16
+#define RADIX_BUCKETS (1L << RADIX_BITS)
+#define RADIX_WAYS 4
+
+template <typename T> inline uint32_t radix_key(T x) {
+  static_assert(std::is_integral<T>::value && sizeof(T) <= 4,
+                "radix_select needs integer items of at most 32 bits");
+  if (std::is_signed<T>::value)
+    return (uint32_t)(int32_t)x ^ 0x80000000u;
+  return (uint32_t)x;
+}
+
+template <typename T> inline T radix_item(uint32_t key) {
+  if (std::is_signed<T>::value)
+    return (T)(int32_t)(key ^ 0x80000000u);
+  return (T)key;
+}
+
+// Sums the histograms at counts, stride counters apart, and returns the
+// bucket holding rank *k; *k becomes the rank within that bucket.
+inline long radix_find(const uint32_t *counts, long stride, int histograms,
+                       long *k) {
+  long before = 0;
+  for (long b = 0; b < RADIX_BUCKETS; b++) {
+    long total = 0;
+    for (int h = 0; h < histograms; h++)
+      total += counts[h * stride + b];
+    if (before + total > *k) {
+      *k -= before;
+      return b;
+    }
+    before += total;
+  }
+  return RADIX_BUCKETS - 1; // not reached for k < n
+}
+
+// Stores in out[i] the item of rank ranks[i] (0-based) of the n items. The
+// second pass refines every top bucket holding a rank at once.
+template <typename T>
+void radix_multi_select(const T *items, long n, const long *ranks, int m,
+                        T *out, int threads = 0) {
+  threads = pselect_threads(threads);
+  // keep the per-thread counts within 32 bits
+  while (n / threads >= (1L << 32))
+    threads++;
+
+  // Every thread counts into RADIX_WAYS interleaved histograms, so that runs
+  // of equal keys (common in fixed-point traces) do not serialise on one
+  // counter.
+  const long ways = RADIX_WAYS;
+  const int histograms = threads * ways;
+  long stride = RADIX_BUCKETS;
+  std::vector<uint32_t> counts(histograms * stride);
+
+  pselect_parallel(threads, n, [&](int t, long begin, long end) {
+    uint32_t *c = counts.data() + t * ways * stride;
+    long i = begin;
+    for (; i + ways <= end; i += ways)
+      for (long w = 0; w < ways; w++)
+        c[w * stride + (radix_key(items[i + w]) >> RADIX_BITS)]++;
+    for (; i < end; i++)
+      c[radix_key(items[i]) >> RADIX_BITS]++;
+  });
+
+  // slot[b] numbers the distinct top buckets holding a rank; the others map
+  // to a spare counter after the slots, which keeps the loop free of branches
+  std::vector<uint32_t> top(m);
+  std::vector<long> local(m);
+  std::vector<uint32_t> slot(RADIX_BUCKETS, 0);
+  std::vector<uint32_t> tops;
+  for (int i = 0; i < m; i++) {
+    local[i] = (ranks[i] < n) ? ranks[i] : n - 1;
+    top[i] = radix_find(counts.data(), stride, histograms, &local[i]);
+    if (std::find(tops.begin(), tops.end(), top[i]) == tops.end())
+      tops.push_back(top[i]);
+  }
+  const uint32_t spare = tops.size() * RADIX_BUCKETS;
+  std::fill(slot.begin(), slot.end(), spare);
+  for (size_t s = 0; s < tops.size(); s++)
+    slot[tops[s]] = s * RADIX_BUCKETS;
+
+  stride = spare + 1;
+  counts.assign(histograms * stride, 0);
+  const uint32_t *sl = slot.data();
+  pselect_parallel(threads, n, [&](int t, long begin, long end) {
+    uint32_t *c = counts.data() + t * ways * stride;
+    long i = begin;
+    for (; i + ways <= end; i += ways)
+      for (long w = 0; w < ways; w++) {
+        const uint32_t key = radix_key(items[i + w]);
+        const uint32_t s = sl[key >> RADIX_BITS];
+        c[w * stride + s + ((s == spare) ? 0 : (key & (RADIX_BUCKETS - 1)))]++;
+      }
+    for (; i < end; i++) {
+      const uint32_t key = radix_key(items[i]);
+      const uint32_t s = sl[key >> RADIX_BITS];
+      c[s + ((s == spare) ? 0 : (key & (RADIX_BUCKETS - 1)))]++;
+    }
+  });
+
+  for (int i = 0; i < m; i++) {
+    const uint32_t low = radix_find(counts.data() + slot[top[i]], stride,
+                                    histograms, &local[i]);
+    out[i] = radix_item<T>((top[i] << RADIX_BITS) | low);
+  }
+}
+
+template <typename T>
+T radix_select(const T *items, long n, long k, int threads = 0) {
+  T result = T();
+  radix_multi_select(items, n, &k, 1, &result, threads);
+  return result;
+}
+
+#endif //__RADIXSELECT_H__
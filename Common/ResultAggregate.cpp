@@ -0,0 +1,229 @@
+/*
+ * Online aggregation of result rows into one row per cell.
+ *
+ */
+
+#include "ResultAggregate.h"
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// continued fraction of the incomplete beta function (Lentz's method)
+static double beta_fraction(double a, double b, double x) {
+  const double tiny = 1e-300;
+  double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+  if (fabs(d) < tiny)
+    d = tiny;
+  d = 1.0 / d;
+  double h = d;
+  for (int m = 1; m <= 300; m++) {
+    const double m2 = 2.0 * m;
+    double aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+    d = 1.0 + aa * d;
+    d = (fabs(d) < tiny) ? 1.0 / tiny : 1.0 / d;
+    c = 1.0 + aa / c;
+    if (fabs(c) < tiny)
+      c = tiny;
+    h *= d * c;
+    aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+    d = 1.0 + aa * d;
+    d = (fabs(d) < tiny) ? 1.0 / tiny : 1.0 / d;
+    c = 1.0 + aa / c;
+    if (fabs(c) < tiny)
+      c = tiny;
+    const double step = d * c;
+    h *= step;
+    if (fabs(step - 1.0) < 1e-15)
+      break;
+  }
+  return h;
+}
+
+// regularized incomplete beta function I_x(a, b)
+static double incomplete_beta(double a, double b, double x) {
+  if (x <= 0.0)
+    return 0.0;
+  if (x >= 1.0)
+    return 1.0;
+  const double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) +
+                           a * log(x) + b * log(1.0 - x));
+  if (x < (a + 1.0) / (a + b + 2.0))
+    return front * beta_fraction(a, b, x) / a;
+  return 1.0 - front * beta_fraction(b, a, 1.0 - x) / b;
+}
+
+// P(T <= t) for Student's t with df degrees of freedom
+static double student_t_cdf(double t, long df) {
+  const double tail = 0.5 * incomplete_beta(0.5 * df, 0.5, df / (df + t * t));
+  return (t >= 0.0) ? 1.0 - tail : tail;
+}
+
+double student_t_quantile(double p, long df) {
+  if (df < 1 || p <= 0.0 || p >= 1.0)
+    return NAN;
+  if (p < 0.5)
+    return -student_t_quantile(1.0 - p, df);
+  // bracket, then bisect: the cdf is increasing
+  double lo = 0.0, hi = 1.0;
+  while (student_t_cdf(hi, df) < p && hi < 1e12)
+    hi *= 2.0;
+  for (int i = 0; i < 200 && hi - lo > 1e-12 * hi; i++) {
+    const double mid = 0.5 * (lo + hi);
+    if (student_t_cdf(mid, df) < p)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return 0.5 * (lo + hi);
+}
+
+int ResultAggregate::open(const std::vector<ResultColumn> &cols,
+                          const char *keys, const char *measure_name,
+                          double confidence) {
+  columns = cols;
+  is_key.assign(cols.size(), 0);
+  std::string name;
+  for (const char *p = keys;; p++) {
+    if (*p == ',' || *p == '\0') {
+      for (size_t i = 0; i < cols.size(); i++)
+        if (cols[i].name == name)
+          is_key[i] = 1;
+      name.clear();
+      if (*p == '\0')
+        break;
+    } else if (*p != ' ') {
+      name += *p;
+    }
+  }
+  measure = -1;
+  for (size_t i = 0; i < cols.size(); i++)
+    if (cols[i].name == measure_name && cols[i].type != 's' && !is_key[i])
+      measure = (int)i;
+  // <measure>50 and <measure>95 must fit a column name
+  if (measure < 0 || strlen(measure_name) + 2 >= RESULT_NAME)
+    return -1;
+  level = confidence;
+  firsts.reset(cols);
+  scratch.reset(cols);
+  cells_.clear();
+  index.clear();
+  return 0;
+}
+
+void ResultAggregate::add(const ResultTable &table, long row) {
+  // the key: the key values, separated by a character no value has
+  std::string key;
+  char buf[32];
+  for (size_t c = 0; c < columns.size(); c++) {
+    if (!is_key[c])
+      continue;
+    if (columns[c].type == 'l') {
+      snprintf(buf, sizeof(buf), "%lld", (long long)table.ints[c][row]);
+      key += buf;
+    } else if (columns[c].type == 'd') {
+      snprintf(buf, sizeof(buf), "%.17g", table.reals[c][row]);
+      key += buf;
+    } else {
+      key += table.text[c][row];
+    }
+    key += '\x1f';
+  }
+
+  auto it = index.find(key);
+  long k;
+  if (it == index.end()) {
+    k = (long)cells_.size();
+    index[key] = k;
+    cells_.emplace_back();
+    cells_.back().stats.resize(columns.size());
+    for (size_t c = 0; c < columns.size(); c++) {
+      if (columns[c].type == 'l')
+        firsts.ints[c].push_back(table.ints[c][row]);
+      else if (columns[c].type == 'd')
+        firsts.reals[c].push_back(table.reals[c][row]);
+      else
+        firsts.text[c].push_back(table.text[c][row]);
+    }
+    firsts.rows++;
+  } else {
+    k = it->second;
+  }
+
+  // missing values are left out of the means
+  Cell &cell = cells_[k];
+  for (size_t c = 0; c < columns.size(); c++) {
+    if (is_key[c] || columns[c].type == 's')
+      continue;
+    double x;
+    if (columns[c].type == 'l') {
+      if (table.ints[c][row] == INT64_MIN)
+        continue;
+      x = (double)table.ints[c][row];
+    } else {
+      x = table.reals[c][row];
+      if (std::isnan(x))
+        continue;
+    }
+    cell.stats[c].add(x);
+    if ((int)c == measure)
+      cell.sketch.update(&x, 1);
+  }
+}
+
+int ResultAggregate::add_csv(const char *row) {
+  std::lock_guard<std::mutex> guard(lock);
+  scratch.reset(columns);
+  if (scratch.append_csv(row))
+    return -1;
+  add(scratch, 0);
+  return 0;
+}
+
+void ResultAggregate::result(ResultTable *out) {
+  std::lock_guard<std::mutex> guard(lock);
+  std::vector<ResultColumn> cols;
+  for (size_t c = 0; c < columns.size(); c++)
+    cols.push_back({columns[c].name,
+                    (is_key[c] || columns[c].type == 's') ? columns[c].type
+                                                          : 'd'});
+  const std::string &m = columns[measure].name;
+  for (const char *name : {"std", "cil", "cir"})
+    cols.push_back({name, 'd'});
+  cols.push_back({m + "50", 'd'});
+  cols.push_back({m + "95", 'd'});
+  cols.push_back({"reps", 'l'});
+  out->reset(cols);
+
+  const size_t ncols = columns.size();
+  for (long k = 0; k < (long)cells_.size(); k++) {
+    Cell &cell = cells_[k];
+    for (size_t c = 0; c < ncols; c++) {
+      if (columns[c].type == 's')
+        out->text[c].push_back(firsts.text[c][k]);
+      else if (is_key[c] && columns[c].type == 'l')
+        out->ints[c].push_back(firsts.ints[c][k]);
+      else if (is_key[c])
+        out->reals[c].push_back(firsts.reals[c][k]);
+      else
+        out->reals[c].push_back(cell.stats[c].n ? cell.stats[c].mean : NAN);
+    }
+
+    // interval of the mean of the measure: mean +- t sd / sqrt(n)
+    const Welford &w = cell.stats[measure];
+    const double sd = sqrt(w.variance());
+    const double half =
+        (w.n > 1) ? student_t_quantile(0.5 + 0.5 * level, w.n - 1) * sd /
+                        sqrt((double)w.n)
+                  : NAN;
+    const long count = cell.sketch.count + (long)cell.sketch.buffer.size();
+    out->reals[ncols].push_back(sd);
+    out->reals[ncols + 1].push_back(w.mean - half);
+    out->reals[ncols + 2].push_back(w.mean + half);
+    out->reals[ncols + 3].push_back(cell.sketch.query((long)(0.5 * count), NULL));
+    out->reals[ncols + 4].push_back(cell.sketch.query((long)(0.95 * count), NULL));
+    out->ints[ncols + 5].push_back(w.n);
+  }
+  out->rows = (long)cells_.size();
+}
@@ -0,0 +1,94 @@
+/*
+ * Aggregation of result rows into one row per cell, as the rows arrive, in
+ * place of loading every run into pandas to average it.
+ *
+ * A cell is the set of rows agreeing on the key columns (by default those of
+ * the grid: alg, n, q, e, d, a, b; the seed s is what varies). Each numeric
+ * column is averaged with Welford's online update, so that the aggregate
+ * needs memory per cell, not per row; text columns keep the value of the
+ * first row. For one measure column (by default nae) the row also gives
+ * what the analysis notebook computes from the runs of a cell:
+ *
+ *   std       sample standard deviation
+ *   cil, cir  Student-t confidence interval of the mean (95% by default)
+ *
+ * and the median and 95th percentile of the measure over the runs (columns
+ * <measure>50, <measure>95), from a Greenwald-Khanna summary (GkSketch.h),
+ * then the number of runs (reps).
+ *
+ */
+
+#ifndef __RESULTAGGREGATE_H__
+#define __RESULTAGGREGATE_H__
+
+#include "GkSketch.h"
+#include "ResultStore.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define AGGREGATE_KEYS "alg,n,q,e,d,a,b"
+#define AGGREGATE_MEASURE "nae"
+#define AGGREGATE_LEVEL 0.95
+#define AGGREGATE_EPS 0.001 // rank error of the percentiles of the measure
+
+// running mean and variance (Welford)
+struct Welford {
+  long n;
+  double mean;
+  double m2; // sum of squared differences from the mean
+
+  Welford() : n(0), mean(0.0), m2(0.0) {}
+  void add(double x) {
+    n++;
+    const double delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+  }
+  // sample variance, NaN below two values
+  double variance() const { return (n > 1) ? m2 / (n - 1) : NAN; }
+};
+
+// p-quantile of Student's t distribution with df degrees of freedom
+double student_t_quantile(double p, long df);
+
+class ResultAggregate {
+public:
+  // Aggregates rows of columns. keys: the names of the key columns,
+  // separated by commas (names that are not among columns are ignored);
+  // measure: the column of std, cil and cir; level: of the interval.
+  // Returns -1 if measure is not a numeric column.
+  int open(const std::vector<ResultColumn> &columns,
+           const char *keys = AGGREGATE_KEYS,
+           const char *measure = AGGREGATE_MEASURE,
+           double level = AGGREGATE_LEVEL);
+  // adds row of table, whose columns are those given to open()
+  void add(const ResultTable &table, long row);
+  // Adds a row given as CSV text. Safe from several threads. Returns -1 if
+  // a value does not parse as its column's type.
+  int add_csv(const char *row);
+  long cells() const { return (long)cells_.size(); }
+  // one row per cell, in the order of their first rows
+  void result(ResultTable *out);
+
+private:
+  struct Cell {
+    std::vector<Welford> stats; // per column; numeric non-key columns only
+    GkSketch sketch;            // of the measure
+    Cell() : sketch(AGGREGATE_EPS) {}
+  };
+
+  std::vector<ResultColumn> columns;
+  std::vector<char> is_key;
+  int measure;
+  double level;
+  ResultTable firsts; // the first row of each cell, for keys and text
+  std::vector<Cell> cells_;
+  std::unordered_map<std::string, long> index;
+  ResultTable scratch; // parses add_csv() rows
+  std::mutex lock;
+};
+
+#endif //__RESULTAGGREGATE_H__
@@ -0,0 +1,116 @@
+/*
+ * Memoised result rows.
+ *
+ */
+
+#include "ResultCache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t fnv1a(const std::string &s) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+int ResultCache::open(const char *dir) {
+  close();
+  if (!dir)
+    dir = getenv("DPQ_CACHE");
+  if (!dir || !*dir)
+    return 0;
+  if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+    fprintf(stderr, "Error creating cache directory %s: %s\n", dir,
+            strerror(errno));
+    return -1;
+  }
+  const std::string path = std::string(dir) + "/" + RESULT_CACHE_FILE;
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+  if (fd < 0)
+    return -1;
+
+  // the entries so far; a line cut short is ended, so that the next entry
+  // starts a line of its own
+  std::string data;
+  char buf[1 << 16];
+  ssize_t r;
+  flock(fd, LOCK_EX);
+  lseek(fd, 0, SEEK_SET);
+  while ((r = read(fd, buf, sizeof(buf))) > 0 || (r < 0 && errno == EINTR))
+    if (r > 0)
+      data.append(buf, r);
+  if (!data.empty() && data.back() != '\n' && write(fd, "\n", 1) != 1) {
+    close();
+    return -1;
+  }
+  flock(fd, LOCK_UN);
+
+  size_t at = 0;
+  for (;;) {
+    const size_t end = data.find('\n', at);
+    if (end == std::string::npos)
+      break; // none, or a line cut short
+    const size_t tab1 = data.find('\t', at);
+    const size_t tab2 = (tab1 < end) ? data.find('\t', tab1 + 1) : end;
+    if (tab1 - at == 16 && tab2 < end) {
+      const uint64_t h = strtoull(data.substr(at, 16).c_str(), NULL, 16);
+      std::string key = data.substr(tab1 + 1, tab2 - tab1 - 1);
+      if (h == fnv1a(key))
+        rows[h] = {std::move(key), data.substr(tab2 + 1, end - tab2 - 1)};
+    }
+    at = end + 1;
+  }
+  return 0;
+}
+
+bool ResultCache::find(const std::string &key, std::string *row) {
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = rows.find(fnv1a(key));
+  if (it == rows.end() || it->second.first != key)
+    return false;
+  *row = it->second.second;
+  return true;
+}
+
+int ResultCache::store(const std::string &key, const std::string &row) {
+  if (fd < 0 || key.find_first_of("\t\n") != std::string::npos ||
+      row.find('\n') != std::string::npos)
+    return -1;
+  const uint64_t h = fnv1a(key);
+  char hash[20];
+  snprintf(hash, sizeof(hash), "%016llx\t", (unsigned long long)h);
+  const std::string line = hash + key + "\t" + row + "\n";
+
+  std::lock_guard<std::mutex> guard(lock);
+  rows[h] = {key, row};
+  if (flock(fd, LOCK_EX))
+    return -1;
+  size_t done = 0;
+  while (done < line.size()) {
+    ssize_t w = write(fd, line.data() + done, line.size() - done);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      break;
+    done += w;
+  }
+  flock(fd, LOCK_UN);
+  return (done == line.size()) ? 0 : -1;
+}
+
+void ResultCache::close() {
+  if (fd >= 0)
+    ::close(fd);
+  fd = -1;
+  rows.clear();
+}
@@ -0,0 +1,53 @@
+/*
+ * Memoised result rows, so that an interrupted or extended sweep runs only
+ * the cells it has not run yet.
+ *
+ * A row is stored under a key naming everything it depends on: the version
+ * of the code that computed it (of the algorithm, so that changing one
+ * algorithm re-runs its cells only), the algorithm, every parameter and the
+ * seed. Entries are lines appended to results.dpqm in the cache directory,
+ *
+ *   <FNV-1a hash of the key, 16 hex digits> TAB <key> TAB <row>
+ *
+ * each by a single write() under an exclusive flock(), so that concurrent
+ * sweeps may share a directory. The whole file is loaded on open; a later
+ * entry for a key replaces an earlier one, and a line cut short by an
+ * interruption is ignored.
+ *
+ */
+
+#ifndef __RESULTCACHE_H__
+#define __RESULTCACHE_H__
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define RESULT_CACHE_FILE "results.dpqm"
+
+class ResultCache {
+public:
+  ResultCache() : fd(-1) {}
+  ~ResultCache() { close(); }
+
+  // Uses dir, or $DPQ_CACHE if dir is NULL, and loads its entries; the
+  // cache is disabled if neither is set. Returns -1 if the directory or
+  // the file cannot be opened.
+  int open(const char *dir);
+  bool enabled() const { return fd >= 0; }
+  // Copies the row stored under key into row. Returns false on a miss.
+  bool find(const std::string &key, std::string *row);
+  // stores row (without its newline) under key; safe from several threads
+  int store(const std::string &key, const std::string &row);
+  long size() const { return (long)rows.size(); }
+  void close();
+
+private:
+  int fd;
+  // hash -> key and row
+  std::unordered_map<uint64_t, std::pair<std::string, std::string>> rows;
+  std::mutex lock;
+};
+
+#endif //__RESULTCACHE_H__
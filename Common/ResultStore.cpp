@@ -0,0 +1,595 @@
+/*
+ * Append-only columnar store of result rows.
+ *
+ */
+
+#include "ResultStore.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+static const char block_magic[4] = {'D', 'P', 'Q', 'B'};
+static const char index_magic[4] = {'D', 'P', 'Q', 'I'};
+static const char trailer_magic[8] = {'D', 'P', 'Q', 'R', 'I', 'D', 'X', '1'};
+
+struct BlockHeader {
+  char magic[4];
+  uint32_t columns;
+  uint64_t bytes;
+  uint64_t rows;
+};
+
+struct ColumnEntry {
+  char name[RESULT_NAME];
+  char type;
+};
+
+struct IndexEntry {
+  uint64_t offset;
+  uint64_t rows;
+};
+
+struct Trailer {
+  uint64_t offset;
+  char magic[8];
+};
+
+static size_t align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+void ResultTable::reset(const std::vector<ResultColumn> &cols) {
+  columns = cols;
+  rows = 0;
+  ints.assign(cols.size(), {});
+  reals.assign(cols.size(), {});
+  text.assign(cols.size(), {});
+}
+
+int ResultTable::find(const std::string &name) const {
+  for (size_t c = 0; c < columns.size(); c++)
+    if (columns[c].name == name)
+      return (int)c;
+  return -1;
+}
+
+// extends every column of table to table->rows with missing values
+static void pad_columns(ResultTable *table) {
+  for (size_t c = 0; c < table->columns.size(); c++) {
+    const char type = table->columns[c].type;
+    if (type == 'l')
+      table->ints[c].resize(table->rows, INT64_MIN);
+    else if (type == 'd')
+      table->reals[c].resize(table->rows, NAN);
+    else
+      table->text[c].resize(table->rows, "");
+  }
+}
+
+int result_columns(const char *header, const char *types,
+                   std::vector<ResultColumn> *columns) {
+  columns->clear();
+  const char *p = header;
+  for (const char *t = types; *t; t++) {
+    if (*t != 'l' && *t != 'd' && *t != 's')
+      return -1;
+    while (*p == ' ' || *p == ',')
+      p++;
+    const char *end = p;
+    while (*end && *end != ',' && *end != ' ' && *end != '\n')
+      end++;
+    if (end == p || end - p >= RESULT_NAME)
+      return -1;
+    columns->push_back({std::string(p, end - p), *t});
+    p = end;
+  }
+  while (*p == ' ' || *p == ',' || *p == '\n')
+    p++;
+  return *p ? -1 : 0;
+}
+
+bool result_store(const char *path) {
+  const size_t n = strlen(path);
+  return n >= 5 && strcmp(path + n - 5, ".dpqr") == 0;
+}
+
+// parses the fields of a CSV row into a new row of table, leaving the
+// values parsed before a bad one in place
+static int parse_row(const char *row, ResultTable *table) {
+  const char *p = row;
+  const size_t ncols = table->columns.size();
+  for (size_t c = 0; c < ncols; c++) {
+    while (*p == ' ')
+      p++;
+    const char *end = p;
+    while (*end && *end != ',' && *end != '\n')
+      end++;
+    const char *last = end;
+    while (last > p && last[-1] == ' ')
+      last--;
+    std::string field(p, last - p);
+    char *stop;
+    switch (table->columns[c].type) {
+    case 'l':
+      table->ints[c].push_back(strtoll(field.c_str(), &stop, 10));
+      if (field.empty() || *stop)
+        return -1;
+      break;
+    case 'd':
+      table->reals[c].push_back(strtod(field.c_str(), &stop));
+      if (field.empty() || *stop)
+        return -1;
+      break;
+    default:
+      table->text[c].push_back(field);
+    }
+    if (c + 1 < ncols && *end != ',')
+      return -1;
+    p = (*end == ',') ? end + 1 : end;
+  }
+  while (*p == ' ' || *p == '\n' || *p == '\r')
+    p++;
+  return *p ? -1 : 0;
+}
+
+// a text column as a dictionary of its distinct values and their codes
+struct TextColumn {
+  std::vector<const std::string *> entries;
+  std::vector<uint32_t> codes;
+  size_t chars;
+
+  // bytes it takes in a block
+  size_t bytes() const {
+    return align8((2 + codes.size() + entries.size()) * sizeof(uint32_t) +
+                  chars);
+  }
+};
+
+static void text_column(const std::vector<std::string> &values, long begin,
+                        long end, TextColumn *col) {
+  std::unordered_map<std::string, uint32_t> code;
+  col->chars = 0;
+  for (long i = begin; i < end; i++) {
+    auto it = code.find(values[i]);
+    if (it == code.end()) {
+      it = code.emplace(values[i], (uint32_t)col->entries.size()).first;
+      col->entries.push_back(&values[i]);
+      col->chars += values[i].size();
+    }
+    col->codes.push_back(it->second);
+  }
+}
+
+// rows [begin, end) of table as one block
+static std::vector<char> encode_block(const ResultTable &table, long begin,
+                                      long end) {
+  const size_t ncols = table.columns.size();
+  const long rows = end - begin;
+  std::vector<TextColumn> text(ncols);
+  size_t bytes = sizeof(BlockHeader) + ncols * sizeof(ColumnEntry);
+  for (size_t c = 0; c < ncols; c++) {
+    if (table.columns[c].type != 's') {
+      bytes += rows * 8;
+      continue;
+    }
+    text_column(table.text[c], begin, end, &text[c]);
+    bytes += text[c].bytes();
+  }
+
+  std::vector<char> block(bytes, 0);
+  BlockHeader header = {{0}, (uint32_t)ncols, bytes, (uint64_t)rows};
+  memcpy(header.magic, block_magic, 4);
+  memcpy(block.data(), &header, sizeof(header));
+  char *p = block.data() + sizeof(header);
+  for (size_t c = 0; c < ncols; c++, p += sizeof(ColumnEntry)) {
+    ColumnEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.name, table.columns[c].name.c_str(), RESULT_NAME - 1);
+    entry.type = table.columns[c].type;
+    memcpy(p, &entry, sizeof(entry));
+  }
+  for (size_t c = 0; c < ncols; c++) {
+    if (table.columns[c].type == 'l') {
+      memcpy(p, table.ints[c].data() + begin, rows * 8);
+      p += rows * 8;
+    } else if (table.columns[c].type == 'd') {
+      memcpy(p, table.reals[c].data() + begin, rows * 8);
+      p += rows * 8;
+    } else {
+      const TextColumn &col = text[c];
+      uint32_t *q = (uint32_t *)p;
+      *q++ = (uint32_t)col.entries.size();
+      memcpy(q, col.codes.data(), rows * sizeof(uint32_t));
+      q += rows;
+      char *chars = (char *)(q + col.entries.size() + 1);
+      uint32_t off = 0;
+      for (const std::string *s : col.entries) {
+        *q++ = off;
+        memcpy(chars + off, s->data(), s->size());
+        off += (uint32_t)s->size();
+      }
+      *q = off;
+      p += col.bytes();
+    }
+  }
+  return block;
+}
+
+static int write_all(int fd, const std::vector<char> &data) {
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t w = write(fd, data.data() + done, data.size() - done);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return -1;
+    done += w;
+  }
+  return 0;
+}
+
+// appends data to fd in one write, under an exclusive lock of the file
+static int append_locked(int fd, const std::vector<char> &data) {
+  if (flock(fd, LOCK_EX))
+    return -1;
+  int status = write_all(fd, data);
+  flock(fd, LOCK_UN);
+  return status;
+}
+
+int ResultTable::append_csv(const char *row) {
+  if (parse_row(row, this)) {
+    // drop the values parsed before the bad one
+    for (size_t c = 0; c < columns.size(); c++) {
+      if (columns[c].type == 'l')
+        ints[c].resize(rows);
+      else if (columns[c].type == 'd')
+        reals[c].resize(rows);
+      else
+        text[c].resize(rows);
+    }
+    return -1;
+  }
+  rows++;
+  return 0;
+}
+
+int ResultWriter::open(const char *path,
+                       const std::vector<ResultColumn> &columns, long rows) {
+  close();
+  fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    return -1;
+  block_rows = (rows > 0) ? rows : 1;
+  buffer.reset(columns);
+  return 0;
+}
+
+int ResultWriter::append(const char *row) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (fd < 0)
+    return -1;
+  if (buffer.append_csv(row))
+    return -1;
+  return (buffer.rows >= block_rows) ? flush_locked() : 0;
+}
+
+int ResultWriter::flush_locked() {
+  if (fd < 0 || buffer.rows == 0)
+    return 0;
+  int status = append_locked(fd, encode_block(buffer, 0, buffer.rows));
+  buffer.reset(buffer.columns);
+  return status;
+}
+
+int ResultWriter::flush() {
+  std::lock_guard<std::mutex> guard(lock);
+  return flush_locked();
+}
+
+int ResultWriter::close() {
+  std::lock_guard<std::mutex> guard(lock);
+  if (fd < 0)
+    return 0;
+  int status = flush_locked();
+  if (::close(fd))
+    status = -1;
+  fd = -1;
+  return status;
+}
+
+int result_append(const char *path, const char *header, const char *types,
+                  const char *row) {
+  std::vector<ResultColumn> columns;
+  if (result_columns(header, types, &columns))
+    return -1;
+  ResultWriter writer;
+  if (writer.open(path, columns, 1) || writer.append(row))
+    return -1;
+  return writer.close();
+}
+
+// Reads the whole file at path into data, under a shared flock() unless
+// the caller already holds the lock, so that no block is half written.
+static int read_file(const char *path, std::vector<char> *data,
+                     bool lock = true) {
+  struct stat st;
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return -1;
+  if (lock && flock(fd, LOCK_SH)) {
+    close(fd);
+    return -1;
+  }
+  int status = fstat(fd, &st);
+  data->resize(status ? 0 : st.st_size);
+  size_t done = 0;
+  while (status == 0 && done < data->size()) {
+    ssize_t r = read(fd, data->data() + done, data->size() - done);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      status = -1;
+    else
+      done += r;
+  }
+  close(fd);
+  return status;
+}
+
+// Offsets of the data blocks of a store, from its index if it ends with
+// one, else by walking the headers; -1 if the data is not a store. The
+// walk stops at a last block cut short (a writer killed in its write()),
+// and *partial is set to its size, 0 if the store is whole.
+static int block_offsets(const std::vector<char> &data,
+                         std::vector<uint64_t> *offsets, uint64_t *partial) {
+  const uint64_t size = data.size();
+  offsets->clear();
+  *partial = 0;
+  Trailer trailer;
+  if (size >= sizeof(BlockHeader) + sizeof(Trailer)) {
+    memcpy(&trailer, data.data() + size - sizeof(trailer), sizeof(trailer));
+    BlockHeader header;
+    if (memcmp(trailer.magic, trailer_magic, 8) == 0 &&
+        trailer.offset + sizeof(header) <= size) {
+      memcpy(&header, data.data() + trailer.offset, sizeof(header));
+      if (memcmp(header.magic, index_magic, 4) == 0 &&
+          trailer.offset + header.bytes == size &&
+          sizeof(header) + header.rows * sizeof(IndexEntry) + sizeof(trailer) ==
+              header.bytes) {
+        const char *p = data.data() + trailer.offset + sizeof(header);
+        for (uint64_t b = 0; b < header.rows; b++) {
+          IndexEntry entry;
+          memcpy(&entry, p + b * sizeof(entry), sizeof(entry));
+          offsets->push_back(entry.offset);
+        }
+        return 0;
+      }
+    }
+  }
+
+  uint64_t at = 0;
+  while (at < size) {
+    BlockHeader header;
+    if (at + sizeof(header) > size) {
+      *partial = size - at;
+      return 0;
+    }
+    memcpy(&header, data.data() + at, sizeof(header));
+    if (header.bytes < sizeof(header))
+      return -1;
+    if (header.bytes > size - at) {
+      if (memcmp(header.magic, block_magic, 4) != 0 &&
+          memcmp(header.magic, index_magic, 4) != 0)
+        return -1;
+      *partial = size - at;
+      return 0;
+    }
+    if (memcmp(header.magic, block_magic, 4) == 0)
+      offsets->push_back(at);
+    else if (memcmp(header.magic, index_magic, 4) != 0)
+      return -1;
+    at += header.bytes;
+  }
+  return 0;
+}
+
+// Appends the rows of the block at p, with size bytes of the store from p
+// on, to table, adding its new columns. Returns -1 if the block does not
+// fit in size, a column or a dictionary does not fit in the bytes its
+// header gives, or a text code is not in its dictionary.
+static int decode_block(const char *p, uint64_t size, ResultTable *table) {
+  BlockHeader header;
+  if (size < sizeof(header))
+    return -1;
+  memcpy(&header, p, sizeof(header));
+  if (memcmp(header.magic, block_magic, 4) != 0 ||
+      header.bytes < sizeof(header) || header.bytes > size)
+    return -1;
+  const char *end = p + header.bytes;
+  if (header.columns > (header.bytes - sizeof(header)) / sizeof(ColumnEntry) ||
+      header.rows > header.bytes / 8)
+    return -1;
+  const long rows = (long)header.rows;
+  std::vector<int> target(header.columns);
+  const char *q = p + sizeof(header);
+  for (uint32_t c = 0; c < header.columns; c++, q += sizeof(ColumnEntry)) {
+    ColumnEntry entry;
+    memcpy(&entry, q, sizeof(entry));
+    entry.name[RESULT_NAME - 1] = '\0';
+    if (entry.type != 'l' && entry.type != 'd' && entry.type != 's')
+      return -1;
+    int t = table->find(entry.name);
+    if (t < 0) {
+      // a new column: missing in every row read so far
+      t = (int)table->columns.size();
+      table->columns.push_back({entry.name, entry.type});
+      table->ints.emplace_back();
+      table->reals.emplace_back();
+      table->text.emplace_back();
+      pad_columns(table);
+    } else if (table->columns[t].type != entry.type) {
+      return -1;
+    }
+    target[c] = t;
+  }
+
+  for (uint32_t c = 0; c < header.columns; c++) {
+    const int t = target[c];
+    const char type = table->columns[t].type;
+    if (type == 'l') {
+      if ((size_t)(end - q) < (size_t)rows * 8)
+        return -1;
+      const size_t at = table->ints[t].size();
+      table->ints[t].resize(at + rows);
+      memcpy(table->ints[t].data() + at, q, rows * 8);
+      q += rows * 8;
+    } else if (type == 'd') {
+      if ((size_t)(end - q) < (size_t)rows * 8)
+        return -1;
+      const size_t at = table->reals[t].size();
+      table->reals[t].resize(at + rows);
+      memcpy(table->reals[t].data() + at, q, rows * 8);
+      q += rows * 8;
+    } else {
+      uint32_t entries;
+      if ((size_t)(end - q) < sizeof(entries))
+        return -1;
+      memcpy(&entries, q, sizeof(entries));
+      const size_t left = (size_t)(end - q) / sizeof(uint32_t);
+      if (left < 2 || rows > (long)(left - 2) || entries > left - 2 - rows)
+        return -1;
+      std::vector<uint32_t> codes(rows), offsets(entries + 1);
+      memcpy(codes.data(), q + 4, rows * sizeof(uint32_t));
+      memcpy(offsets.data(), q + 4 + rows * 4, (entries + 1) * sizeof(uint32_t));
+      const char *chars = q + (2 + rows + entries) * sizeof(uint32_t);
+      if (offsets[0] != 0 || offsets[entries] > (size_t)(end - chars))
+        return -1;
+      std::vector<std::string> dict;
+      for (uint32_t e = 0; e < entries; e++) {
+        if (offsets[e + 1] < offsets[e])
+          return -1;
+        dict.emplace_back(chars + offsets[e], offsets[e + 1] - offsets[e]);
+      }
+      for (long i = 0; i < rows; i++) {
+        if (codes[i] >= entries)
+          return -1;
+        table->text[t].push_back(dict[codes[i]]);
+      }
+      const size_t bytes =
+          align8((2 + rows + entries) * sizeof(uint32_t) + offsets[entries]);
+      if (bytes > (size_t)(end - q))
+        return -1;
+      q += bytes;
+    }
+  }
+
+  // the columns this block lacks
+  table->rows += rows;
+  pad_columns(table);
+  return 0;
+}
+
+int result_read(const char *path, ResultTable *table) {
+  table->reset({});
+  std::vector<char> data;
+  if (read_file(path, &data))
+    return -1;
+  std::vector<uint64_t> offsets;
+  uint64_t partial;
+  int status = block_offsets(data, &offsets, &partial);
+  if (status == 0 && partial > 0)
+    fprintf(stderr, "%s: ignoring an incomplete last block of %llu bytes\n",
+            path, (unsigned long long)partial);
+  for (size_t b = 0; status == 0 && b < offsets.size(); b++)
+    status = (offsets[b] < data.size())
+                 ? decode_block(data.data() + offsets[b],
+                                data.size() - offsets[b], table)
+                 : -1;
+  return status;
+}
+
+int result_write(const char *path, const ResultTable &table, long begin,
+                 long end, long block_rows) {
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    return -1;
+  int status = 0;
+  for (long i = begin; status == 0 && i < end; i += block_rows)
+    status = append_locked(fd, encode_block(table, i, std::min(end, i + block_rows)));
+  if (close(fd))
+    status = -1;
+  return status;
+}
+
+int result_index(const char *path) {
+  int fd = ::open(path, O_RDWR | O_APPEND);
+  if (fd < 0)
+    return -1;
+  // no block may be appended between reading the store and indexing it
+  if (flock(fd, LOCK_EX)) {
+    close(fd);
+    return -1;
+  }
+  int status = -1;
+  std::vector<char> data;
+  std::vector<uint64_t> offsets;
+  uint64_t partial;
+  // an index after an incomplete block would hide it inside the store
+  if (read_file(path, &data, false) == 0 &&
+      block_offsets(data, &offsets, &partial) == 0 && partial == 0) {
+    const uint64_t bytes = sizeof(BlockHeader) +
+                           offsets.size() * sizeof(IndexEntry) + sizeof(Trailer);
+    BlockHeader header = {{0}, 0, bytes, (uint64_t)offsets.size()};
+    memcpy(header.magic, index_magic, 4);
+    std::vector<char> block(bytes);
+    memcpy(block.data(), &header, sizeof(header));
+    char *p = block.data() + sizeof(header);
+    for (uint64_t off : offsets) {
+      BlockHeader h;
+      memcpy(&h, data.data() + off, sizeof(h));
+      IndexEntry entry = {off, h.rows};
+      memcpy(p, &entry, sizeof(entry));
+      p += sizeof(entry);
+    }
+    Trailer trailer = {(uint64_t)data.size(), {0}};
+    memcpy(trailer.magic, trailer_magic, 8);
+    memcpy(p, &trailer, sizeof(trailer));
+    status = write_all(fd, block);
+  }
+  flock(fd, LOCK_UN);
+  if (close(fd))
+    status = -1;
+  return status;
+}
+
+int result_csv(FILE *fptr, const ResultTable &table) {
+  const size_t ncols = table.columns.size();
+  for (size_t c = 0; c < ncols; c++)
+    fprintf(fptr, "%s%s", c ? "," : "", table.columns[c].name.c_str());
+  fprintf(fptr, "\n");
+  for (long i = 0; i < table.rows; i++) {
+    for (size_t c = 0; c < ncols; c++) {
+      if (c)
+        fputc(',', fptr);
+      if (table.columns[c].type == 'l') {
+        if (table.ints[c][i] != INT64_MIN)
+          fprintf(fptr, "%lld", (long long)table.ints[c][i]);
+      } else if (table.columns[c].type == 'd') {
+        fprintf(fptr, "%.6f", table.reals[c][i]);
+      } else {
+        fputs(table.text[c][i].c_str(), fptr);
+      }
+    }
+    fputc('\n', fptr);
+  }
+  return ferror(fptr) ? -1 : 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Append-only columnar store of result rows (.dpqr files), in place of one
+ * small CSV file per run.
+ *
+ * A store is a sequence of blocks, each holding some rows of typed columns:
+ * 'l' (int64), 'd' (double) or 's' (text). A block names its own columns,
+ * so runs of different binaries can share a store; a reader takes the union
+ * of the columns and leaves the values a block lacks missing (NaN, INT64_MIN
+ * or ""). Block layout, native byte order, every part 8-byte aligned:
+ *
+ *   "DPQB" | uint32 columns | uint64 bytes | uint64 rows
+ *   columns x { char name[23], char type }
+ *   per column: int64 or double [rows], or for text a dictionary: uint32
+ *   entries | uint32 codes [rows] | uint32 offsets [entries + 1] | the
+ *   entries' characters
+ *
+ * Each block is written by a single write() on a descriptor opened with
+ * O_APPEND, under an exclusive flock(), so that any number of processes,
+ * and of threads through one ResultWriter, append to a store safely.
+ * ResultWriter buffers RESULT_BLOCK_ROWS rows per block; result_append()
+ * writes a single row, for binaries with one result per run.
+ *
+ * A footer index ("DPQI" | uint32 0 | uint64 bytes | uint64 blocks, then
+ * { uint64 offset, uint64 rows } per block, then uint64 offset of the index
+ * and "DPQRIDX1") lets readers find every block without walking the file.
+ * result_index() appends one; a store that does not end with an index is
+ * read by walking the block headers. Readers take a shared flock(), and
+ * stop at a last block cut short by a writer that died in its write().
+ * dpqres.py reads a store into pandas, and the dpqres tool prints, indexes,
+ * compacts or imports stores.
+ *
+ */
+
+#ifndef __RESULTSTORE_H__
+#define __RESULTSTORE_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define RESULT_BLOCK_ROWS 65536
+#define RESULT_NAME 23 // longest column name, with its terminating NUL
+
+// the columns of the binaries' rows, with the algorithm prepended
+#define RESULT_LDP_HEADER "alg,n,q,e,d,a,b,s,qv,tqv,re,ae,nae,rg,min,max,time,upd"
+#define RESULT_LDP_TYPES "slddsddldddddddddl"
+#define RESULT_FRUGAL_1U_HEADER                                                \
+  "alg,n,q,d,a,b,s,qv,tqv,time,upd,sens,e,delta,rho,lqv,gqv,zqv,lre,gre,zre"
+#define RESULT_FRUGAL_1U_TYPES "sldsddldddldddddddddd"
+#define RESULT_FRUGAL_2U_HEADER "alg,n,q,d,a,b,s,qv,tqv,time,upd,e,sens,chunks,lqv,lre"
+#define RESULT_FRUGAL_2U_TYPES "sldsddldddlddldd"
+
+struct ResultColumn {
+  std::string name;
+  char type; // 'l', 'd' or 's'
+};
+
+// Rows of typed columns: for column c, ints[c], reals[c] or text[c] holds
+// its values, according to its type; the other two are empty.
+struct ResultTable {
+  std::vector<ResultColumn> columns;
+  long rows;
+  std::vector<std::vector<int64_t>> ints;
+  std::vector<std::vector<double>> reals;
+  std::vector<std::vector<std::string>> text;
+
+  ResultTable() : rows(0) {}
+  // sets the columns and clears the rows
+  void reset(const std::vector<ResultColumn> &cols);
+  // index of the column called name, -1 if none
+  int find(const std::string &name) const;
+  // Appends a row given as CSV text (blanks around the values are ignored;
+  // a trailing newline is allowed). Returns -1, leaving the rows as they
+  // were, if a value does not parse as its column's type.
+  int append_csv(const char *row);
+};
+
+// Columns named by a CSV header, typed by one letter each of types. Returns
+// -1 if the counts differ, a name is too long or a type is unknown.
+int result_columns(const char *header, const char *types,
+                   std::vector<ResultColumn> *columns);
+
+// whether path names a store (ends in .dpqr) rather than a CSV file
+bool result_store(const char *path);
+
+class ResultWriter {
+public:
+  ResultWriter() : fd(-1), block_rows(RESULT_BLOCK_ROWS) {}
+  ~ResultWriter() { close(); }
+
+  // opens (or creates) the store at path for appending rows of columns
+  int open(const char *path, const std::vector<ResultColumn> &columns,
+           long block_rows = RESULT_BLOCK_ROWS);
+  // Appends a row given as CSV text, as ResultTable::append_csv() does.
+  // Safe from several threads. Returns -1 if a value does not parse as its
+  // column's type, or a write fails.
+  int append(const char *row);
+  // writes the rows buffered so far as a block
+  int flush();
+  int close();
+
+private:
+  int fd;
+  long block_rows;
+  ResultTable buffer;
+  std::mutex lock;
+
+  int flush_locked();
+};
+
+// appends one CSV row to the store at path, as a block of its own
+int result_append(const char *path, const char *header, const char *types,
+                  const char *row);
+
+// Reads every row of the store at path into table, under a shared lock.
+// A last block cut short is skipped with a warning. Returns -1 if the file
+// cannot be read or is not a store, if a block is corrupt, or if two
+// blocks give one column different types.
+int result_read(const char *path, ResultTable *table);
+
+// writes rows [begin, end) of table to the store at path as blocks of at
+// most block_rows rows
+int result_write(const char *path, const ResultTable &table, long begin,
+                 long end, long block_rows = RESULT_BLOCK_ROWS);
+
+// appends a footer index of every block in the store at path
+int result_index(const char *path);
+
+// Prints table as CSV with a header line: reals with %.6f, as the binaries
+// print them, and missing integers as empty fields.
+int result_csv(FILE *fptr, const ResultTable &table);
+
+#endif //__RESULTSTORE_H__
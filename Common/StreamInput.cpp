@@ -0,0 +1,345 @@
+/*
+ * Batched readers for unbounded input streams.
+ *
+ */
+
+#include "StreamInput.h"
+#include "ItemCodec.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// powers of ten exactly representable as doubles
+static const double pow10_table[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                     1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                     1e18, 1e19, 1e20, 1e21, 1e22};
+
+static inline bool is_delim(char c) {
+  return c == '\n' || c == ' ' || c == ',' || c == '\t' || c == '\r';
+}
+
+// Plain decimals take the fast path. With at most 15 significant digits,
+// mantissa and power of ten are both exact doubles, so a single division is
+// correctly rounded. Up to 19 digits (as printed by %.17g, or repr) the
+// mantissa is exact in a 64-bit long double and the quotient is rounded twice,
+// which is off by one unit in the last place at most. Anything else goes
+// through strtod.
+bool parse_value(const char *p, const char *e, double *v) {
+  const char *s = p;
+  bool neg = false;
+  unsigned long long m = 0;
+  int digits = 0; // significant digits, leading zeros excluded
+  int frac = 0;
+  int chars = 0; // digits, leading zeros included
+
+  if (*p == '-' || *p == '+') {
+    neg = (*p == '-');
+    p++;
+  }
+  while (p < e && (unsigned)(*p - '0') < 10 && digits < 19) {
+    m = m * 10 + (*p - '0');
+    digits += (m != 0);
+    chars++;
+    p++;
+  }
+  if (p < e && *p == '.') {
+    p++;
+    while (p < e && (unsigned)(*p - '0') < 10 && digits < 19 && frac < 22) {
+      m = m * 10 + (*p - '0');
+      digits += (m != 0);
+      chars++;
+      frac++;
+      p++;
+    }
+  }
+  if (p == e && chars > 0) {
+    if (digits < 16) {
+      double r = (double)m / pow10_table[frac];
+      *v = neg ? -r : r;
+    } else {
+      long double r = (long double)m / pow10_table[frac];
+      *v = (double)(neg ? -r : r);
+    }
+    return true;
+  }
+
+  char tmp[64];
+  size_t len = e - s;
+  if (len >= sizeof(tmp))
+    return false;
+  memcpy(tmp, s, len);
+  tmp[len] = '\0';
+  char *endptr;
+  *v = strtod(tmp, &endptr);
+  return endptr == tmp + len && len > 0;
+}
+
+// Moves unconsumed bytes to the front of the buffer and reads more input.
+// Returns the number of bytes read, 0 on timeout or end of file.
+static long stream_fill(StreamInput *in, long timeout_ms, bool *closed) {
+  if (in->begin > 0) {
+    memmove(in->buf, in->buf + in->begin, in->end - in->begin);
+    in->end -= in->begin;
+    in->begin = 0;
+  }
+  if (in->end == STREAM_BUFSIZE) {
+    // a single token filling the whole buffer cannot be a value
+    in->rejected++;
+    in->end = 0;
+  }
+
+  if (timeout_ms >= 0) {
+    struct pollfd pfd;
+    pfd.fd = in->fd;
+    pfd.events = POLLIN;
+    int r;
+    do
+      r = poll(&pfd, 1, (int)timeout_ms);
+    while (r < 0 && errno == EINTR);
+    if (r == 0)
+      return 0;
+  }
+
+  ssize_t r;
+  do
+    r = read(in->fd, in->buf + in->end, STREAM_BUFSIZE - in->end);
+  while (r < 0 && errno == EINTR);
+  if (r < 0) {
+    fprintf(stderr, "Error reading input stream: %s\n", strerror(errno));
+    r = 0;
+  }
+  if (r == 0)
+    *closed = true;
+  in->end += r;
+  return r;
+}
+
+int stream_format(const char *name) {
+  if (!strcmp(name, "text"))
+    return STREAM_TEXT;
+  if (!strcmp(name, "binary"))
+    return STREAM_BINARY;
+  if (!strcmp(name, "packed"))
+    return STREAM_PACKED;
+  return -1;
+}
+
+int stream_open(StreamInput *in, const char *source, int format) {
+  memset(in, 0, sizeof(*in));
+  in->format = format;
+  in->fd = -1;
+
+  if (!strcmp(source, "-")) {
+    in->fd = STDIN_FILENO;
+  } else if (!strncmp(source, "unix:", 5)) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(source + 5) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "Socket path too long: %s\n", source + 5);
+      return -1;
+    }
+    strcpy(addr.sun_path, source + 5);
+    in->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (in->fd < 0 ||
+        connect(in->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      fprintf(stderr, "Error connecting to socket %s: %s\n", source + 5,
+              strerror(errno));
+      if (in->fd >= 0)
+        close(in->fd);
+      return -1;
+    }
+  } else {
+    in->fd = open(source, O_RDONLY);
+    if (in->fd < 0) {
+      fprintf(stderr, "Error opening input %s: %s\n", source, strerror(errno));
+      return -1;
+    }
+  }
+
+  in->buf = (char *)malloc(STREAM_BUFSIZE);
+  if (!in->buf) {
+    fprintf(stderr, "Not enough memory\n");
+    return -1;
+  }
+
+  if (format == STREAM_PACKED) {
+    ItemFileHeader h;
+    bool closed = false;
+    while (in->end < sizeof(h) && !closed)
+      stream_fill(in, -1, &closed);
+    memcpy(&h, in->buf, sizeof(h));
+    if (in->end < sizeof(h) || item_header_check(&h)) {
+      fprintf(stderr, "%s is not a packed item stream\n", source);
+      return -1;
+    }
+    in->begin = sizeof(h);
+    in->scale = h.scale;
+  }
+  return 0;
+}
+
+static long stream_read_binary(StreamInput *in, double *values, long max,
+                               long timeout_ms, bool *closed) {
+  long avail = (in->end - in->begin) / sizeof(double);
+  while (avail == 0) {
+    if (*closed) {
+      if (in->end > in->begin)
+        in->rejected++; // trailing partial word
+      in->begin = in->end;
+      in->eof = true;
+      return 0;
+    }
+    if (stream_fill(in, timeout_ms, closed) == 0 && !*closed)
+      return 0;
+    avail = (in->end - in->begin) / sizeof(double);
+  }
+
+  long n = (avail < max) ? avail : max;
+  memcpy(values, in->buf + in->begin, n * sizeof(double));
+  in->begin += n * sizeof(double);
+
+  // NaN words have no rank: skip them as malformed
+  long m = 0;
+  for (long i = 0; i < n; i++) {
+    if (std::isnan(values[i]))
+      in->rejected++;
+    else
+      values[m++] = values[i];
+  }
+  return m;
+}
+
+static long stream_read_text(StreamInput *in, double *values, long max,
+                             long timeout_ms, bool *closed) {
+  long n = 0;
+  char *buf = in->buf;
+
+  while (n < max) {
+    size_t b = in->begin;
+    while (b < in->end && is_delim(buf[b]))
+      b++;
+    size_t t = b;
+    while (t < in->end && !is_delim(buf[t]))
+      t++;
+    in->begin = b;
+
+    if (t == in->end && !*closed) {
+      // the last token may continue in the next block
+      if (n > 0)
+        break;
+      if (stream_fill(in, timeout_ms, closed) == 0 && !*closed)
+        break;
+      continue;
+    }
+    if (t == b) {
+      in->eof = true;
+      break;
+    }
+
+    if (parse_value(buf + b, buf + t, &values[n]) && !std::isnan(values[n]))
+      n++;
+    else
+      in->rejected++;
+    in->begin = t;
+  }
+
+  return n;
+}
+
+long stream_read(StreamInput *in, double *values, long max, long timeout_ms) {
+  bool closed = false;
+  long n;
+
+  if (in->eof)
+    return 0;
+  // a previous read may already have seen end of file on the descriptor
+  closed = (in->fd < 0);
+
+  if (in->format == STREAM_BINARY)
+    n = stream_read_binary(in, values, max, timeout_ms, &closed);
+  else
+    n = stream_read_text(in, values, max, timeout_ms, &closed);
+
+  if (closed && in->fd >= 0) {
+    if (in->fd != STDIN_FILENO)
+      close(in->fd);
+    in->fd = -1;
+  }
+  in->count += n;
+  return n;
+}
+
+long stream_read_items(StreamInput *in, int *items, long max,
+                       long timeout_ms) {
+  bool closed = (in->fd < 0);
+  long n = 0;
+
+  if (in->eof)
+    return 0;
+
+  while (max - n >= ITEM_BLOCK) {
+    size_t avail = in->end - in->begin;
+    const unsigned char *block = (unsigned char *)in->buf + in->begin;
+    if (avail >= sizeof(ItemBlockHeader) && item_block_check(block)) {
+      // a corrupt width leaves the block length unknown: stop at it
+      if (block[2] > 32) {
+        in->rejected++;
+        in->begin = in->end;
+        in->eof = true;
+        closed = true;
+        break;
+      }
+      // otherwise skip the block once it is all in the buffer
+      if (avail >= item_block_size(block)) {
+        in->rejected++;
+        in->begin += item_block_size(block);
+        continue;
+      }
+    } else if (avail >= sizeof(ItemBlockHeader) &&
+               avail >= item_block_size(block)) {
+      in->begin += item_block_size(block);
+      n += item_decode_block(block, items + n);
+      continue;
+    }
+
+    // incomplete block: return what we have or read more
+    if (closed) {
+      if (avail)
+        in->rejected++;
+      in->begin = in->end;
+      in->eof = true;
+      break;
+    }
+    if (n > 0)
+      break;
+    if (stream_fill(in, timeout_ms, &closed) == 0 && !closed)
+      break;
+  }
+
+  if (closed && in->fd >= 0) {
+    if (in->fd != STDIN_FILENO)
+      close(in->fd);
+    in->fd = -1;
+  }
+  in->count += n;
+  return n;
+}
+
+void stream_close(StreamInput *in) {
+  if (in->rejected)
+    fprintf(stderr, "skipped %ld malformed input values or blocks\n", in->rejected);
+  if (in->fd >= 0 && in->fd != STDIN_FILENO)
+    close(in->fd);
+  in->fd = -1;
+  free(in->buf), in->buf = NULL;
+}
@@ -0,0 +1,158 @@
+/*
+ * Batched readers for unbounded input streams.
+ *
+ * A source is "-" (stdin), "unix:<path>" (a Unix domain stream socket the
+ * producer listens on) or any other path (regular file or FIFO). Values are
+ * either newline (or whitespace/comma) delimited decimal text, raw native
+ * float64 words, or fixed-point integer items in the block-compressed format
+ * of ItemCodec.h. Input is read in large blocks and parsed in place.
+ *
+ */
+
+#ifndef __STREAMINPUT_H__
+#define __STREAMINPUT_H__
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#define STREAM_TEXT 0
+#define STREAM_BINARY 1
+#define STREAM_PACKED 2
+
+#define STREAM_BUFSIZE (1 << 20)
+#define STREAM_BATCH 65536
+
+struct StreamInput {
+  int fd;
+  int format;
+  char *buf;
+  size_t begin; // first unconsumed byte in buf
+  size_t end;   // one past the last valid byte in buf
+  bool eof;
+  long count;    // values returned so far
+  long rejected; // malformed (or NaN) values or packed blocks skipped so far
+  unsigned scale; // fixed-point scale of packed items
+};
+
+// the fixed-point item nearest to v * scale, clamped to the int range
+inline int32_t scaled_item(double v, double scale) {
+  const double x = v * scale;
+  return (x >= (double)INT_MAX) ? INT_MAX
+         : (x > (double)INT_MIN) ? (int32_t)lround(x)
+                                 : INT_MIN;
+}
+
+// returns STREAM_TEXT, STREAM_BINARY or STREAM_PACKED, -1 for an unknown
+// format name
+int stream_format(const char *name);
+
+// parses the decimal value in [p, e), returns false if it is malformed
+bool parse_value(const char *p, const char *e, double *v);
+
+// returns 0 on success, -1 (with a message on stderr) on failure
+int stream_open(StreamInput *in, const char *source, int format);
+
+// Parses up to max values into values, skipping malformed ones and NaN (which
+// has no rank) as rejected. Waits at most timeout_ms for new input when none
+// is buffered (blocks if timeout_ms < 0). Returns the number of values stored,
+// 0 on timeout or end of stream (in->eof is then set).
+long stream_read(StreamInput *in, double *values, long max, long timeout_ms);
+
+// As stream_read, for STREAM_PACKED inputs: decodes whole blocks of
+// fixed-point items straight into items (max must be at least ITEM_BLOCK).
+long stream_read_items(StreamInput *in, int *items, long max, long timeout_ms);
+
+void stream_close(StreamInput *in);
+
+// Feeds a whole stream to update(values, n) and calls emit(count) every
+// every_items values and/or every every_ms milliseconds (0 disables either
+// trigger). read(values, max, timeout_ms) returns the number of values read
+// or -1 at the end of the stream. Returns the number of values consumed.
+template <typename T, typename Read, typename Update, typename Emit>
+long stream_drive(Read read, long every_items, long every_ms, Update update,
+                  Emit emit) {
+  static T values[STREAM_BATCH];
+  long count = 0;
+  long next_emit = every_items;
+  auto last_emit = std::chrono::steady_clock::now();
+
+  for (;;) {
+    long n = read(values, STREAM_BATCH, every_ms ? every_ms : -1);
+    if (n < 0)
+      break;
+
+    // split the batch at item-count emission points
+    long done = 0;
+    while (done < n) {
+      long step = n - done;
+      if (every_items && count + step >= next_emit)
+        step = next_emit - count;
+      update(values + done, step);
+      done += step;
+      count += step;
+      if (every_items && count == next_emit) {
+        emit(count);
+        next_emit += every_items;
+        last_emit = std::chrono::steady_clock::now();
+      }
+    }
+
+    if (every_ms) {
+      auto now = std::chrono::steady_clock::now();
+      if (std::chrono::duration_cast<std::chrono::milliseconds>(now - last_emit)
+              .count() >= every_ms) {
+        emit(count);
+        last_emit = now;
+      }
+    }
+  }
+
+  return count;
+}
+
+// stream_drive over the decimal or float64 values of a text/binary stream
+template <typename Update, typename Emit>
+long stream_drive(StreamInput *in, long every_items, long every_ms,
+                  Update update, Emit emit) {
+  return stream_drive<double>(
+      [in](double *values, long max, long timeout_ms) {
+        long n = stream_read(in, values, max, timeout_ms);
+        return (n == 0 && in->eof) ? -1 : n;
+      },
+      every_items, every_ms, update, emit);
+}
+
+// stream_drive over a text/binary stream converted to fixed-point items with
+// scaled_item
+template <typename Update, typename Emit>
+long stream_drive_scaled(StreamInput *in, double scale, long every_items,
+                         long every_ms, Update update, Emit emit) {
+  static double values[STREAM_BATCH];
+  return stream_drive<int>(
+      [in, scale](int *items, long max, long timeout_ms) {
+        long n = stream_read(in, values, max, timeout_ms);
+        if (n == 0 && in->eof)
+          return -1L;
+        for (long i = 0; i < n; i++)
+          items[i] = scaled_item(values[i], scale);
+        return n;
+      },
+      every_items, every_ms, update, emit);
+}
+
+// stream_drive over the fixed-point items of a packed stream
+template <typename Update, typename Emit>
+long stream_drive_items(StreamInput *in, long every_items, long every_ms,
+                        Update update, Emit emit) {
+  return stream_drive<int>(
+      [in](int *items, long max, long timeout_ms) {
+        long n = stream_read_items(in, items, max, timeout_ms);
+        return (n == 0 && in->eof) ? -1 : n;
+      },
+      every_items, every_ms, update, emit);
+}
+
+#endif //__STREAMINPUT_H__
@@ -0,0 +1,193 @@
+/*
+ * Vectorised, multi-threaded statistics sweep.
+ *
+ */
+
+#include "StreamStats.h"
+#include "ParallelSelect.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STATS_X86 1
+#endif
+
+// items a thread reads at least; smaller shares are not worth starting it
+#define STATS_SHARE (1L << 20)
+
+// adds a[0, n) to the statistics in *s (all but the count)
+template <typename T>
+static void stats_scalar(const T *a, long n, StreamStats *s) {
+  for (long i = 0; i < n; i++) {
+    const double x = a[i];
+    s->min = (x < s->min) ? x : s->min;
+    s->max = (x > s->max) ? x : s->max;
+    s->sum += x;
+  }
+}
+
+#ifdef STATS_X86
+
+#define AVX2 __attribute__((target("avx2")))
+#define AVX512 __attribute__((target("avx512f")))
+
+// The AVX-512 kernels use the zero-masked forms with full masks: the plain
+// ones merge into an undefined vector, which some compilers warn about.
+static const __mmask8 all8 = 0xff;
+static const __mmask16 all16 = 0xffff;
+
+// two vectors per step, so that the adds of one do not wait for the other
+AVX2 static void stats_avx2(const double *a, long n, StreamStats *s) {
+  __m256d lo = _mm256_set1_pd(s->min), hi = _mm256_set1_pd(s->max);
+  __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+  long i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256d x0 = _mm256_loadu_pd(a + i), x1 = _mm256_loadu_pd(a + i + 4);
+    lo = _mm256_min_pd(lo, _mm256_min_pd(x0, x1));
+    hi = _mm256_max_pd(hi, _mm256_max_pd(x0, x1));
+    sum0 = _mm256_add_pd(sum0, x0);
+    sum1 = _mm256_add_pd(sum1, x1);
+  }
+  double l[4], h[4], t[4];
+  _mm256_storeu_pd(l, lo);
+  _mm256_storeu_pd(h, hi);
+  _mm256_storeu_pd(t, _mm256_add_pd(sum0, sum1));
+  for (int k = 0; k < 4; k++) {
+    s->min = (l[k] < s->min) ? l[k] : s->min;
+    s->max = (h[k] > s->max) ? h[k] : s->max;
+  }
+  s->sum += (t[0] + t[1]) + (t[2] + t[3]);
+  stats_scalar(a + i, n - i, s);
+}
+
+AVX512 static void stats_avx512(const double *a, long n, StreamStats *s) {
+  __m512d lo = _mm512_set1_pd(s->min), hi = _mm512_set1_pd(s->max);
+  __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd();
+  long i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m512d x0 = _mm512_loadu_pd(a + i), x1 = _mm512_loadu_pd(a + i + 8);
+    lo = _mm512_maskz_min_pd(all8, lo, _mm512_maskz_min_pd(all8, x0, x1));
+    hi = _mm512_maskz_max_pd(all8, hi, _mm512_maskz_max_pd(all8, x0, x1));
+    sum0 = _mm512_add_pd(sum0, x0);
+    sum1 = _mm512_add_pd(sum1, x1);
+  }
+  double l[8], h[8], t[8];
+  _mm512_storeu_pd(l, lo);
+  _mm512_storeu_pd(h, hi);
+  _mm512_storeu_pd(t, _mm512_add_pd(sum0, sum1));
+  for (int k = 0; k < 8; k++) {
+    s->min = (l[k] < s->min) ? l[k] : s->min;
+    s->max = (h[k] > s->max) ? h[k] : s->max;
+  }
+  s->sum += ((t[0] + t[1]) + (t[2] + t[3])) + ((t[4] + t[5]) + (t[6] + t[7]));
+  stats_scalar(a + i, n - i, s);
+}
+
+// int items are summed exactly in 64-bit lanes
+AVX2 static void stats_avx2(const int *a, long n, StreamStats *s) {
+  __m256i lo = _mm256_set1_epi32(INT_MAX), hi = _mm256_set1_epi32(INT_MIN);
+  __m256i sum = _mm256_setzero_si256();
+  long i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+    lo = _mm256_min_epi32(lo, x);
+    hi = _mm256_max_epi32(hi, x);
+    sum = _mm256_add_epi64(sum,
+                           _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+    sum = _mm256_add_epi64(sum,
+                           _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+  }
+  int l[8], h[8];
+  long long t[4];
+  _mm256_storeu_si256((__m256i *)l, lo);
+  _mm256_storeu_si256((__m256i *)h, hi);
+  _mm256_storeu_si256((__m256i *)t, sum);
+  if (i > 0)
+    for (int k = 0; k < 8; k++) {
+      s->min = (l[k] < s->min) ? l[k] : s->min;
+      s->max = (h[k] > s->max) ? h[k] : s->max;
+    }
+  s->sum += (double)(t[0] + t[1] + t[2] + t[3]);
+  stats_scalar(a + i, n - i, s);
+}
+
+AVX512 static void stats_avx512(const int *a, long n, StreamStats *s) {
+  __m512i lo = _mm512_set1_epi32(INT_MAX), hi = _mm512_set1_epi32(INT_MIN);
+  __m512i sum = _mm512_setzero_si512();
+  long i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const __m512i x = _mm512_loadu_si512(a + i);
+    lo = _mm512_maskz_min_epi32(all16, lo, x);
+    hi = _mm512_maskz_max_epi32(all16, hi, x);
+    const __m256i x0 = _mm512_maskz_extracti64x4_epi64(0xf, x, 0);
+    const __m256i x1 = _mm512_maskz_extracti64x4_epi64(0xf, x, 1);
+    sum = _mm512_add_epi64(sum, _mm512_maskz_cvtepi32_epi64(all8, x0));
+    sum = _mm512_add_epi64(sum, _mm512_maskz_cvtepi32_epi64(all8, x1));
+  }
+  int l[16], h[16];
+  long long t[8];
+  _mm512_storeu_si512(l, lo);
+  _mm512_storeu_si512(h, hi);
+  _mm512_storeu_si512(t, sum);
+  if (i > 0)
+    for (int k = 0; k < 16; k++) {
+      s->min = (l[k] < s->min) ? l[k] : s->min;
+      s->max = (h[k] > s->max) ? h[k] : s->max;
+    }
+  long long total = 0;
+  for (int k = 0; k < 8; k++)
+    total += t[k];
+  s->sum += (double)total;
+  stats_scalar(a + i, n - i, s);
+}
+
+#endif // STATS_X86
+
+template <typename T>
+static void stats_share(const T *a, long n, StreamStats *s) {
+#ifdef STATS_X86
+  const int level = std::min(quickselect_simd, quickselect_has_simd());
+  if (level == QSELECT_AVX512) {
+    stats_avx512(a, n, s);
+    return;
+  }
+  if (level == QSELECT_AVX2) {
+    stats_avx2(a, n, s);
+    return;
+  }
+#endif
+  stats_scalar(a, n, s);
+}
+
+template <typename T>
+static StreamStats stats(const T *items, long n, int threads) {
+  const double inf = std::numeric_limits<double>::infinity();
+  threads = pselect_threads(threads);
+  threads = (int)std::max(1L, std::min((long)threads, n / STATS_SHARE));
+
+  std::vector<StreamStats> part(threads, StreamStats{0, inf, -inf, 0.0});
+  pselect_parallel(threads, n, [&](int t, long begin, long end) {
+    stats_share(items + begin, end - begin, &part[t]);
+  });
+
+  StreamStats s = {n, inf, -inf, 0.0};
+  for (const StreamStats &p : part) {
+    s.min = (p.min < s.min) ? p.min : s.min;
+    s.max = (p.max > s.max) ? p.max : s.max;
+    s.sum += p.sum;
+  }
+  return s;
+}
+
+StreamStats stream_stats(const double *items, long n, int threads) {
+  return stats(items, n, threads);
+}
+
+StreamStats stream_stats(const int *items, long n, int threads) {
+  return stats(items, n, threads);
+}
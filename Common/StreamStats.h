@@ -0,0 +1,25 @@
+/*
+ * One-pass statistics of an item buffer: stream_stats(items, n) returns the
+ * number of items, their minimum, maximum and sum, read in a single sweep.
+ *
+ * The sweep is split across threads like the selections of ParallelSelect.h,
+ * and each share is read with AVX-512 or AVX2 (StreamStats.cpp) when the CPU
+ * supports them. The result does not depend on the number of threads, except
+ * for the rounding of the sum of double items.
+ *
+ */
+
+#ifndef __STREAMSTATS_H__
+#define __STREAMSTATS_H__
+
+struct StreamStats {
+  long count;
+  double min; // +inf and -inf for an empty buffer
+  double max;
+  double sum;
+};
+
+StreamStats stream_stats(const double *items, long n, int threads = 0);
+StreamStats stream_stats(const int *items, long n, int threads = 0);
+
+#endif //__STREAMSTATS_H__
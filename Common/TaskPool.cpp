@@ -0,0 +1,110 @@
+/*
+ * Work-stealing pool with pinned workers.
+ *
+ */
+
+#include "TaskPool.h"
+#include "ParallelSelect.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <thread>
+
+// NUMA node of cpu, from its nodeN entry in sysfs (0 if there is none)
+static int cpu_node(int cpu) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+  DIR *dir = opendir(path);
+  if (!dir)
+    return 0;
+  int node = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)))
+    if (sscanf(entry->d_name, "node%d", &node) == 1)
+      break;
+  closedir(dir);
+  return node;
+}
+
+TaskPool::TaskPool(int threads) : pending(0), stolen(0) {
+  threads = pselect_threads(threads);
+
+  // workers are pinned only if each can have its own core, to the cores
+  // the threads of the parallel passes take
+  const std::vector<int> cpus = pselect_cpus(threads);
+  const bool pin = !cpus.empty();
+
+  for (int w = 0; w < threads; w++) {
+    workers.emplace_back(new Worker);
+    workers[w]->cpu = pin ? cpus[w] : -1;
+    workers[w]->node = pin ? cpu_node(cpus[w]) : 0;
+  }
+  for (int w = 0; w < threads; w++)
+    for (int pass = 0; pass < 2; pass++)
+      for (int i = 1; i < threads; i++) {
+        const int v = (w + i) % threads;
+        if ((workers[v]->node == workers[w]->node) == (pass == 0))
+          workers[w]->victims.push_back(v);
+      }
+}
+
+void TaskPool::push(int worker, Task task) {
+  pending++;
+  std::lock_guard<std::mutex> guard(workers[worker]->lock);
+  workers[worker]->tasks.push_back(std::move(task));
+}
+
+bool TaskPool::take(int worker, Task *task) {
+  {
+    Worker &own = *workers[worker];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (int v : workers[worker]->victims) {
+    Worker &victim = *workers[v];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty()) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      stolen++;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskPool::work(int worker, Source &source) {
+  if (workers[worker]->cpu >= 0)
+    pselect_pin(workers[worker]->cpu);
+
+  Task task;
+  for (;;) {
+    if (take(worker, &task)) {
+      task(worker);
+      task = nullptr;
+      pending--;
+      continue;
+    }
+    if (source(worker))
+      continue;
+    // nothing queued or running: every task the source gave has finished,
+    // so its answer now is final
+    if (pending.load() == 0 && !source(worker))
+      break;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+void TaskPool::run(Source source) {
+  std::vector<std::thread> pool;
+  for (int w = 0; w < size(); w++)
+    pool.emplace_back([this, w, &source]() { work(w, source); });
+  for (auto &th : pool)
+    th.join();
+}
@@ -0,0 +1,65 @@
+/*
+ * Work-stealing pool for sweeps of many independent tasks of uneven cost.
+ *
+ * Every worker owns a deque of tasks and is pinned to its own core (when
+ * there are enough cores). A task pushed by a worker goes to that worker's
+ * deque, so the tasks a task spawns (the cells of a stream it generated)
+ * run by default on the core, and the NUMA node, that wrote their data.
+ * The owner takes its newest task; a worker with an empty deque steals the
+ * oldest task of another worker, trying the workers of its own node first.
+ * A worker that finds no task anywhere asks the source for new work, so
+ * that a sweep can keep the next streams coming while the last cells of the
+ * previous ones run; run() returns once the source has nothing left and
+ * every task has finished.
+ *
+ */
+
+#ifndef __TASKPOOL_H__
+#define __TASKPOOL_H__
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class TaskPool {
+public:
+  typedef std::function<void(int worker)> Task;
+  // called by an idle worker; pushes new tasks and returns true, or returns
+  // false if it has none to give now
+  typedef std::function<bool(int worker)> Source;
+
+  // threads workers (all cores if threads <= 0)
+  explicit TaskPool(int threads);
+
+  int size() const { return (int)workers.size(); }
+  int cpu(int worker) const { return workers[worker]->cpu; } // -1: unpinned
+  int node(int worker) const { return workers[worker]->node; }
+  long steals() const { return stolen.load(); }
+
+  // queues task on the deque of worker; safe from any thread
+  void push(int worker, Task task);
+
+  // runs the workers until the source and every deque are exhausted
+  void run(Source source);
+
+private:
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+    int cpu;
+    int node;
+    std::vector<int> victims; // own node first, then the others
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<long> pending; // tasks queued or running
+  std::atomic<long> stolen;
+
+  bool take(int worker, Task *task);
+  void work(int worker, Source &source);
+};
+
+#endif //__TASKPOOL_H__
@@ -0,0 +1,118 @@
+/*
+ * Cache of the exact statistics of generated streams.
+ *
+ */
+
+#include "TruthCache.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static std::string truth_path(const DatasetCache *c, const std::string &key) {
+  uint64_t h = 14695981039346656037ull;
+  for (unsigned char ch : key) {
+    h ^= ch;
+    h *= 1099511628211ull;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.truth", (unsigned long long)h);
+  return c->dir + "/" + name;
+}
+
+static void truth_clear(StreamTruth *truth) {
+  truth->has_range = false;
+  truth->min = 0.0;
+  truth->max = 0.0;
+  truth->ranks.clear();
+}
+
+int truth_cache_load(DatasetCache *c, const std::string &key,
+                     StreamTruth *truth) {
+  truth_clear(truth);
+  if (!c->enabled)
+    return -1;
+
+  FILE *fp = fopen(truth_path(c, key).c_str(), "r");
+  if (!fp)
+    return -1;
+
+  char line[CACHE_KEY_SIZE + 16];
+  int version = 0;
+  bool ok = fscanf(fp, "DPQT %d\n", &version) == 1 &&
+            version == TRUTH_VERSION && fgets(line, sizeof(line), fp) &&
+            !strncmp(line, "key ", 4);
+  if (ok) {
+    line[strcspn(line, "\n")] = '\0';
+    ok = (key == line + 4);
+  }
+  // every value is written with %a, which reads back exactly
+  while (ok && fgets(line, sizeof(line), fp)) {
+    long rank;
+    double v, w;
+    if (sscanf(line, "range %la %la", &v, &w) == 2) {
+      truth->has_range = true;
+      truth->min = v;
+      truth->max = w;
+    } else if (sscanf(line, "rank %ld %la", &rank, &v) == 2) {
+      truth->ranks[rank] = v;
+    } else {
+      ok = false;
+    }
+  }
+  fclose(fp);
+
+  if (!ok) {
+    truth_clear(truth);
+    return -1;
+  }
+  return 0;
+}
+
+int truth_cache_store(DatasetCache *c, const std::string &key,
+                      const StreamTruth &truth) {
+  if (!c->enabled)
+    return 0;
+
+  std::string path = truth_path(c, key);
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp%ld", (long)getpid());
+  std::string tmp = path + suffix;
+
+  FILE *fp = fopen(tmp.c_str(), "w");
+  if (!fp) {
+    fprintf(stderr, "Error creating truth cache entry %s: %s\n", tmp.c_str(),
+            strerror(errno));
+    return -1;
+  }
+  fprintf(fp, "DPQT %d\nkey %s\n", TRUTH_VERSION, key.c_str());
+  if (truth.has_range)
+    fprintf(fp, "range %a %a\n", truth.min, truth.max);
+  for (const auto &r : truth.ranks)
+    fprintf(fp, "rank %ld %a\n", r.first, r.second);
+  bool ok = !ferror(fp);
+  ok = (fclose(fp) == 0) && ok;
+
+  if (!ok || rename(tmp.c_str(), path.c_str()) < 0) {
+    fprintf(stderr, "Error writing truth cache entry %s\n", path.c_str());
+    unlink(tmp.c_str());
+    return -1;
+  }
+  return 0;
+}
+
+int parse_quantiles(const char *list, std::vector<double> *out) {
+  out->clear();
+  while (*list) {
+    char *end;
+    double q = strtod(list, &end);
+    if (end == list || q < 0.0 || q >= 1.0 || (*end && *end != ','))
+      return -1;
+    out->push_back(q);
+    list = *end ? end + 1 : end;
+  }
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Cache of the exact statistics of generated streams.
+ *
+ * Runs that differ only in the quantile or in the privacy parameters read
+ * the same stream; the first one stores its range and the items at the
+ * selected ranks under the stream key (see DatasetCache.h), and the others
+ * read them back instead of selecting again. A run may select further ranks
+ * (-Q) in the same pass, so that a quantile sweep selects once per stream.
+ *
+ * Entries are small text files next to the cached streams, named by the
+ * hash of the key and holding the key itself; they are not counted against
+ * the cache budget.
+ *
+ */
+
+#ifndef __TRUTHCACHE_H__
+#define __TRUTHCACHE_H__
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "DatasetCache.h"
+
+#define TRUTH_VERSION 1
+
+struct StreamTruth {
+  bool has_range;
+  double min;
+  double max;
+  std::map<long, double> ranks; // rank (0-based) -> item
+};
+
+// Reads the entry of key into truth, which is left empty on a miss. Returns
+// 0 on a hit, -1 otherwise.
+int truth_cache_load(DatasetCache *c, const std::string &key,
+                     StreamTruth *truth);
+
+// Replaces the entry of key with truth. Returns 0 on success, -1 on failure.
+int truth_cache_store(DatasetCache *c, const std::string &key,
+                      const StreamTruth &truth);
+
+// Parses a comma-separated list of quantiles into out. Returns -1 if the
+// list holds a value outside [0, 1).
+int parse_quantiles(const char *list, std::vector<double> *out);
+
+// The ranks of quantile and of the quantiles listed in extra (may be NULL),
+// ascending and without repeats; rank_of(q) must compute the rank of q as
+// the binary computes its own. Returns -1 if extra is malformed.
+template <typename RankOf>
+int truth_ranks(double quantile, const char *extra, RankOf rank_of,
+                std::vector<long> *ranks) {
+  std::vector<double> quantiles;
+  if (extra && parse_quantiles(extra, &quantiles))
+    return -1;
+  quantiles.push_back(quantile);
+
+  ranks->clear();
+  for (double q : quantiles)
+    ranks->push_back(rank_of(q));
+  std::sort(ranks->begin(), ranks->end());
+  ranks->erase(std::unique(ranks->begin(), ranks->end()), ranks->end());
+  return 0;
+}
+
+// Selects the ranks truth lacks with select(items, n, ranks, m, out), which
+// stores the item of rank ranks[i] in out[i] and may reorder the items.
+// Returns the number selected.
+template <typename T, typename Select>
+int truth_select(StreamTruth *truth, T *items, long n,
+                 const std::vector<long> &ranks, Select select) {
+  std::vector<long> missing;
+  for (long r : ranks)
+    if (!truth->ranks.count(r))
+      missing.push_back(r);
+  if (missing.empty())
+    return 0;
+
+  std::vector<typename std::remove_const<T>::type> out(missing.size());
+  select(items, n, missing.data(), (int)missing.size(), out.data());
+  for (size_t i = 0; i < missing.size(); i++)
+    truth->ranks[missing[i]] = (double)out[i];
+  return missing.size();
+}
+
+#endif //__TRUTHCACHE_H__
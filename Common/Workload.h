@@ -0,0 +1,294 @@
+/*
+ * The synthetic workloads of the binaries, and the rows they write.
+ *
+ * Every binary draws its items from one of eight distributions (-d), with
+ * parameters (-a, -b) that default per distribution, and writes one result
+ * row per run; ldp-sweep runs the same cells in process. Both draw the items,
+ * the releases and the rows here, so that a cell of a sweep reads the stream
+ * and writes the row of the binary run with the same options.
+ *
+ * The LDP binaries draw doubles from a mt19937 seeded with the first of the
+ * four seeds ldp_seeds() derives from -s. The central ones draw floats,
+ * scaled by 1000 and truncated to ints, from a generator seeded with -s
+ * itself: frugal_1u a mt19937, which then draws the Gaussian and zCDP noise
+ * of its releases, frugal_2u a default_random_engine. A distribution other
+ * than 1 to 8 is the normal one, with the default parameters.
+ *
+ * The rows are the columns of RESULT_*_HEADER (ResultStore.h) after alg,
+ * without the optional ones (rerr, bootstrap) and the newline; the central
+ * ones keep the float arithmetic of their binaries.
+ *
+ */
+
+#ifndef __WORKLOAD_H__
+#define __WORKLOAD_H__
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <boost/random.hpp>
+#include <boost/random/laplace_distribution.hpp>
+
+#define DISTS 8
+
+inline bool dist_known(long dist) { return dist >= 1 && dist <= DISTS; }
+
+// the name of dist in the rows
+inline const char *dist_name(long dist) {
+  static const char *names[DISTS + 1] = {"normal",     "normal", "cauchy",
+                                         "uniform",    "exponential",
+                                         "chisquared", "gamma",  "lognormal",
+                                         "extremevalue"};
+  return names[dist_known(dist) ? dist : 0];
+}
+
+// the parameters of dist the options did not give, from defaults[dist]; an
+// unknown dist takes defaults[0] whatever the options
+template <typename Real>
+inline void dist_defaults(const float (*defaults)[2], long dist, Real *param1,
+                          Real *param2, bool param1_default,
+                          bool param2_default) {
+  const bool known = dist_known(dist);
+  if (!known || param1_default)
+    *param1 = defaults[known ? dist : 0][0];
+  if (!known || param2_default)
+    *param2 = defaults[known ? dist : 0][1];
+}
+
+// normal (0,1), cauchy (0,1), uniform (-1,1), exponential (0.5), chisquared
+// (5), gamma (3,2), lognormal (0,0.5), extremevalue (1.5,3); -1 is not used
+inline void ldp_dist_defaults(long dist, double *param1, double *param2,
+                              bool param1_default = true,
+                              bool param2_default = true) {
+  static const float defaults[DISTS + 1][2] = {
+      {0.0, 1.0},  {0.0, 1.0}, {0.0, 1.0}, {-1.0, 1.0}, {0.5, -1.0},
+      {5.0, -1.0}, {3.0, 2.0}, {0.0, 0.5}, {1.5, 3.0}};
+  dist_defaults(defaults, dist, param1, param2, param1_default, param2_default);
+}
+
+// those of the central binaries, whose items are scaled by 1000
+template <typename Real>
+inline void central_dist_defaults(long dist, Real *param1, Real *param2,
+                                  bool param1_default = true,
+                                  bool param2_default = true) {
+  static const float defaults[DISTS + 1][2] = {
+      {50.0, 2.0}, {50.0, 2.0}, {10000.0, 1250.0}, {0.0, 1000.0}, {0.5, -1.0},
+      {5.0, -1.0}, {2.0, 4.0},  {1.0, 1.5},        {20.0, 2.0}};
+  dist_defaults(defaults, dist, param1, param2, param1_default, param2_default);
+}
+
+// the seeds the LDP binaries derive from -s: seed1 draws the items, the
+// others seed the randomizers of the estimators
+struct LdpSeeds {
+  long seed1;
+  long seed2;
+  long seed3;
+  long seed4;
+};
+
+inline LdpSeeds ldp_seeds(long seed) {
+  LdpSeeds s;
+  std::srand(seed);
+  s.seed1 = std::rand();
+  s.seed2 = std::rand();
+  s.seed3 = std::rand();
+  s.seed4 = std::rand();
+  return s;
+}
+
+// passes len values of dist, drawn as Real from gen, to store(i, value); the
+// distributions are made per call, so a stream drawn in segments (the
+// out-of-core path) restarts them per segment
+template <typename Real, typename Engine, typename Store>
+inline void draw_items(long len, long dist, Real param1, Real param2,
+                       Engine &gen, Store store) {
+  auto draw = [&](auto distribution) {
+    for (long i = 0; i < len; i++)
+      store(i, distribution(gen));
+  };
+  switch (dist) {
+  case 2:
+    draw(std::cauchy_distribution<Real>(param1, param2));
+    break;
+  case 3:
+    draw(std::uniform_real_distribution<Real>(param1, param2));
+    break;
+  case 4:
+    draw(std::exponential_distribution<Real>(param1));
+    break;
+  case 5:
+    draw(std::chi_squared_distribution<Real>(param1));
+    break;
+  case 6:
+    draw(std::gamma_distribution<Real>(param1, param2));
+    break;
+  case 7:
+    draw(std::lognormal_distribution<Real>(param1, param2));
+    break;
+  case 8:
+    draw(std::extreme_value_distribution<Real>(param1, param2));
+    break;
+  default:
+    draw(std::normal_distribution<Real>(param1, param2));
+    break;
+  }
+}
+
+// the items of the LDP binaries
+inline void ldp_generate(double *items, long len, long dist, double param1,
+                         double param2, std::mt19937 &gen) {
+  draw_items<double>(len, dist, param1, param2, gen,
+                     [&](long i, double v) { items[i] = v; });
+}
+
+// the items of the central binaries: float values scaled by 1000 and
+// truncated
+template <typename Engine>
+inline void central_generate(int *items, long len, long dist, float param1,
+                             float param2, Engine &gen) {
+  draw_items<float>(len, dist, param1, param2, gen,
+                    [&](long i, float v) { items[i] = v * 1000.0; });
+}
+
+// where the items of a binary come from, for its log ("" for an unknown dist)
+inline std::string dist_description(long dist, double param1, double param2,
+                                    long seed) {
+  static const char *what[DISTS + 1] = {
+      NULL,
+      "normal distribution with parameters mu=%.6f and sigma=%.6f",
+      "cauchy distribution with parameters a=%.6f and b=%.6f",
+      "uniform distribution with parameters a=%.6f and b=%.6f",
+      "exponential distribution with parameter a=%.6f",
+      "chi squared distribution with parameter a=%.6f",
+      "gamma distribution with parameters a=%.6f and b=%.6f",
+      "lognormal distribution with parameters a=%.6f and b=%.6f",
+      "extreme value distribution with parameters a=%.6f and b=%.6f"};
+  if (!dist_known(dist))
+    return "";
+  char params[128], line[192];
+  snprintf(params, sizeof(params), what[dist], param1, param2);
+  snprintf(line, sizeof(line), "using the %s and seed %ld", params, seed);
+  return line;
+}
+
+// The row of an LDP binary. estimate is the qv column (ldpq writes its
+// normalised estimate); the errors are those of the estimate in the domain.
+inline std::string ldp_row(long len, double quantile, double eps,
+                           const char *dist, double param1, double param2,
+                           long seed, double estimate, double truth,
+                           double relative_error, double abs_error,
+                           double norm_abs_error, double range, double smin,
+                           double smax, double elapsed) {
+  char row[512];
+  snprintf(row, sizeof(row),
+           "%ld,%.2f,%.3f,%s,%.6f,%.6f,%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,"
+           "%.6f,%.6f,%ld",
+           len, quantile, eps, dist, param1, param2, seed, estimate, truth,
+           relative_error, abs_error, norm_abs_error, range, smin, smax,
+           elapsed, lround(len / elapsed));
+  return row;
+}
+
+// relative error of a central release against the true item, NAN without it
+inline float release_error(float release, int truth, bool has_truth) {
+  return !has_truth ? NAN
+                    : fabs((release - (float)(truth / 1000.0)) /
+                           (float)(truth / 1000.0));
+}
+
+// The releases of frugal_1u's estimate (an item): the Laplace noise from a
+// boost mt19937 seeded with seed, then the Gaussian and zCDP noise from
+// generator, the one that drew the items.
+struct Frugal1URelease {
+  float laplace;
+  float gaussian;
+  float zcdp;
+  float laplace_error; // relative, NAN without the truth
+  float gaussian_error;
+  float zcdp_error;
+};
+
+inline Frugal1URelease frugal_1u_release(int estimate, int truth,
+                                         bool has_truth, int sensitivity,
+                                         float epsilon, float delta, float rho,
+                                         long seed, std::mt19937 &generator) {
+  Frugal1URelease r;
+  const double value = (float)estimate / 1000.0;
+
+  boost::random::mt19937 rng(seed);
+  boost::random::laplace_distribution<float> laplace(0.0, sensitivity / epsilon);
+  r.laplace = value + laplace(rng);
+
+  float sigma = sqrt((2 * pow(sensitivity, 2.0) * log(1.25 / delta)) /
+                     pow(epsilon, 2.0));
+  std::normal_distribution<float> normal(0.0, sigma);
+  r.gaussian = value + normal(generator);
+
+  sigma = sqrt(pow(sensitivity, 2.0) / (2.0 * rho));
+  std::normal_distribution<float> normalz(0.0, sigma);
+  r.zcdp = value + normalz(generator);
+
+  r.laplace_error = release_error(r.laplace, truth, has_truth);
+  r.gaussian_error = release_error(r.gaussian, truth, has_truth);
+  r.zcdp_error = release_error(r.zcdp, truth, has_truth);
+  return r;
+}
+
+inline std::string frugal_1u_row(long len, float quantile, const char *dist,
+                                 float param1, float param2, long seed,
+                                 int estimate, int truth, bool has_truth,
+                                 double elapsed, int sensitivity,
+                                 float epsilon, float delta, float rho,
+                                 const Frugal1URelease &r) {
+  char row[512];
+  snprintf(row, sizeof(row),
+           "%ld, %.2f, %s, %.6f, %.6f, %ld, %.6f, %.6f, %.6f, %ld, %d, %.6f, "
+           "%.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f, %.6f",
+           len, quantile, dist, param1, param2, seed, (float)estimate / 1000.0,
+           !has_truth ? NAN : (float)truth / 1000.0, elapsed,
+           lround(len / elapsed), sensitivity, epsilon, delta, rho, r.laplace,
+           r.gaussian, r.zcdp, r.laplace_error, r.gaussian_error, r.zcdp_error);
+  return row;
+}
+
+// The Laplace release of frugal_2u's estimate (the mean of its chunks, an
+// item), whose sensitivity is the width of the domain over the chunks.
+struct Frugal2URelease {
+  float sensitivity;
+  float laplace;
+  float laplace_error; // relative, NAN without the truth
+};
+
+inline Frugal2URelease frugal_2u_release(float estimate, int truth,
+                                         bool has_truth, float lower,
+                                         float upper, int chunks,
+                                         float epsilon, long seed) {
+  Frugal2URelease r;
+  r.sensitivity = (upper - lower) / chunks;
+  boost::random::mt19937 rng(seed);
+  boost::random::laplace_distribution<float> laplace(
+      0.0, (upper - lower) / (chunks * epsilon));
+  r.laplace = (estimate / 1000.0) + laplace(rng);
+  r.laplace_error = release_error(r.laplace, truth, has_truth);
+  return r;
+}
+
+inline std::string frugal_2u_row(long len, float quantile, const char *dist,
+                                 float param1, float param2, long seed,
+                                 float estimate, int truth, bool has_truth,
+                                 double elapsed, float epsilon, int chunks,
+                                 const Frugal2URelease &r) {
+  char row[512];
+  snprintf(row, sizeof(row),
+           "%ld, %.2f, %s, %.6f, %.6f, %ld, %.6f, %.6f, %.6f, %ld, %.6f, %.6f, "
+           "%d, %.6f, %.6f",
+           len, quantile, dist, param1, param2, seed, estimate / 1000.0,
+           !has_truth ? NAN : (float)truth / 1000.0, elapsed,
+           lround(len / elapsed), epsilon, r.sensitivity, chunks, r.laplace,
+           r.laplace_error);
+  return row;
+}
+
+#endif //__WORKLOAD_H__
@@ -0,0 +1,212 @@
+/*
+ * Update throughput of the estimators through the C interface of
+ * libdpquantiles (dpquantiles.h), linked as a shared library, against the
+ * same estimators called natively: batch updates of -b items, and single
+ * item updates. The central estimators are fed int items, the LDP ones
+ * double values, as the binaries feed them. Every batch estimate is checked
+ * against the native one.
+ *
+ */
+
+#include "Frugal.h"
+#include "ItemStorage.h"
+#include "LdpKernels.h"
+#include "dpquantiles.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <random>
+#include <vector>
+
+void usage(void) {
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "-n <number of items> default: 10 millions of items\n");
+  fprintf(stderr, "-b <items per batch update> default: 4096\n");
+  fprintf(stderr, "-q <quantile> default: 0.9\n");
+  fprintf(stderr, "-r <repetitions> default: 3\n");
+  fprintf(stderr, "-s <seed> default: 1234\n");
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+struct Stream {
+  std::vector<double> values;
+  std::vector<int> items; // values scaled by 1000 and rounded
+  double lo;
+  double hi;
+};
+
+// the native estimators, with the parameters dpq_create() derives
+static double native_run(const dpq_params &p, const Stream &s) {
+  const long n = (long)s.values.size();
+  const double range = p.hi - p.lo;
+  double q, l;
+  square_wave_params(p.eps, &q, &l);
+  switch (p.algorithm) {
+  case DPQ_FRUGAL_1U: {
+    Frugal1U e(p.quantile, p.seed1);
+    e.update(s.items.data(), n);
+    return e.estimate / p.scale;
+  }
+  case DPQ_FRUGAL_2U: {
+    Frugal2U e(p.quantile, p.chunks, p.seed1);
+    e.update(s.items.data(), n);
+    return e.mean() / p.scale;
+  }
+  case DPQ_EASY_QUANTILE: {
+    EasyQuantile e(p.quantile, q, l, ezq_mode(p.quantile), p.seed1);
+    ldp_update(e, s.values.data(), n, p.lo, range, false);
+    return e.norm_quantile * range + p.lo;
+  }
+  case DPQ_FRUGAL_2U_SW: {
+    Frugal2USW e(p.quantile, q, l, p.prec, p.seed1, p.seed2);
+    ldp_update(e, s.values.data(), n, p.lo, range, false);
+    return e.integer_norm_quantile / p.prec * range + p.lo;
+  }
+  case DPQ_FRUGAL_1U_RR: {
+    Frugal1URR e(p.quantile, p.eps, p.prec, p.seed1, p.seed2);
+    ldp_update(e, s.values.data(), n, p.lo, range, false);
+    return e.integer_norm_quantile / p.prec * range + p.lo;
+  }
+  default: {
+    LDPQ e(p.quantile, p.eps, p.seed1, p.seed2);
+    ldp_update(e, s.values.data(), n, p.lo, range, false);
+    return e.Qn * range + p.lo;
+  }
+  }
+}
+
+// feeds the stream through the C interface, batch items per call (1: one
+// dpq_update() per item)
+static double capi_run(const dpq_params &p, const Stream &s, long batch) {
+  dpq_estimator *e;
+  int err = dpq_create(&p, &e);
+  if (err != DPQ_OK) {
+    fprintf(stderr, "dpq_create: %s\n", dpq_strerror(err));
+    exit(1);
+  }
+  const long n = (long)s.values.size();
+  const bool central = p.algorithm == DPQ_FRUGAL_1U ||
+                       p.algorithm == DPQ_FRUGAL_2U;
+  // single items are values, which dpq_update() scales for the central ones
+  if (batch == 1)
+    for (long i = 0; i < n; i++)
+      dpq_update(e, s.values[i]);
+  else
+    for (long i = 0; i < n; i += batch) {
+      const long m = std::min(batch, n - i);
+      if (central)
+        dpq_update_batch_i32(e, s.items.data() + i, m);
+      else
+        dpq_update_batch(e, s.values.data() + i, m);
+    }
+  double estimate = NAN;
+  dpq_estimate(e, &estimate);
+  dpq_destroy(e);
+  return estimate;
+}
+
+// best time over reps of run(), which returns an estimate
+template <typename F>
+static double best_time(int reps, F run, double *estimate) {
+  double best = 1e30;
+  for (int r = 0; r < reps; r++) {
+    auto begin = std::chrono::steady_clock::now();
+    *estimate = run();
+    best = std::min(best, seconds_since(begin));
+  }
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  long len = 10000000;
+  long batch = 4096;
+  double quantile = 0.9;
+  int reps = 3;
+  long seed = 1234;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:b:q:r:s:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      len = strtol(optarg, NULL, 10);
+      break;
+    case 'b':
+      batch = strtol(optarg, NULL, 10);
+      break;
+    case 'q':
+      quantile = strtod(optarg, NULL);
+      break;
+    case 'r':
+      reps = atoi(optarg);
+      break;
+    case 's':
+      seed = strtol(optarg, NULL, 10);
+      break;
+    default:
+      usage();
+      return 1;
+    }
+  }
+  if (len < 1 || batch < 1 || reps < 1 || !(quantile > 0 && quantile < 1)) {
+    usage();
+    return 1;
+  }
+
+  Stream s;
+  std::mt19937 generator(seed);
+  std::normal_distribution<double> normal(0.0, 1.0);
+  s.values.resize(len);
+  s.items.resize(len);
+  for (long i = 0; i < len; i++) {
+    s.values[i] = normal(generator);
+    s.items[i] = (int)lround(s.values[i] * 1000.0);
+  }
+  s.lo = *std::min_element(s.values.begin(), s.values.end());
+  s.hi = *std::max_element(s.values.begin(), s.values.end());
+
+  static const struct {
+    int algorithm;
+    const char *name;
+  } algorithms[] = {{DPQ_FRUGAL_1U, "frugal_1u"},
+                    {DPQ_FRUGAL_2U, "frugal_2u"},
+                    {DPQ_EASY_QUANTILE, "ezq-sw"},
+                    {DPQ_FRUGAL_2U_SW, "frugal2u-sw"},
+                    {DPQ_FRUGAL_1U_RR, "frugal1u-rr"},
+                    {DPQ_LDPQ, "ldpq"}};
+
+  fprintf(stdout, "%ld items, batches of %ld, q = %.3f, best of %d\n", len,
+          batch, quantile, reps);
+  fprintf(stdout, "%-12s %14s %14s %8s %14s\n", "algorithm", "native",
+          "batch", "ratio", "single");
+  for (const auto &a : algorithms) {
+    dpq_params p;
+    dpq_params_init(&p, a.algorithm);
+    p.quantile = quantile;
+    p.seed1 = seed + 1;
+    p.seed2 = seed + 2;
+    p.lo = s.lo;
+    p.hi = s.hi;
+
+    double native_est, batch_est, single_est;
+    const double native =
+        best_time(reps, [&] { return native_run(p, s); }, &native_est);
+    const double batched =
+        best_time(reps, [&] { return capi_run(p, s, batch); }, &batch_est);
+    const double single =
+        best_time(reps, [&] { return capi_run(p, s, 1); }, &single_est);
+    fprintf(stdout, "%-12s %8.1f Mupd/s %8.1f Mupd/s %7.1f%% %8.1f Mupd/s%s\n",
+            a.name, len / native / 1e6, len / batched / 1e6,
+            100.0 * native / batched, len / single / 1e6,
+            (batch_est == native_est && single_est == native_est)
+                ? ""
+                : "  ESTIMATE MISMATCH");
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Decode throughput of the block-compressed item format, scalar and
+ * vectorised, and of the Frugal-1U kernel fed from decoded blocks versus a
+ * raw in-memory array.
+ *
+ */
+
+#include "Frugal.h"
+#include "ItemCodec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <random>
+#include <vector>
+
+void usage(void) {
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "-n <number of items> default: 50 millions of items\n");
+  fprintf(stderr, "-k <trace: 1(normal iid)|2(random walk)|3(uniform iid)> default: 2\n");
+  fprintf(stderr, "-r <repetitions> default: 5\n");
+  fprintf(stderr, "-s <seed> default: 1234\n");
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+// decodes every block of buf into out, returns the number of items
+static long decode_all(const std::vector<unsigned char> &buf, int *out) {
+  size_t pos = 0;
+  long n = 0;
+  while (pos < buf.size()) {
+    n += item_decode_block(&buf[pos], out + n);
+    pos += item_block_size(&buf[pos]);
+  }
+  return n;
+}
+
+// Round trip of a partial block, and rejection of the block headers a
+// corrupt file can hold. Exits on a failure.
+static void check_blocks(const std::vector<int> &items) {
+  unsigned char block[ITEM_MAX_BLOCK_BYTES];
+  int out[ITEM_BLOCK];
+  const int count = ITEM_BLOCK / 2 + 3;
+  item_encode_block(items.data(), count, block);
+  if (item_decode_block(block, out) != count ||
+      memcmp(out, items.data(), count * sizeof(int))) {
+    fprintf(stderr, "partial block does not round trip\n");
+    exit(1);
+  }
+
+  ItemBlockHeader valid;
+  memcpy(&valid, block, sizeof(valid));
+  for (int c = 0; c < 5; c++) {
+    ItemBlockHeader h = valid;
+    if (c == 0)
+      h.width = 33;
+    else if (c == 1)
+      h.width = 120;
+    else if (c == 2)
+      h.mode = ITEM_DELTA + 1;
+    else if (c == 3)
+      h.count = 0;
+    else
+      h.count = ITEM_BLOCK + 1;
+    memcpy(block, &h, sizeof(h));
+    if (item_decode_block(block, out) != -1) {
+      fprintf(stderr, "corrupt block header %d was decoded\n", c);
+      exit(1);
+    }
+  }
+  fprintf(stdout, "partial block round trip and corrupt headers: ok\n");
+}
+
+int main(int argc, char **argv) {
+
+  long len = 50000000;
+  int kind = 2;
+  int reps = 5;
+  long seed = 1234;
+
+  int opt;
+
+  while ((opt = getopt(argc, argv, ":n:k:r:s:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      len = strtol(optarg, NULL, 10);
+      break;
+    case 'k':
+      kind = strtol(optarg, NULL, 10);
+      break;
+    case 'r':
+      reps = strtol(optarg, NULL, 10);
+      break;
+    case 's':
+      seed = strtol(optarg, NULL, 10);
+      break;
+    default:
+      usage();
+      exit(1);
+    }
+  }
+
+  // round up so that every block is full
+  len = (len + ITEM_BLOCK - 1) / ITEM_BLOCK * ITEM_BLOCK;
+
+  std::vector<int> items(len);
+  std::vector<int> decoded(len);
+  std::mt19937 generator(seed);
+  std::normal_distribution<float> normal(50.0, 2.0);
+  std::uniform_real_distribution<float> uniform(0.0, 1000.0);
+  float walk = 50.0;
+
+  for (long i = 0; i < len; i++) {
+    switch (kind) {
+    case 1:
+      items[i] = normal(generator) * 1000.0;
+      break;
+    case 3:
+      items[i] = uniform(generator) * 1000.0;
+      break;
+    default:
+      walk += (normal(generator) - 50.0) * 0.01;
+      items[i] = walk * 1000.0;
+      break;
+    }
+  }
+
+  check_blocks(items);
+
+  std::vector<unsigned char> buf(len / ITEM_BLOCK * ITEM_MAX_BLOCK_BYTES);
+  size_t bytes = 0;
+  for (long i = 0; i < len; i += ITEM_BLOCK)
+    bytes += item_encode_block(&items[i], ITEM_BLOCK, &buf[bytes]);
+  buf.resize(bytes);
+
+  fprintf(stdout, "items: %ld raw bytes: %ld packed bytes: %lu ratio: %.2fx (%.2f bits/item)\n",
+          len, len * 4, (unsigned long)bytes, 4.0 * len / bytes, 8.0 * bytes / len);
+
+  // raw copy as the memory bandwidth reference
+  double best = 1e30;
+  for (int r = 0; r < reps; r++) {
+    auto t = std::chrono::steady_clock::now();
+    memcpy(decoded.data(), items.data(), len * sizeof(int));
+    double s = seconds_since(t);
+    best = (s < best) ? s : best;
+  }
+  fprintf(stdout, "memcpy int32:   %8.1f Mitems/s %6.2f GB/s output\n",
+          len / best / 1e6, len * 4.0 / best / 1e9);
+
+  for (int simd = 0; simd <= item_codec_has_simd(); simd++) {
+    item_codec_simd = simd;
+    best = 1e30;
+    for (int r = 0; r < reps; r++) {
+      auto t = std::chrono::steady_clock::now();
+      decode_all(buf, decoded.data());
+      double s = seconds_since(t);
+      best = (s < best) ? s : best;
+    }
+    if (memcmp(decoded.data(), items.data(), len * sizeof(int))) {
+      fprintf(stderr, "decoded items differ from the input\n");
+      exit(1);
+    }
+    fprintf(stdout, "decode %s: %8.1f Mitems/s %6.2f GB/s output %6.2f GB/s input\n",
+            simd ? "avx2  " : "scalar", len / best / 1e6, len * 4.0 / best / 1e9,
+            bytes / best / 1e9);
+  }
+  item_codec_simd = 1;
+
+  // kernel on the raw array versus kernel fed block by block while decoding
+  Frugal1U raw(0.99, seed);
+  auto t = std::chrono::steady_clock::now();
+  raw.update(items.data(), len);
+  double s = seconds_since(t);
+  fprintf(stdout, "frugal-1u raw:    %8.1f Mitems/s\n", len / s / 1e6);
+
+  Frugal1U fed(0.99, seed);
+  int block[ITEM_BLOCK];
+  t = std::chrono::steady_clock::now();
+  for (size_t pos = 0; pos < bytes; pos += item_block_size(&buf[pos])) {
+    int n = item_decode_block(&buf[pos], block);
+    fed.update(block, n);
+  }
+  s = seconds_since(t);
+  fprintf(stdout, "frugal-1u packed: %8.1f Mitems/s (estimates %s)\n", len / s / 1e6,
+          raw.estimate == fed.estimate ? "match" : "DIFFER");
+
+  return 0;
+}
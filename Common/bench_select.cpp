@@ -0,0 +1,181 @@
+/*
+ * Selection time of introselect (scalar, AVX2 and AVX-512 partitioning)
+ * against std::nth_element on int and double items in sorted, reverse-sorted,
+ * many-duplicate, random and median-of-3-killer order, and of the radix
+ * histogram selection on the int items. Every result is checked against
+ * std::nth_element.
+ *
+ */
+
+#include "QuickSelect.h"
+#include "RadixSelect.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+void usage(void) {
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "-n <number of items> default: 10 millions of items\n");
+  fprintf(stderr, "-q <quantile> default: 0.9\n");
+  fprintf(stderr, "-r <repetitions> default: 3\n");
+  fprintf(stderr, "-s <seed> default: 1234\n");
+}
+
+static const char *kinds[] = {"sorted", "reverse", "duplicates", "random",
+                              "m3killer"};
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t)
+      .count();
+}
+
+template <typename T>
+static void fill(std::vector<T> &items, int kind, long seed) {
+  const long len = items.size();
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> values(0, 1 << 30);
+  std::uniform_int_distribution<int> few(0, 15);
+
+  for (long i = 0; i < len; i++) {
+    switch (kind) {
+    case 0:
+      items[i] = (T)i;
+      break;
+    case 1:
+      items[i] = (T)(len - i);
+      break;
+    case 2:
+      items[i] = (T)few(generator);
+      break;
+    default:
+      items[i] = (T)values(generator);
+      break;
+    }
+  }
+
+  // Musser's sequence, which drives median-of-3 quickselect to quadratic time
+  if (kind == 4) {
+    const long k = len / 2;
+    for (long i = 1; i <= k; i++) {
+      items[i - 1] = (T)((i % 2) ? i : k + i - 1);
+      items[k + i - 1] = (T)(2 * i);
+    }
+    if (len % 2)
+      items[len - 1] = (T)len;
+  }
+}
+
+// best time over reps of select(copy, k) on a fresh copy of items
+template <typename T, typename F>
+static double best_time(const std::vector<T> &items, std::vector<T> &work,
+                        int reps, F select) {
+  double best = 1e30;
+  for (int r = 0; r < reps; r++) {
+    work = items;
+    auto t = std::chrono::steady_clock::now();
+    select(work);
+    double s = seconds_since(t);
+    best = (s < best) ? s : best;
+  }
+  return best;
+}
+
+// radix_select only takes integer items
+static int radix_integral(const int *items, long len, long k) {
+  return radix_select(items, len, k);
+}
+
+static double radix_integral(const double *items, long len, long k) {
+  return 0.0;
+}
+
+template <typename T>
+static void bench(const char *type, long len, double quantile, int reps,
+                  long seed) {
+  std::vector<T> items(len), work(len);
+  const long k = (long)(len * quantile);
+
+  for (int kind = 0; kind < 5; kind++) {
+    fill(items, kind, seed);
+
+    T expected = T();
+    double s = best_time(items, work, reps, [&](std::vector<T> &w) {
+      std::nth_element(w.begin(), w.begin() + k, w.end());
+      expected = w[k];
+    });
+    fprintf(stdout, "%-6s %-10s nth_element      %8.1f Mitems/s\n", type,
+            kinds[kind], len / s / 1e6);
+
+    for (int simd = QSELECT_SCALAR; simd <= quickselect_has_simd(); simd++) {
+      static const char *names[] = {"scalar", "avx2", "avx512"};
+      quickselect_simd = simd;
+      T got = T();
+      s = best_time(items, work, reps, [&](std::vector<T> &w) {
+        got = quickselect(w.data(), len, k);
+      });
+      fprintf(stdout, "%-6s %-10s introselect %-6s %8.1f Mitems/s%s\n", type,
+              kinds[kind], names[simd], len / s / 1e6,
+              got == expected ? "" : " WRONG");
+      if (got != expected)
+        exit(1);
+    }
+    quickselect_simd = QSELECT_AVX512;
+
+    if (std::is_integral<T>::value) {
+      T got = T();
+      s = best_time(items, work, reps, [&](std::vector<T> &w) {
+        got = radix_integral(w.data(), len, k);
+      });
+      fprintf(stdout, "%-6s %-10s radix_select     %8.1f Mitems/s%s\n", type,
+              kinds[kind], len / s / 1e6, got == expected ? "" : " WRONG");
+      if (got != expected)
+        exit(1);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+
+  long len = 10000000;
+  double quantile = 0.9;
+  int reps = 3;
+  long seed = 1234;
+
+  int opt;
+
+  while ((opt = getopt(argc, argv, ":n:q:r:s:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      len = strtol(optarg, NULL, 10);
+      break;
+    case 'q':
+      quantile = strtod(optarg, NULL);
+      break;
+    case 'r':
+      reps = strtol(optarg, NULL, 10);
+      break;
+    case 's':
+      seed = strtol(optarg, NULL, 10);
+      break;
+    default:
+      usage();
+      exit(1);
+    }
+  }
+
+  if (len < 1 || quantile < 0.0 || quantile >= 1.0) {
+    usage();
+    exit(1);
+  }
+
+  bench<int>("int", len, quantile, reps, seed);
+  bench<double>("double", len, quantile, reps, seed);
+
+  return 0;
+}
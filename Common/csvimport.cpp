@@ -0,0 +1,174 @@
+/*
+ * Imports a column of a CSV/text trace as packed items, float64 values or
+ * text.
+ *
+ */
+
+#include "CsvImport.h"
+#include "ItemBuffer.h"
+#include "ItemCodec.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <sys/stat.h>
+
+void usage(void) {
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "-i <input> CSV file path\n");
+  fprintf(stderr, "-c <column> 0-based index or header name default: 0\n");
+  fprintf(stderr, "-d <delimiter> field delimiter default: ,\n");
+  fprintf(stderr, "-j <threads> parser threads, 0 for all cores default: 0\n");
+  fprintf(stderr, "-m <output format: packed|binary|text> default: packed\n");
+  fprintf(stderr, "-o <output> - (stdout) or a file path default: -\n");
+  fprintf(stderr, "-x <scale> fixed-point scale of packed items default: 1000\n");
+  fprintf(stderr, "-z normalise the values to [0, 1] (binary and text output)\n");
+}
+
+int main(int argc, char **argv) {
+
+  const char *source = NULL;
+  const char *output = "-";
+  const char *format = "packed";
+  long scale = 1000;
+  bool normalise = false;
+  CsvOptions csv;
+
+  csv_options_init(&csv);
+
+  int opt;
+
+  while ((opt = getopt(argc, argv, ":i:c:d:j:m:o:x:zh")) != -1) {
+    switch (opt) {
+    case 'i':
+      source = optarg;
+      break;
+    case 'c':
+      csv.column = optarg;
+      break;
+    case 'd':
+      csv.delim = (!strcmp(optarg, "\\t") || !strcmp(optarg, "tab")) ? '\t' : optarg[0];
+      break;
+    case 'j':
+      csv.threads = strtol(optarg, NULL, 10);
+      break;
+    case 'm':
+      format = optarg;
+      if (strcmp(format, "packed") && strcmp(format, "binary") &&
+          strcmp(format, "text")) {
+        fprintf(stderr, "Unknown output format: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'x':
+      scale = strtol(optarg, NULL, 10);
+      break;
+    case 'z':
+      normalise = true;
+      break;
+    case 'h':
+      usage();
+      exit(1);
+      break;
+    case '?':
+      fprintf(stderr, "Unknown option: %c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    case ':':
+      fprintf(stderr, "Missing argument for option -%c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    }
+  }
+
+  if (!source) {
+    fprintf(stderr, "Missing input file\n");
+    usage();
+    exit(1);
+  }
+  if (normalise && !strcmp(format, "packed")) {
+    fprintf(stderr, "Normalised values cannot be packed as items\n");
+    exit(1);
+  }
+  if (scale <= 0) {
+    fprintf(stderr, "Invalid scale: %ld\n", scale);
+    exit(1);
+  }
+
+  struct stat st;
+  if (stat(source, &st) < 0) {
+    fprintf(stderr, "Error opening input %s\n", source);
+    exit(1);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  long n;
+  int *items = NULL;
+  double *values = NULL;
+
+  if (!strcmp(format, "packed"))
+    n = csv_import_items(source, &csv, (double)scale, &items);
+  else
+    n = csv_import(source, &csv, &values);
+  if (n < 0)
+    exit(1);
+
+  double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "imported %ld values from %.1f MB in %f s (%.2f GB/s)\n", n,
+          st.st_size / 1e6, secs, st.st_size / secs / 1e9);
+
+  if (normalise && n > 0) {
+    double min = values[0];
+    double max = values[0];
+    for (long i = 1; i < n; i++) {
+      min = (values[i] < min) ? values[i] : min;
+      max = (values[i] > max) ? values[i] : max;
+    }
+    double range = (max > min) ? max - min : 1.0;
+    for (long i = 0; i < n; i++)
+      values[i] = (values[i] - min) / range;
+    fprintf(stderr, "normalised with min %f max %f\n", min, max);
+  }
+
+  int ret = 0;
+
+  if (items) {
+    ItemWriter w;
+    if (item_writer_open(&w, output, scale) || item_writer_put(&w, items, n) ||
+        item_writer_close(&w))
+      ret = 1;
+    else
+      fprintf(stderr, "%.2f bits/item\n", n ? w.bytes * 8.0 / n : 0.0);
+  } else {
+    FILE *fptr = strcmp(output, "-") ? fopen(output, "wb") : stdout;
+    if (!fptr) {
+      fprintf(stderr, "Error opening file %s\n", output);
+      exit(1);
+    }
+    if (!strcmp(format, "binary")) {
+      if ((long)fwrite(values, sizeof(double), n, fptr) != n)
+        ret = 1;
+    } else {
+      for (long i = 0; i < n; i++)
+        fprintf(fptr, "%.15g\n", values[i]);
+    }
+    if (fptr != stdout)
+      fclose(fptr);
+  }
+
+  if (ret)
+    fprintf(stderr, "Error writing %s\n", output);
+
+  item_free(items);
+  item_free(values);
+  return ret;
+}
@@ -0,0 +1,670 @@
+/*
+ * Python module dpq: the estimators, the randomizers and the exact
+ * selection, callable from a notebook at native speed. Built by
+ * "make python" as dpq.so, with the Python C API only:
+ *
+ *   import sys; sys.path.append('Common')
+ *   import dpq, numpy as np
+ *   items = np.random.default_rng(1).normal(size=10**8)
+ *   count, lo, hi, total = dpq.stats(items)
+ *   est = dpq.frugal2u_sw(0.99, 2.0, lo, hi, seed1=7, seed2=8)
+ *   est.update(items)
+ *   est.estimate(), dpq.select(items, int(0.99 * len(items)))
+ *
+ * Arrays are read through the buffer protocol, never copied: they must be
+ * C-contiguous and of a type the callee takes (float64 or float32 values for
+ * the LDP estimators; int32 or int16 items, values scaled by 1000 as the
+ * central binaries scale them, for Frugal-1U and Frugal-2U). Anything else
+ * raises TypeError or BufferError rather than being converted. The GIL is
+ * released while a kernel runs, so distinct estimators may be fed from
+ * several threads at once; an estimator already being fed raises
+ * RuntimeError.
+ *
+ * The LDP estimators take the parameters the binaries derive from eps, and
+ * normalise the items to [lo, hi]: the stream range, or with clip=True a
+ * public domain the items are clamped to.
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "Frugal.h"
+#include "ItemStorage.h"
+#include "LdpKernels.h"
+#include "ParallelSelect.h"
+#include "StreamStats.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#define LDP_PRECISION 1000000.0
+
+static const char *type_name(char type) {
+  switch (type) {
+  case 'd':
+    return "float64";
+  case 'f':
+    return "float32";
+  case 'i':
+    return "int32";
+  case 'h':
+    return "int16";
+  case 'b':
+    return "int8";
+  }
+  return "?";
+}
+
+// the item type of view, one of type_name()'s, or 0
+static char item_type(const Py_buffer &view) {
+  const char *f = view.format ? view.format : "B";
+  if (*f == '@' || *f == '=')
+    f++;
+  if (f[0] == '\0' || f[1] != '\0')
+    return 0;
+  const char type = f[0];
+  size_t size = 0;
+  switch (type) {
+  case 'd':
+    size = sizeof(double);
+    break;
+  case 'f':
+    size = sizeof(float);
+    break;
+  case 'i':
+    size = sizeof(int);
+    break;
+  case 'h':
+    size = sizeof(int16_t);
+    break;
+  case 'b':
+    size = sizeof(int8_t);
+    break;
+  }
+  return ((size_t)view.itemsize == size) ? type : 0;
+}
+
+// Gets a C-contiguous view of obj without copying it, and returns its item
+// type if it is one of types; otherwise sets an exception and returns 0.
+static char get_items(PyObject *obj, Py_buffer *view, const char *types,
+                      bool writable, const char *what) {
+  int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+  if (writable)
+    flags |= PyBUF_WRITABLE;
+  if (PyObject_GetBuffer(obj, view, flags) < 0)
+    return 0;
+  const char type = item_type(*view);
+  if (type && strchr(types, type))
+    return type;
+  std::string expected;
+  for (const char *t = types; *t; t++)
+    expected += std::string(expected.empty() ? "" : " or ") + type_name(*t);
+  PyErr_Format(PyExc_TypeError, "%s must be %s, not '%s'", what,
+               expected.c_str(), view->format ? view->format : "B");
+  PyBuffer_Release(view);
+  return 0;
+}
+
+/*
+ * Estimators
+ */
+
+struct Engine {
+  virtual ~Engine() {}
+  virtual const char *types() const = 0; // the item types update() takes
+  // feeds n items of type; runs without the GIL
+  virtual void update(char type, const void *items, long n) = 0;
+  virtual double estimate() const = 0;
+  virtual long count() const = 0;
+};
+
+// Frugal-1U and Frugal-2U on integer items; the estimate is in item units
+inline double central_estimate(const Frugal1U &e) { return e.estimate; }
+inline double central_estimate(const Frugal2U &e) { return e.mean(); }
+
+template <typename E> struct CentralEngine : Engine {
+  E est;
+
+  explicit CentralEngine(const E &est) : est(est) {}
+  const char *types() const override { return "ih"; }
+  void update(char type, const void *items, long n) override {
+    if (type == 'i')
+      est.update((const int *)items, n);
+    else
+      est.update((const int16_t *)items, n);
+  }
+  double estimate() const override { return central_estimate(est); }
+  long count() const override { return est.count; }
+};
+
+// the LDP estimates, normalised to [0, 1]
+inline double norm_estimate(const EasyQuantile &e) { return e.norm_quantile; }
+inline double norm_estimate(const Frugal2USW &e) {
+  return (double)e.integer_norm_quantile / e.prec;
+}
+inline double norm_estimate(const Frugal1URR &e) {
+  return (double)e.integer_norm_quantile / e.prec;
+}
+inline double norm_estimate(const LDPQ &e) { return e.Qn; }
+
+inline long ldp_count(const LDPQ &e) { return e.n; }
+template <typename E> long ldp_count(const E &e) { return e.count; }
+
+template <typename E> struct LocalEngine : Engine {
+  E est;
+  double smin;
+  double range;
+  bool clip;
+
+  LocalEngine(const E &est, double lo, double hi, bool clip)
+      : est(est), smin(lo), range(hi - lo), clip(clip) {}
+  const char *types() const override { return "df"; }
+  void update(char type, const void *items, long n) override {
+    if (type == 'd')
+      ldp_update(est, (const double *)items, n, smin, range, clip);
+    else
+      ldp_update(est, (const float *)items, n, smin, range, clip);
+  }
+  double estimate() const override {
+    return norm_estimate(est) * range + smin;
+  }
+  long count() const override { return ldp_count(est); }
+};
+
+struct EstimatorObject {
+  PyObject_HEAD
+  Engine *engine;
+  const char *name;
+  bool busy; // being fed, by a thread that released the GIL
+};
+
+static void estimator_dealloc(EstimatorObject *self) {
+  delete self->engine;
+  Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *estimator_repr(EstimatorObject *self) {
+  return PyUnicode_FromFormat("<dpq.Estimator %s, %ld items>", self->name,
+                              self->engine->count());
+}
+
+static PyObject *estimator_update(EstimatorObject *self, PyObject *items) {
+  Py_buffer view;
+  const char type = get_items(items, &view, self->engine->types(), false,
+                              "items");
+  if (!type)
+    return NULL;
+  if (self->busy) {
+    PyBuffer_Release(&view);
+    PyErr_SetString(PyExc_RuntimeError,
+                    "the estimator is being fed by another thread");
+    return NULL;
+  }
+  self->busy = true;
+  Engine *engine = self->engine;
+  const long n = (long)(view.len / view.itemsize);
+  Py_BEGIN_ALLOW_THREADS
+  engine->update(type, view.buf, n);
+  Py_END_ALLOW_THREADS
+  self->busy = false;
+  PyBuffer_Release(&view);
+  Py_RETURN_NONE;
+}
+
+static PyObject *estimator_estimate(EstimatorObject *self, PyObject *) {
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError,
+                    "the estimator is being fed by another thread");
+    return NULL;
+  }
+  if (self->engine->count() == 0)
+    return PyFloat_FromDouble(NAN);
+  return PyFloat_FromDouble(self->engine->estimate());
+}
+
+static PyObject *estimator_count(EstimatorObject *self, void *) {
+  return PyLong_FromLong(self->engine->count());
+}
+
+static PyMethodDef estimator_methods[] = {
+    {"update", (PyCFunction)estimator_update, METH_O,
+     "update(items): feeds the items of an array, in order"},
+    {"estimate", (PyCFunction)estimator_estimate, METH_NOARGS,
+     "estimate(): the current estimate, in item units"},
+    {NULL, NULL, 0, NULL}};
+
+static PyGetSetDef estimator_getset[] = {
+    {"count", (getter)estimator_count, NULL, "number of items fed", NULL},
+    {NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject EstimatorType = {PyVarObject_HEAD_INIT(NULL, 0)};
+
+static PyObject *new_estimator(const char *name, Engine *engine) {
+  EstimatorObject *self = PyObject_New(EstimatorObject, &EstimatorType);
+  if (!self) {
+    delete engine;
+    return NULL;
+  }
+  self->engine = engine;
+  self->name = name;
+  self->busy = false;
+  return (PyObject *)self;
+}
+
+static bool check_quantile(double quantile) {
+  if (quantile > 0.0 && quantile < 1.0)
+    return true;
+  PyErr_SetString(PyExc_ValueError, "quantile must be in (0, 1)");
+  return false;
+}
+
+static bool check_ldp(double quantile, double eps, double lo, double hi) {
+  if (!check_quantile(quantile))
+    return false;
+  if (!(eps > 0.0)) {
+    PyErr_SetString(PyExc_ValueError, "eps must be positive");
+    return false;
+  }
+  if (!(lo < hi)) {
+    PyErr_SetString(PyExc_ValueError, "lo must be less than hi");
+    return false;
+  }
+  return true;
+}
+
+static PyObject *dpq_frugal1u(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"quantile", "seed", NULL};
+  double quantile;
+  long seed = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "d|l", (char **)kwlist,
+                                   &quantile, &seed) ||
+      !check_quantile(quantile))
+    return NULL;
+  return new_estimator("frugal1u", new CentralEngine<Frugal1U>(
+                                       Frugal1U(quantile, seed)));
+}
+
+static PyObject *dpq_frugal2u(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"quantile", "chunks", "seed", "lo", "hi",
+                                 NULL};
+  double quantile;
+  int chunks = 4;
+  long seed = 1;
+  int lo = INT_MIN, hi = INT_MAX;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "d|ilii", (char **)kwlist,
+                                   &quantile, &chunks, &seed, &lo, &hi) ||
+      !check_quantile(quantile))
+    return NULL;
+  if (chunks < 1 || lo > hi) {
+    PyErr_SetString(PyExc_ValueError,
+                    "chunks must be positive and lo at most hi");
+    return NULL;
+  }
+  Frugal2U est(quantile, chunks, seed);
+  est.clip(lo, hi);
+  return new_estimator("frugal2u", new CentralEngine<Frugal2U>(est));
+}
+
+static PyObject *dpq_easy_quantile(PyObject *, PyObject *args,
+                                   PyObject *kwds) {
+  static const char *kwlist[] = {"quantile", "eps", "lo", "hi", "clip",
+                                 "seed", NULL};
+  double quantile, eps, lo, hi, q, l;
+  int clip = 0;
+  long seed = 1;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "dddd|pl", (char **)kwlist,
+                                   &quantile, &eps, &lo, &hi, &clip, &seed) ||
+      !check_ldp(quantile, eps, lo, hi))
+    return NULL;
+  square_wave_params(eps, &q, &l);
+  const int mode = ezq_mode(quantile);
+  return new_estimator("easy_quantile",
+                       new LocalEngine<EasyQuantile>(
+                           EasyQuantile(quantile, q, l, mode, seed), lo, hi,
+                           clip));
+}
+
+static PyObject *dpq_frugal2u_sw(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"quantile", "eps",   "lo",    "hi", "clip",
+                                 "seed1",    "seed2", "prec",  NULL};
+  double quantile, eps, lo, hi, q, l;
+  int clip = 0;
+  long seed1 = 1, seed2 = 2;
+  double prec = LDP_PRECISION;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "dddd|plld", (char **)kwlist,
+                                   &quantile, &eps, &lo, &hi, &clip, &seed1,
+                                   &seed2, &prec) ||
+      !check_ldp(quantile, eps, lo, hi))
+    return NULL;
+  square_wave_params(eps, &q, &l);
+  return new_estimator("frugal2u_sw",
+                       new LocalEngine<Frugal2USW>(
+                           Frugal2USW(quantile, q, l, prec, seed1, seed2), lo,
+                           hi, clip));
+}
+
+static PyObject *dpq_frugal1u_rr(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"quantile", "eps",   "lo",   "hi", "clip",
+                                 "seed1",    "seed3", "prec", NULL};
+  double quantile, eps, lo, hi;
+  int clip = 0;
+  long seed1 = 1, seed3 = 3;
+  double prec = LDP_PRECISION;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "dddd|plld", (char **)kwlist,
+                                   &quantile, &eps, &lo, &hi, &clip, &seed1,
+                                   &seed3, &prec) ||
+      !check_ldp(quantile, eps, lo, hi))
+    return NULL;
+  return new_estimator("frugal1u_rr",
+                       new LocalEngine<Frugal1URR>(
+                           Frugal1URR(quantile, eps, prec, seed1, seed3), lo,
+                           hi, clip));
+}
+
+static PyObject *dpq_ldpq(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"quantile", "eps",   "lo",    "hi",
+                                 "clip",     "seed1", "seed2", NULL};
+  double quantile, eps, lo, hi;
+  int clip = 0;
+  long seed1 = 1, seed2 = 2;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "dddd|pll", (char **)kwlist,
+                                   &quantile, &eps, &lo, &hi, &clip, &seed1,
+                                   &seed2) ||
+      !check_ldp(quantile, eps, lo, hi))
+    return NULL;
+  return new_estimator("ldpq", new LocalEngine<LDPQ>(
+                                   LDPQ(quantile, eps, seed1, seed2), lo, hi,
+                                   clip));
+}
+
+/*
+ * Randomizers: each perturbs the items of values into out, an array of the
+ * same length, as one user per item; out is returned.
+ */
+
+// views of values and out, of the same length; false with an exception set
+static bool get_values_out(PyObject *values, PyObject *out, Py_buffer *vin,
+                           Py_buffer *vout, const char *in_types,
+                           const char *out_types) {
+  if (!get_items(values, vin, in_types, false, "values"))
+    return false;
+  if (!get_items(out, vout, out_types, true, "out")) {
+    PyBuffer_Release(vin);
+    return false;
+  }
+  if (vin->len / vin->itemsize != vout->len / vout->itemsize) {
+    PyErr_SetString(PyExc_ValueError, "values and out differ in length");
+    PyBuffer_Release(vin);
+    PyBuffer_Release(vout);
+    return false;
+  }
+  return true;
+}
+
+static PyObject *release_values_out(PyObject *out, Py_buffer *vin,
+                                    Py_buffer *vout) {
+  PyBuffer_Release(vin);
+  PyBuffer_Release(vout);
+  Py_INCREF(out);
+  return out;
+}
+
+static PyObject *dpq_square_wave(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"values", "out", "eps", "seed", NULL};
+  PyObject *values, *out;
+  double eps, q, l;
+  long seed = 1;
+  Py_buffer vin, vout;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOd|l", (char **)kwlist,
+                                   &values, &out, &eps, &seed) ||
+      !get_values_out(values, out, &vin, &vout, "d", "d"))
+    return NULL;
+  square_wave_params(eps, &q, &l);
+  const double *v = (const double *)vin.buf;
+  double *o = (double *)vout.buf;
+  const long n = (long)(vin.len / vin.itemsize);
+  Py_BEGIN_ALLOW_THREADS
+  std::mt19937 gen1(seed);
+  for (long i = 0; i < n; i++)
+    o[i] = square_wave_randomizer(q, l, v[i], gen1);
+  Py_END_ALLOW_THREADS
+  return release_values_out(out, &vin, &vout);
+}
+
+static PyObject *dpq_randomized_response(PyObject *, PyObject *args,
+                                         PyObject *kwds) {
+  static const char *kwlist[] = {"values", "out", "threshold", "eps", "seed",
+                                 NULL};
+  PyObject *values, *out;
+  int threshold;
+  double eps;
+  long seed = 1;
+  Py_buffer vin, vout;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOid|l", (char **)kwlist,
+                                   &values, &out, &threshold, &eps, &seed) ||
+      !get_values_out(values, out, &vin, &vout, "i", "b"))
+    return NULL;
+  const double p = exp(eps) / (exp(eps) + 1);
+  const int *v = (const int *)vin.buf;
+  int8_t *o = (int8_t *)vout.buf;
+  const long n = (long)(vin.len / vin.itemsize);
+  Py_BEGIN_ALLOW_THREADS
+  std::mt19937 gen1(seed);
+  for (long i = 0; i < n; i++)
+    o[i] = (int8_t)randomized_response(threshold, p, v[i], gen1);
+  Py_END_ALLOW_THREADS
+  return release_values_out(out, &vin, &vout);
+}
+
+static PyObject *dpq_ldp_randomized_response(PyObject *, PyObject *args,
+                                             PyObject *kwds) {
+  static const char *kwlist[] = {"values", "out",   "threshold", "eps",
+                                 "seed1",  "seed2", NULL};
+  PyObject *values, *out;
+  double threshold, eps;
+  long seed1 = 1, seed2 = 2;
+  Py_buffer vin, vout;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOdd|ll", (char **)kwlist,
+                                   &values, &out, &threshold, &eps, &seed1,
+                                   &seed2) ||
+      !get_values_out(values, out, &vin, &vout, "d", "b"))
+    return NULL;
+  const double r = std::tanh(eps / 2.0);
+  const double *v = (const double *)vin.buf;
+  int8_t *o = (int8_t *)vout.buf;
+  const long n = (long)(vin.len / vin.itemsize);
+  Py_BEGIN_ALLOW_THREADS
+  std::mt19937 gen1(seed1), gen2(seed2);
+  for (long i = 0; i < n; i++)
+    o[i] = (int8_t)ldp_randomized_response(threshold, r, v[i], gen1, gen2);
+  Py_END_ALLOW_THREADS
+  return release_values_out(out, &vin, &vout);
+}
+
+/*
+ * Ground truth
+ */
+
+template <typename T>
+static void select_ranks(const Py_buffer &view, const std::vector<long> &ranks,
+                         std::vector<double> *values, int threads) {
+  // parallel_multi_select takes the ranks ascending
+  std::vector<long> order(ranks.size()), sorted(ranks.size());
+  std::iota(order.begin(), order.end(), 0L);
+  std::sort(order.begin(), order.end(),
+            [&](long a, long b) { return ranks[a] < ranks[b]; });
+  for (size_t i = 0; i < order.size(); i++)
+    sorted[i] = ranks[order[i]];
+  std::vector<T> out(ranks.size());
+  parallel_multi_select((const T *)view.buf, (long)(view.len / view.itemsize),
+                        sorted.data(), (int)sorted.size(), out.data(),
+                        threads);
+  values->resize(ranks.size());
+  for (size_t i = 0; i < order.size(); i++)
+    (*values)[order[i]] = (double)out[i];
+}
+
+static PyObject *dpq_select(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"items", "ranks", "threads", NULL};
+  PyObject *items, *rank_arg;
+  int threads = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|i", (char **)kwlist,
+                                   &items, &rank_arg, &threads))
+    return NULL;
+
+  // a single rank, or a sequence of them
+  const bool single = PyLong_Check(rank_arg);
+  std::vector<long> ranks;
+  if (single) {
+    ranks.push_back(PyLong_AsLong(rank_arg));
+  } else {
+    PyObject *seq = PySequence_Fast(rank_arg, "ranks must be an int or a "
+                                              "sequence of ints");
+    if (!seq)
+      return NULL;
+    for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); i++)
+      ranks.push_back(PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i)));
+    Py_DECREF(seq);
+  }
+  if (PyErr_Occurred())
+    return NULL;
+
+  Py_buffer view;
+  const char type = get_items(items, &view, "dfi", false, "items");
+  if (!type)
+    return NULL;
+  const long n = (long)(view.len / view.itemsize);
+  for (long r : ranks)
+    if (r < 0 || r >= n) {
+      PyBuffer_Release(&view);
+      PyErr_Format(PyExc_IndexError, "rank %ld out of [0, %ld)", r, n);
+      return NULL;
+    }
+
+  std::vector<double> values;
+  Py_BEGIN_ALLOW_THREADS
+  if (type == 'd')
+    select_ranks<double>(view, ranks, &values, threads);
+  else if (type == 'f')
+    select_ranks<float>(view, ranks, &values, threads);
+  else
+    select_ranks<int>(view, ranks, &values, threads);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&view);
+
+  auto value = [&](double v) {
+    return (type == 'i') ? PyLong_FromLong((long)v) : PyFloat_FromDouble(v);
+  };
+  if (single)
+    return value(values[0]);
+  PyObject *list = PyList_New((Py_ssize_t)values.size());
+  if (!list)
+    return NULL;
+  for (size_t i = 0; i < values.size(); i++) {
+    PyObject *v = value(values[i]);
+    if (!v) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, (Py_ssize_t)i, v);
+  }
+  return list;
+}
+
+static PyObject *dpq_stats(PyObject *, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"items", "threads", NULL};
+  PyObject *items;
+  int threads = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|i", (char **)kwlist,
+                                   &items, &threads))
+    return NULL;
+  Py_buffer view;
+  const char type = get_items(items, &view, "di", false, "items");
+  if (!type)
+    return NULL;
+  const long n = (long)(view.len / view.itemsize);
+  StreamStats s;
+  Py_BEGIN_ALLOW_THREADS
+  if (type == 'd')
+    s = stream_stats((const double *)view.buf, n, threads);
+  else
+    s = stream_stats((const int *)view.buf, n, threads);
+  Py_END_ALLOW_THREADS
+  PyBuffer_Release(&view);
+  return Py_BuildValue("(lddd)", s.count, s.min, s.max, s.sum);
+}
+
+#define KW (PyCFunction)(void (*)(void))
+static PyMethodDef dpq_methods[] = {
+    {"frugal1u", KW dpq_frugal1u, METH_VARARGS | METH_KEYWORDS,
+     "frugal1u(quantile, seed=1): Frugal-1U on int items"},
+    {"frugal2u", KW dpq_frugal2u, METH_VARARGS | METH_KEYWORDS,
+     "frugal2u(quantile, chunks=4, seed=1, lo=INT_MIN, hi=INT_MAX): "
+     "Frugal-2U on int items, clamped to [lo, hi]"},
+    {"easy_quantile", KW dpq_easy_quantile, METH_VARARGS | METH_KEYWORDS,
+     "easy_quantile(quantile, eps, lo, hi, clip=False, seed=1): EasyQuantile "
+     "with Square Wave"},
+    {"frugal2u_sw", KW dpq_frugal2u_sw, METH_VARARGS | METH_KEYWORDS,
+     "frugal2u_sw(quantile, eps, lo, hi, clip=False, seed1=1, seed2=2, "
+     "prec=1e6): Frugal-2U with Square Wave"},
+    {"frugal1u_rr", KW dpq_frugal1u_rr, METH_VARARGS | METH_KEYWORDS,
+     "frugal1u_rr(quantile, eps, lo, hi, clip=False, seed1=1, seed3=3, "
+     "prec=1e6): Frugal-1U with Randomized Response"},
+    {"ldpq", KW dpq_ldpq, METH_VARARGS | METH_KEYWORDS,
+     "ldpq(quantile, eps, lo, hi, clip=False, seed1=1, seed2=2): LDPQ"},
+    {"square_wave", KW dpq_square_wave, METH_VARARGS | METH_KEYWORDS,
+     "square_wave(values, out, eps, seed=1): Square Wave of float64 values "
+     "in [0, 1] into float64 out"},
+    {"randomized_response", KW dpq_randomized_response,
+     METH_VARARGS | METH_KEYWORDS,
+     "randomized_response(values, out, threshold, eps, seed=1): whether each "
+     "int32 value is above threshold, by Randomized Response, into int8 out"},
+    {"ldp_randomized_response", KW dpq_ldp_randomized_response,
+     METH_VARARGS | METH_KEYWORDS,
+     "ldp_randomized_response(values, out, threshold, eps, seed1=1, "
+     "seed2=2): the LDPQ response of each float64 value into int8 out"},
+    {"select", KW dpq_select, METH_VARARGS | METH_KEYWORDS,
+     "select(items, ranks, threads=0): the items of the given 0-based ranks "
+     "(an int or a sequence), items unmodified"},
+    {"stats", KW dpq_stats, METH_VARARGS | METH_KEYWORDS,
+     "stats(items, threads=0): (count, min, max, sum) of float64 or int32 "
+     "items"},
+    {NULL, NULL, 0, NULL}};
+#undef KW
+
+static PyModuleDef dpq_module = {
+    PyModuleDef_HEAD_INIT, "dpq",
+    "Streaming quantile estimators, randomizers and exact selection",
+    -1, dpq_methods};
+
+PyMODINIT_FUNC PyInit_dpq(void) {
+  EstimatorType.tp_name = "dpq.Estimator";
+  EstimatorType.tp_basicsize = sizeof(EstimatorObject);
+  EstimatorType.tp_flags = Py_TPFLAGS_DEFAULT;
+  EstimatorType.tp_doc = "A streaming quantile estimator";
+  EstimatorType.tp_dealloc = (destructor)estimator_dealloc;
+  EstimatorType.tp_repr = (reprfunc)estimator_repr;
+  EstimatorType.tp_methods = estimator_methods;
+  EstimatorType.tp_getset = estimator_getset;
+  if (PyType_Ready(&EstimatorType) < 0)
+    return NULL;
+
+  PyObject *m = PyModule_Create(&dpq_module);
+  if (!m)
+    return NULL;
+  Py_INCREF(&EstimatorType);
+  if (PyModule_AddObject(m, "Estimator", (PyObject *)&EstimatorType) < 0) {
+    Py_DECREF(&EstimatorType);
+    Py_DECREF(m);
+    return NULL;
+  }
+  return m;
+}
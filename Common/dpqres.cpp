@@ -0,0 +1,270 @@
+/*
+ * Prints, indexes, compacts, fills or aggregates result stores (.dpqr, see
+ * ResultStore.h and ResultAggregate.h).
+ *
+ */
+
+#include "ResultAggregate.h"
+#include "ResultStore.h"
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <string>
+#include <vector>
+
+void usage(void) {
+  fprintf(stderr, "Usage: dpqres [options] [CSV files to import]\n");
+  fprintf(stderr, "-m <mode: cat|index|compact|import|aggregate> default: cat\n");
+  fprintf(stderr, "-i <store> store to print, index, compact or aggregate\n");
+  fprintf(stderr, "-o <output> CSV (cat, aggregate, default: stdout) or store (compact, import, aggregate)\n");
+  fprintf(stderr, "-a <name> import: prepend an alg column of this value\n");
+  fprintf(stderr, "-t <types> import: one of l (integer), d (real), s (text) per column default: guessed from the first row\n");
+  fprintf(stderr, "-k <columns> aggregate: the key columns of a cell default: %s\n", AGGREGATE_KEYS);
+  fprintf(stderr, "-y <column> aggregate: the measure of std, cil and cir default: %s\n", AGGREGATE_MEASURE);
+  fprintf(stderr, "-l <level> aggregate: of the confidence interval default: %.2f\n", AGGREGATE_LEVEL);
+}
+
+// the type of a CSV field: integer, real or text
+static char guess_type(const std::string &field) {
+  char *end;
+  strtoll(field.c_str(), &end, 10);
+  if (!field.empty() && *end == '\0')
+    return 'l';
+  strtod(field.c_str(), &end);
+  if (!field.empty() && *end == '\0')
+    return 'd';
+  return 's';
+}
+
+static std::vector<std::string> csv_fields(const char *line) {
+  std::vector<std::string> out;
+  std::string cur;
+  for (const char *p = line;; p++) {
+    if (*p == ',' || *p == '\n' || *p == '\r' || *p == '\0') {
+      size_t b = cur.find_first_not_of(' '), e = cur.find_last_not_of(' ');
+      out.push_back(b == std::string::npos ? "" : cur.substr(b, e - b + 1));
+      cur.clear();
+      if (*p != ',')
+        break;
+    } else {
+      cur += *p;
+    }
+  }
+  return out;
+}
+
+static int cat(const char *store, const char *output) {
+  ResultTable table;
+  if (result_read(store, &table)) {
+    fprintf(stderr, "Error reading store %s\n", store);
+    return 1;
+  }
+  FILE *fptr = output ? fopen(output, "w") : stdout;
+  if (!fptr) {
+    fprintf(stderr, "Error opening file %s\n", output);
+    return 1;
+  }
+  int status = result_csv(fptr, table);
+  if (fptr != stdout)
+    fclose(fptr);
+  return status ? 1 : 0;
+}
+
+// Writes one row per cell of the store to output, a CSV file (stdout if
+// NULL) or a store.
+static int aggregate(const char *store, const char *output, const char *keys,
+                     const char *measure, double level) {
+  ResultTable table;
+  if (result_read(store, &table)) {
+    fprintf(stderr, "Error reading store %s\n", store);
+    return 1;
+  }
+  ResultAggregate agg;
+  if (agg.open(table.columns, keys, measure, level)) {
+    fprintf(stderr, "No numeric column %s in %s\n", measure, store);
+    return 1;
+  }
+  for (long i = 0; i < table.rows; i++)
+    agg.add(table, i);
+  ResultTable cells;
+  agg.result(&cells);
+  fprintf(stderr, "%ld rows, %ld cells\n", table.rows, cells.rows);
+
+  if (output && result_store(output)) {
+    if (result_write(output, cells, 0, cells.rows)) {
+      fprintf(stderr, "Error writing store %s\n", output);
+      return 1;
+    }
+    return 0;
+  }
+  FILE *fptr = output ? fopen(output, "w") : stdout;
+  if (!fptr) {
+    fprintf(stderr, "Error opening file %s\n", output);
+    return 1;
+  }
+  int status = result_csv(fptr, cells);
+  if (fptr != stdout)
+    fclose(fptr);
+  return status ? 1 : 0;
+}
+
+// Appends the rows of CSV files with a header line to the store at output.
+// Files whose header differs from the first one's are skipped.
+static int import(const char *output, const char *alg, const char *types,
+                  char **files, int nfiles) {
+  ResultWriter writer;
+  std::string header, typed;
+  long rows = 0, skipped = 0;
+  char line[4096];
+  for (int f = 0; f < nfiles; f++) {
+    FILE *fp = fopen(files[f], "r");
+    if (!fp) {
+      fprintf(stderr, "Error opening file %s\n", files[f]);
+      return 1;
+    }
+    if (!fgets(line, sizeof(line), fp)) {
+      fclose(fp);
+      continue;
+    }
+    std::string h = std::string(alg ? "alg," : "") + line;
+    while (!h.empty() && (h.back() == '\n' || h.back() == '\r'))
+      h.pop_back();
+
+    while (fgets(line, sizeof(line), fp)) {
+      std::string row = std::string(alg ? alg : "") + (alg ? "," : "") + line;
+      if (header.empty()) {
+        // the schema of the store, from the first file
+        header = h;
+        if (types) {
+          typed = std::string(alg ? "s" : "") + types;
+        } else {
+          for (const std::string &field : csv_fields(row.c_str()))
+            typed += guess_type(field);
+        }
+        std::vector<ResultColumn> columns;
+        if (result_columns(header.c_str(), typed.c_str(), &columns)) {
+          fprintf(stderr, "Bad header or types in %s\n", files[f]);
+          fclose(fp);
+          return 1;
+        }
+        if (writer.open(output, columns)) {
+          fprintf(stderr, "Error opening store %s\n", output);
+          fclose(fp);
+          return 1;
+        }
+      }
+      if (h != header) {
+        skipped++;
+        break;
+      }
+      if (writer.append(row.c_str())) {
+        fprintf(stderr, "Bad row in %s: %s", files[f], line);
+        fclose(fp);
+        return 1;
+      }
+      rows++;
+    }
+    fclose(fp);
+  }
+  if (writer.close()) {
+    fprintf(stderr, "Error writing store %s\n", output);
+    return 1;
+  }
+  fprintf(stderr, "%ld rows imported, %ld files skipped\n", rows, skipped);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *mode = "cat";
+  const char *input = NULL;
+  const char *output = NULL;
+  const char *alg = NULL;
+  const char *types = NULL;
+  const char *keys = AGGREGATE_KEYS;
+  const char *measure = AGGREGATE_MEASURE;
+  double level = AGGREGATE_LEVEL;
+  int opt;
+
+  while ((opt = getopt(argc, argv, ":m:i:o:a:t:k:y:l:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      mode = optarg;
+      break;
+    case 'i':
+      input = optarg;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'a':
+      alg = optarg;
+      break;
+    case 't':
+      types = optarg;
+      break;
+    case 'k':
+      keys = optarg;
+      break;
+    case 'y':
+      measure = optarg;
+      break;
+    case 'l':
+      level = strtod(optarg, NULL);
+      break;
+    case 'h':
+      usage();
+      exit(1);
+      break;
+    case '?':
+      fprintf(stderr, "Unknown option: %c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    case ':':
+      fprintf(stderr, "Missing argument for option -%c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    }
+  }
+
+  if (!strcmp(mode, "import")) {
+    if (!output || optind == argc) {
+      usage();
+      exit(1);
+    }
+    return import(output, alg, types, argv + optind, argc - optind);
+  }
+  if (!input) {
+    usage();
+    exit(1);
+  }
+  if (!strcmp(mode, "cat"))
+    return cat(input, output);
+  if (!strcmp(mode, "aggregate"))
+    return aggregate(input, output, keys, measure, level);
+  if (!strcmp(mode, "index")) {
+    if (result_index(input)) {
+      fprintf(stderr, "Error indexing store %s\n", input);
+      return 1;
+    }
+    return 0;
+  }
+  if (!strcmp(mode, "compact")) {
+    // every row in full blocks, then an index
+    ResultTable table;
+    if (!output || result_read(input, &table) ||
+        result_write(output, table, 0, table.rows) || result_index(output)) {
+      fprintf(stderr, "Error compacting store %s\n", input);
+      return 1;
+    }
+    fprintf(stderr, "%ld rows\n", table.rows);
+    return 0;
+  }
+  fprintf(stderr, "Unknown mode: %s\n", mode);
+  usage();
+  return 1;
+}
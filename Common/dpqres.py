@@ -0,0 +1,156 @@
+"""Reader of result stores (.dpqr files, see ResultStore.h).
+
+    import sys; sys.path.append('../Common')
+    import dpqres
+    df = dpqres.read('results.dpqr')      # or dpqres.columns(...)
+
+read() returns a pandas DataFrame with one column per column name found in
+the store; values a block lacks are NaN (real and integer columns, which
+then become real) or empty strings. Text columns are categorical.
+"""
+
+import fcntl
+import mmap
+import struct
+import warnings
+
+import numpy as np
+import pandas as pd
+
+_HEADER = struct.Struct('=4sIQQ')
+_COLUMN = struct.Struct('=23sc')
+_TRAILER = struct.Struct('=Q8s')
+_MISSING = np.iinfo(np.int64).min
+
+
+def _offsets(buf):
+    """Offsets of the data blocks: from the index if the store ends with
+    one, else by walking the block headers. The walk stops, with a warning,
+    at a last block cut short by a writer that died in its write()."""
+    size = len(buf)
+    if size >= _HEADER.size + _TRAILER.size:
+        at, magic = _TRAILER.unpack_from(buf, size - _TRAILER.size)
+        if magic == b'DPQRIDX1' and at + _HEADER.size <= size:
+            kind, _, nbytes, blocks = _HEADER.unpack_from(buf, at)
+            if kind == b'DPQI' and at + nbytes == size:
+                entries = np.frombuffer(buf, dtype=np.uint64, count=2 * blocks,
+                                        offset=at + _HEADER.size)
+                return entries[0::2].tolist()
+    offsets, at = [], 0
+    while at < size:
+        if at + _HEADER.size > size:
+            break
+        kind, _, nbytes, _ = _HEADER.unpack_from(buf, at)
+        if kind not in (b'DPQB', b'DPQI') or nbytes < _HEADER.size:
+            raise ValueError('not a result store')
+        if nbytes > size - at:
+            break
+        if kind == b'DPQB':
+            offsets.append(at)
+        at += nbytes
+    if at < size:
+        warnings.warn('ignoring an incomplete last block of %d bytes'
+                      % (size - at))
+    return offsets
+
+
+def _block(buf, at):
+    if at + _HEADER.size > len(buf):
+        raise ValueError('corrupt block at %d' % at)
+    kind, ncols, nbytes, rows = _HEADER.unpack_from(buf, at)
+    end = at + nbytes
+    if (kind != b'DPQB' or nbytes < _HEADER.size or end > len(buf)
+            or ncols * _COLUMN.size + _HEADER.size > nbytes
+            or 8 * rows > nbytes):
+        raise ValueError('corrupt block at %d' % at)
+    p = at + _HEADER.size
+    columns = []
+    for _ in range(ncols):
+        name, kind = _COLUMN.unpack_from(buf, p)
+        columns.append((name.split(b'\0', 1)[0].decode(), kind))
+        p += _COLUMN.size
+    out = {}
+    for name, kind in columns:
+        if kind in (b'l', b'd'):
+            if p + 8 * rows > end:
+                raise ValueError('corrupt block at %d' % at)
+            dtype = np.int64 if kind == b'l' else np.float64
+            out[name] = np.frombuffer(buf, dtype=dtype, count=rows, offset=p)
+            p += 8 * rows
+        else:
+            if kind != b's' or p + 4 > end:
+                raise ValueError('corrupt block at %d' % at)
+            entries = struct.unpack_from('=I', buf, p)[0]
+            chars = p + 4 * (2 + rows + entries)
+            if chars > end:
+                raise ValueError('corrupt block at %d' % at)
+            codes = np.frombuffer(buf, dtype=np.uint32, count=rows, offset=p + 4)
+            offs = np.frombuffer(buf, dtype=np.uint32, count=entries + 1,
+                                 offset=p + 4 + 4 * rows)
+            if (offs[0] != 0 or chars + int(offs[-1]) > end
+                    or (np.diff(offs.astype(np.int64)) < 0).any()
+                    or (rows and int(codes.max()) >= entries)):
+                raise ValueError('corrupt block at %d' % at)
+            text = bytes(buf[chars:chars + int(offs[-1])])
+            values = [text[offs[e]:offs[e + 1]].decode()
+                      for e in range(entries)]
+            out[name] = (codes, values)
+            p += (4 * (2 + rows + entries) + int(offs[-1]) + 7) & ~7
+    return rows, out
+
+
+def read(path):
+    """Every row of the store at path, as a DataFrame."""
+    data = columns(path)
+    return pd.DataFrame(data, columns=list(data))
+
+
+def columns(path):
+    """Every row of the store at path, as a dict of one array per column
+    (without building a DataFrame, which copies them once more)."""
+    with open(path, 'rb') as f:
+        # blocks are appended under an exclusive flock(): none is half
+        # written while the shared lock is held, and the map keeps its size
+        fcntl.flock(f, fcntl.LOCK_SH)
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        fcntl.flock(f, fcntl.LOCK_UN)
+    parts, names = [], []
+    for at in _offsets(buf):
+        rows, cols = _block(buf, at)
+        for name in cols:
+            if name not in names:
+                names.append(name)
+        parts.append((rows, cols))
+
+    data = {}
+    for name in names:
+        if any(isinstance(cols.get(name), tuple) for _, cols in parts):
+            data[name] = _text(name, parts)
+            continue
+        pieces = []
+        for rows, cols in parts:
+            if name in cols:
+                pieces.append(cols[name])
+            else:
+                pieces.append(np.full(rows, np.nan))
+        column = np.concatenate(pieces) if pieces else np.array([])
+        if column.dtype == np.int64 and (column == _MISSING).any():
+            column = np.where(column == _MISSING, np.nan, column)
+        data[name] = column
+    return data
+
+
+def _text(name, parts):
+    """A text column as a Categorical over the values of every block."""
+    categories, index, pieces = [], {}, []
+    for rows, cols in parts:
+        codes, values = cols.get(name, (np.zeros(rows, np.uint32), ['']))
+        remap = np.empty(len(values), dtype=np.int32)
+        for e, v in enumerate(values):
+            if v not in index:
+                index[v] = len(categories)
+                categories.append(v)
+            remap[e] = index[v]
+        pieces.append(remap[codes])
+    codes = np.concatenate(pieces) if pieces else np.array([], np.int32)
+    return pd.Categorical.from_codes(codes, categories=categories)
@@ -0,0 +1,444 @@
+/*
+ * libdpquantiles: the estimators of Frugal.h and LdpKernels.h behind the C
+ * interface of dpquantiles.h.
+ *
+ * A handle is a dpq_estimator holding one estimator, whose batch update is
+ * the template the binaries run, reached through one virtual call per batch.
+ * Values for the central estimators are scaled to integers through a buffer
+ * on the stack, DPQ_CONVERT at a time, so that no update allocates.
+ *
+ */
+
+#include "dpquantiles.h"
+
+#include "Frugal.h"
+#include "ItemStorage.h"
+#include "LdpKernels.h"
+#include "ReleaseSampler.h"
+#include "StreamInput.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#define DPQ_CONVERT 1024
+#define DPQ_STATE_MAGIC 0x53515044u // "DPQS"
+#define FRUGAL1U_SENSITIVITY 2.0    // as frugal_1u_quantile
+
+struct dpq_estimator {
+  dpq_params params;
+
+  explicit dpq_estimator(const dpq_params &params) : params(params) {}
+  virtual ~dpq_estimator() {}
+  virtual void update(const double *items, long n) = 0;
+  virtual void update(const int32_t *items, long n) = 0;
+  virtual double estimate() const = 0;
+  virtual uint64_t count() const = 0;
+  virtual size_t state_size() const = 0;
+  virtual void save(unsigned char *out) const = 0;
+  virtual void load(const unsigned char *in) = 0;
+};
+
+namespace {
+
+struct StateHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t params_size;
+  uint32_t state_size;
+};
+
+struct Writer {
+  unsigned char *p;
+  template <typename T> void put(const T &x) {
+    static_assert(std::is_trivially_copyable<T>::value, "not a plain value");
+    memcpy(p, &x, sizeof(T));
+    p += sizeof(T);
+  }
+  void put(const std::vector<int> &v) {
+    memcpy(p, v.data(), v.size() * sizeof(int));
+    p += v.size() * sizeof(int);
+  }
+};
+
+struct Reader {
+  const unsigned char *p;
+  template <typename T> void get(T *x) {
+    memcpy((void *)x, p, sizeof(T));
+    p += sizeof(T);
+  }
+  void get(std::vector<int> *v) {
+    memcpy(v->data(), p, v->size() * sizeof(int));
+    p += v->size() * sizeof(int);
+  }
+};
+
+// The state of an estimator, generators included. Those of LdpKernels.h and
+// Frugal-1U are plain values; the per-chunk vectors of Frugal-2U are sized
+// by the parameters, which the snapshot carries.
+template <typename E> size_t state_size(const E &) { return sizeof(E); }
+template <typename E> void save_state(Writer &w, const E &e) { w.put(e); }
+template <typename E> void load_state(Reader &r, E *e) { r.get(e); }
+
+size_t state_size(const Frugal2U &e) {
+  return sizeof(e.count) + sizeof(e.lo) + sizeof(e.hi) + sizeof(e.gen) +
+         sizeof(e.dis) + 3 * e.chunks * sizeof(int);
+}
+void save_state(Writer &w, const Frugal2U &e) {
+  w.put(e.count);
+  w.put(e.lo);
+  w.put(e.hi);
+  w.put(e.gen);
+  w.put(e.dis);
+  w.put(e.estimate);
+  w.put(e.stepsize);
+  w.put(e.sign);
+}
+void load_state(Reader &r, Frugal2U *e) {
+  r.get(&e->count);
+  r.get(&e->lo);
+  r.get(&e->hi);
+  r.get(&e->gen);
+  r.get(&e->dis);
+  r.get(&e->estimate);
+  r.get(&e->stepsize);
+  r.get(&e->sign);
+}
+
+inline double central_estimate(const Frugal1U &e) { return e.estimate; }
+inline double central_estimate(const Frugal2U &e) { return e.mean(); }
+
+template <typename E> struct CentralHandle : dpq_estimator {
+  E est;
+
+  CentralHandle(const dpq_params &params, const E &est)
+      : dpq_estimator(params), est(est) {}
+  void update(const double *items, long n) override {
+    int32_t scaled[DPQ_CONVERT];
+    for (long i = 0; i < n; i += DPQ_CONVERT) {
+      const long m = std::min((long)DPQ_CONVERT, n - i);
+      for (long j = 0; j < m; j++)
+        scaled[j] = scaled_item(items[i + j], params.scale);
+      est.update(scaled, m);
+    }
+  }
+  void update(const int32_t *items, long n) override { est.update(items, n); }
+  double estimate() const override {
+    return central_estimate(est) / params.scale;
+  }
+  uint64_t count() const override { return est.count; }
+  size_t state_size() const override { return ::state_size(est); }
+  void save(unsigned char *out) const override {
+    Writer w = {out};
+    save_state(w, est);
+  }
+  void load(const unsigned char *in) override {
+    Reader r = {in};
+    load_state(r, &est);
+  }
+};
+
+// the LDP estimates, normalised to [0, 1]
+inline double norm_estimate(const EasyQuantile &e) { return e.norm_quantile; }
+inline double norm_estimate(const Frugal2USW &e) {
+  return (double)e.integer_norm_quantile / e.prec;
+}
+inline double norm_estimate(const Frugal1URR &e) {
+  return (double)e.integer_norm_quantile / e.prec;
+}
+inline double norm_estimate(const LDPQ &e) { return e.Qn; }
+
+inline uint64_t ldp_count(const LDPQ &e) { return e.n; }
+template <typename E> uint64_t ldp_count(const E &e) { return e.count; }
+
+template <typename E> struct LocalHandle : dpq_estimator {
+  E est;
+
+  LocalHandle(const dpq_params &params, const E &est)
+      : dpq_estimator(params), est(est) {}
+  void update(const double *items, long n) override {
+    ldp_update(est, items, n, params.lo, params.hi - params.lo, params.clip);
+  }
+  void update(const int32_t *items, long n) override {
+    ldp_update(est, items, n, params.lo, params.hi - params.lo, params.clip);
+  }
+  double estimate() const override {
+    return norm_estimate(est) * (params.hi - params.lo) + params.lo;
+  }
+  uint64_t count() const override { return ldp_count(est); }
+  size_t state_size() const override { return ::state_size(est); }
+  void save(unsigned char *out) const override {
+    Writer w = {out};
+    save_state(w, est);
+  }
+  void load(const unsigned char *in) override {
+    Reader r = {in};
+    load_state(r, &est);
+  }
+};
+
+bool is_central(int algorithm) {
+  return algorithm == DPQ_FRUGAL_1U || algorithm == DPQ_FRUGAL_2U;
+}
+
+bool valid_params(const dpq_params &p) {
+  if (p.algorithm < DPQ_FRUGAL_1U || p.algorithm > DPQ_LDPQ ||
+      !(p.quantile > 0.0 && p.quantile < 1.0))
+    return false;
+  if (is_central(p.algorithm)) {
+    if (!(p.scale > 0.0) || p.chunks < 1)
+      return false;
+    // the clipping domain must hold integer items
+    return !p.clip || (p.lo <= p.hi && p.lo * p.scale >= (double)INT_MIN &&
+                       p.hi * p.scale <= (double)INT_MAX);
+  }
+  return p.eps > 0.0 && p.lo < p.hi && p.prec > 0.0;
+}
+
+// a new handle for valid params; throws std::bad_alloc
+dpq_estimator *make_estimator(const dpq_params &p) {
+  double q, l;
+  square_wave_params(p.eps, &q, &l);
+  switch (p.algorithm) {
+  case DPQ_FRUGAL_1U:
+    return new CentralHandle<Frugal1U>(p, Frugal1U(p.quantile, p.seed1));
+  case DPQ_FRUGAL_2U: {
+    Frugal2U est(p.quantile, p.chunks, p.seed1);
+    if (p.clip)
+      est.clip(scaled_item(p.lo, p.scale), scaled_item(p.hi, p.scale));
+    return new CentralHandle<Frugal2U>(p, est);
+  }
+  case DPQ_EASY_QUANTILE: {
+    return new LocalHandle<EasyQuantile>(
+        p, EasyQuantile(p.quantile, q, l, ezq_mode(p.quantile), p.seed1));
+  }
+  case DPQ_FRUGAL_2U_SW:
+    return new LocalHandle<Frugal2USW>(
+        p, Frugal2USW(p.quantile, q, l, p.prec, p.seed1, p.seed2));
+  case DPQ_FRUGAL_1U_RR:
+    return new LocalHandle<Frugal1URR>(
+        p, Frugal1URR(p.quantile, p.eps, p.prec, p.seed1, p.seed2));
+  default:
+    return new LocalHandle<LDPQ>(p, LDPQ(p.quantile, p.eps, p.seed1,
+                                         p.seed2));
+  }
+}
+
+// the mechanism an LDP algorithm perturbs its items with
+int own_mechanism(int algorithm) {
+  switch (algorithm) {
+  case DPQ_EASY_QUANTILE:
+  case DPQ_FRUGAL_2U_SW:
+    return DPQ_SQUARE_WAVE;
+  case DPQ_FRUGAL_1U_RR:
+  case DPQ_LDPQ:
+    return DPQ_RANDOMIZED_RESPONSE;
+  }
+  return 0;
+}
+
+} // namespace
+
+extern "C" {
+
+void dpq_params_init(dpq_params *params, int algorithm) {
+  if (!params)
+    return;
+  memset(params, 0, sizeof(dpq_params));
+  params->size = sizeof(dpq_params);
+  params->algorithm = algorithm;
+  params->quantile = 0.99;
+  params->eps = 2.0;
+  params->lo = 0.0;
+  params->hi = 1.0;
+  params->clip = 0;
+  params->chunks = 4;
+  params->scale = 1000.0;
+  params->prec = 1000000.0;
+  params->seed1 = 1234;
+  params->seed2 = 5678;
+}
+
+int dpq_create(const dpq_params *params, dpq_estimator **estimator) {
+  if (!params || !estimator ||
+      params->size < offsetof(dpq_params, algorithm) + sizeof(int32_t))
+    return DPQ_ERR_ARGUMENT;
+  // an older caller's shorter params get the defaults for the later fields
+  dpq_params p;
+  dpq_params_init(&p, params->algorithm);
+  memcpy(&p, params, std::min((size_t)params->size, sizeof(dpq_params)));
+  p.size = sizeof(dpq_params);
+  if (!valid_params(p))
+    return DPQ_ERR_ARGUMENT;
+  try {
+    *estimator = make_estimator(p);
+  } catch (...) {
+    return DPQ_ERR_MEMORY;
+  }
+  return DPQ_OK;
+}
+
+void dpq_destroy(dpq_estimator *estimator) { delete estimator; }
+
+int dpq_update(dpq_estimator *estimator, double item) {
+  if (!estimator)
+    return DPQ_ERR_ARGUMENT;
+  estimator->update(&item, 1);
+  return DPQ_OK;
+}
+
+int dpq_update_batch(dpq_estimator *estimator, const double *items,
+                     size_t n) {
+  if (!estimator || (!items && n))
+    return DPQ_ERR_ARGUMENT;
+  estimator->update(items, (long)n);
+  return DPQ_OK;
+}
+
+int dpq_update_batch_i32(dpq_estimator *estimator, const int32_t *items,
+                         size_t n) {
+  if (!estimator || (!items && n))
+    return DPQ_ERR_ARGUMENT;
+  estimator->update(items, (long)n);
+  return DPQ_OK;
+}
+
+int dpq_estimate(const dpq_estimator *estimator, double *estimate) {
+  if (!estimator || !estimate)
+    return DPQ_ERR_ARGUMENT;
+  if (!estimator->count())
+    return DPQ_ERR_EMPTY;
+  *estimate = estimator->estimate();
+  return DPQ_OK;
+}
+
+uint64_t dpq_count(const dpq_estimator *estimator) {
+  return estimator ? estimator->count() : 0;
+}
+
+int dpq_release(const dpq_estimator *estimator, int mechanism, double budget,
+                double delta, uint64_t *rng, double *release) {
+  if (!estimator || !release)
+    return DPQ_ERR_ARGUMENT;
+  if (!estimator->count())
+    return DPQ_ERR_EMPTY;
+  const dpq_params &p = estimator->params;
+
+  // the LDP estimate is private already
+  const int own = own_mechanism(p.algorithm);
+  if (own) {
+    if (mechanism != own)
+      return DPQ_ERR_MECHANISM;
+    *release = estimator->estimate();
+    return DPQ_OK;
+  }
+
+  if (mechanism != DPQ_LAPLACE && mechanism != DPQ_GAUSSIAN &&
+      mechanism != DPQ_ZCDP)
+    return DPQ_ERR_MECHANISM;
+  if (!rng || !(budget > 0.0) ||
+      (mechanism == DPQ_GAUSSIAN && !(delta > 0.0 && delta < 1.0)))
+    return DPQ_ERR_ARGUMENT;
+  double sensitivity = FRUGAL1U_SENSITIVITY;
+  if (p.algorithm == DPQ_FRUGAL_2U) {
+    if (!p.clip)
+      return DPQ_ERR_DOMAIN;
+    sensitivity = (p.hi - p.lo) / p.chunks;
+  }
+
+  double scale;
+  if (mechanism == DPQ_LAPLACE)
+    scale = sensitivity / budget;
+  else if (mechanism == DPQ_GAUSSIAN)
+    scale = sqrt(2 * sensitivity * sensitivity * log(1.25 / delta)) / budget;
+  else
+    scale = sqrt(sensitivity * sensitivity / (2.0 * budget));
+  SplitMix64 gen(*rng);
+  double noise;
+  release_noise((mechanism == DPQ_LAPLACE) ? RELEASE_LAPLACE
+                                           : RELEASE_GAUSSIAN,
+                scale, gen, &noise, 1);
+  *rng = gen.state;
+  *release = estimator->estimate() + noise;
+  return DPQ_OK;
+}
+
+size_t dpq_serialized_size(const dpq_estimator *estimator) {
+  if (!estimator)
+    return 0;
+  return sizeof(StateHeader) + sizeof(dpq_params) + estimator->state_size();
+}
+
+int dpq_serialize(const dpq_estimator *estimator, void *buffer, size_t size,
+                  size_t *written) {
+  if (!estimator || !written)
+    return DPQ_ERR_ARGUMENT;
+  *written = dpq_serialized_size(estimator);
+  if (!buffer || size < *written)
+    return DPQ_ERR_BUFFER;
+  StateHeader h = {DPQ_STATE_MAGIC, DPQ_ABI_VERSION, sizeof(dpq_params),
+                   (uint32_t)estimator->state_size()};
+  unsigned char *out = (unsigned char *)buffer;
+  memcpy(out, &h, sizeof(h));
+  memcpy(out + sizeof(h), &estimator->params, sizeof(dpq_params));
+  estimator->save(out + sizeof(h) + sizeof(dpq_params));
+  return DPQ_OK;
+}
+
+int dpq_deserialize(const void *buffer, size_t size,
+                    dpq_estimator **estimator) {
+  if (!buffer || !estimator)
+    return DPQ_ERR_ARGUMENT;
+  const unsigned char *in = (const unsigned char *)buffer;
+  StateHeader h;
+  dpq_params p;
+  if (size < sizeof(h) + sizeof(p))
+    return DPQ_ERR_FORMAT;
+  memcpy(&h, in, sizeof(h));
+  memcpy(&p, in + sizeof(h), sizeof(p));
+  if (h.magic != DPQ_STATE_MAGIC || h.version != DPQ_ABI_VERSION ||
+      h.params_size != sizeof(dpq_params) || p.size != sizeof(dpq_params) ||
+      !valid_params(p))
+    return DPQ_ERR_FORMAT;
+  dpq_estimator *e;
+  try {
+    e = make_estimator(p);
+  } catch (...) {
+    return DPQ_ERR_MEMORY;
+  }
+  if (h.state_size != e->state_size() ||
+      size < sizeof(h) + sizeof(p) + h.state_size) {
+    delete e;
+    return DPQ_ERR_FORMAT;
+  }
+  e->load(in + sizeof(h) + sizeof(p));
+  *estimator = e;
+  return DPQ_OK;
+}
+
+const char *dpq_strerror(int error) {
+  switch (error) {
+  case DPQ_OK:
+    return "success";
+  case DPQ_ERR_ARGUMENT:
+    return "invalid argument";
+  case DPQ_ERR_MEMORY:
+    return "out of memory";
+  case DPQ_ERR_MECHANISM:
+    return "mechanism does not apply to the algorithm";
+  case DPQ_ERR_DOMAIN:
+    return "the release needs a clipping domain";
+  case DPQ_ERR_BUFFER:
+    return "buffer too small";
+  case DPQ_ERR_FORMAT:
+    return "not a serialised estimator of this library";
+  case DPQ_ERR_EMPTY:
+    return "no item yet";
+  }
+  return "unknown error";
+}
+
+} // extern "C"
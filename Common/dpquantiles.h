@@ -0,0 +1,135 @@
+/*
+ * C interface of libdpquantiles (dpquantiles.cpp): the streaming quantile
+ * estimators behind an opaque handle, for services in C or any language
+ * with a C FFI. Built by "make lib" in Common/ as libdpquantiles.so and
+ * libdpquantiles.a (link the latter with -lstdc++ -lm -lpthread).
+ *
+ *   dpq_params params;
+ *   dpq_params_init(&params, DPQ_LDPQ);
+ *   params.quantile = 0.99; params.eps = 2.0; params.lo = 0; params.hi = 1e4;
+ *   dpq_estimator *e;
+ *   if (dpq_create(&params, &e) == DPQ_OK) {
+ *     dpq_update_batch(e, items, n);
+ *     dpq_estimate(e, &value);
+ *     dpq_destroy(e);
+ *   }
+ *
+ * Every function returns DPQ_OK or a negative DPQ_ERR_ code and never
+ * throws. Only dpq_create() and dpq_deserialize() allocate: updates,
+ * estimates, releases and serialisation work in the handle and in the
+ * caller's memory. A handle may be used by one thread at a time.
+ *
+ * Items are values. The central estimators (Frugal-1U, Frugal-2U) keep
+ * integers: values are multiplied by params.scale (1000, as the binaries
+ * scale them) and rounded, and dpq_update_batch_i32() takes them already
+ * scaled. The LDP estimators normalise values to [lo, hi], the public
+ * domain, and with clip set clamp the values outside it.
+ *
+ */
+
+#ifndef __DPQUANTILES_H__
+#define __DPQUANTILES_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define DPQ_API __attribute__((visibility("default")))
+#else
+#define DPQ_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DPQ_ABI_VERSION 1
+
+enum dpq_algorithm {
+  DPQ_FRUGAL_1U = 1,
+  DPQ_FRUGAL_2U,
+  DPQ_EASY_QUANTILE, // with Square Wave
+  DPQ_FRUGAL_2U_SW,
+  DPQ_FRUGAL_1U_RR,
+  DPQ_LDPQ
+};
+
+enum dpq_mechanism {
+  DPQ_LAPLACE = 1, // central: eps
+  DPQ_GAUSSIAN,    // central: eps, delta
+  DPQ_ZCDP,        // central: rho
+  DPQ_SQUARE_WAVE, // LDP: EasyQuantile and Frugal-2U, perturbed per item
+  DPQ_RANDOMIZED_RESPONSE // LDP: Frugal-1U and LDPQ, perturbed per item
+};
+
+enum dpq_error {
+  DPQ_OK = 0,
+  DPQ_ERR_ARGUMENT = -1,  // a NULL pointer or a parameter out of range
+  DPQ_ERR_MEMORY = -2,    // allocation failed in create or deserialize
+  DPQ_ERR_MECHANISM = -3, // the mechanism does not apply to the algorithm
+  DPQ_ERR_DOMAIN = -4,    // Frugal-2U releases need a clipping domain
+  DPQ_ERR_BUFFER = -5,    // the serialisation buffer is too small
+  DPQ_ERR_FORMAT = -6,    // not a state serialised by this build
+  DPQ_ERR_EMPTY = -7      // no item yet
+};
+
+typedef struct dpq_params {
+  uint32_t size; // sizeof(dpq_params), set by dpq_params_init()
+  int32_t algorithm;
+  double quantile;
+  double eps;   // LDP privacy budget
+  double lo;    // LDP: the domain; Frugal-2U: the clipping domain, if clip
+  double hi;
+  int32_t clip; // clamp items to [lo, hi]
+  int32_t chunks; // Frugal-2U
+  double scale;   // central: integer items per value unit
+  double prec;    // Frugal-2U-SW, Frugal-1U-RR: integer steps of [0, 1]
+  int64_t seed1;
+  int64_t seed2; // second generator of the LDP estimators
+} dpq_params;
+
+typedef struct dpq_estimator dpq_estimator;
+
+// the defaults of the binaries for algorithm; the domain is left [0, 1]
+DPQ_API void dpq_params_init(dpq_params *params, int algorithm);
+DPQ_API int dpq_create(const dpq_params *params, dpq_estimator **estimator);
+DPQ_API void dpq_destroy(dpq_estimator *estimator);
+
+DPQ_API int dpq_update(dpq_estimator *estimator, double item);
+DPQ_API int dpq_update_batch(dpq_estimator *estimator, const double *items,
+                             size_t n);
+DPQ_API int dpq_update_batch_i32(dpq_estimator *estimator,
+                                 const int32_t *items, size_t n);
+
+// the non-private estimate of the central estimators, the private one of
+// the LDP estimators, in value units
+DPQ_API int dpq_estimate(const dpq_estimator *estimator, double *estimate);
+DPQ_API uint64_t dpq_count(const dpq_estimator *estimator);
+
+// Private release of the estimate. The central estimators add noise of the
+// mechanism, with the sensitivity the binaries use (2 for Frugal-1U, the
+// clipping domain over the chunks for Frugal-2U), drawn from *rng, the
+// caller's generator state, which is advanced. budget is eps for Laplace
+// and Gaussian, rho for zCDP. The LDP estimators perturbed every item with
+// their own mechanism and release the estimate; budget and rng are unused.
+DPQ_API int dpq_release(const dpq_estimator *estimator, int mechanism,
+                        double budget, double delta, uint64_t *rng,
+                        double *release);
+
+// Snapshot of the estimator, its generators included: restored by
+// dpq_deserialize() of the same build, it continues as the original would.
+// dpq_serialize() stores the size in *written, and fails with
+// DPQ_ERR_BUFFER if it exceeds size.
+DPQ_API size_t dpq_serialized_size(const dpq_estimator *estimator);
+DPQ_API int dpq_serialize(const dpq_estimator *estimator, void *buffer,
+                          size_t size, size_t *written);
+DPQ_API int dpq_deserialize(const void *buffer, size_t size,
+                            dpq_estimator **estimator);
+
+DPQ_API const char *dpq_strerror(int error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__DPQUANTILES_H__
@@ -0,0 +1,128 @@
+/*
+ * Converts value streams to and from the block-compressed item format.
+ *
+ */
+
+#include "ItemCodec.h"
+#include "StreamInput.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+
+void usage(void) {
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "-i <input> - (stdin), a file or FIFO path, or unix:<socket path> default: -\n");
+  fprintf(stderr, "-m <input format: text|binary> format of the values to encode default: text\n");
+  fprintf(stderr, "-o <output> - (stdout) or a file path default: -\n");
+  fprintf(stderr, "-x <scale> fixed-point scale applied to the values default: 1000\n");
+  fprintf(stderr, "-d decode a packed input to text values instead\n");
+}
+
+int main(int argc, char **argv) {
+
+  const char *source = "-";
+  const char *output = "-";
+  int format = STREAM_TEXT;
+  long scale = 1000;
+  bool decode = false;
+
+  int opt;
+
+  while ((opt = getopt(argc, argv, ":i:m:o:x:dh")) != -1) {
+    switch (opt) {
+    case 'i':
+      source = optarg;
+      break;
+    case 'm':
+      format = stream_format(optarg);
+      if (format < 0 || format == STREAM_PACKED) {
+        fprintf(stderr, "Unknown input format: %s\n", optarg);
+        usage();
+        exit(1);
+      }
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'x':
+      scale = strtol(optarg, NULL, 10);
+      break;
+    case 'd':
+      decode = true;
+      break;
+    case 'h':
+      usage();
+      exit(1);
+      break;
+    case '?':
+      fprintf(stderr, "Unknown option: %c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    case ':':
+      fprintf(stderr, "Missing argument for option -%c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    }
+  }
+
+  StreamInput in;
+
+  if (decode) {
+    if (stream_open(&in, source, STREAM_PACKED))
+      exit(1);
+
+    FILE *fptr = strcmp(output, "-") ? fopen(output, "w") : stdout;
+    if (!fptr) {
+      fprintf(stderr, "Error opening file %s\n", output);
+      exit(1);
+    }
+
+    static int items[STREAM_BATCH];
+    int digits = (int)ceil(log10((double)in.scale));
+    long n;
+    while ((n = stream_read_items(&in, items, STREAM_BATCH, -1)) > 0 || !in.eof)
+      for (long i = 0; i < n; i++)
+        fprintf(fptr, "%.*f\n", digits, items[i] / (double)in.scale);
+
+    if (fptr != stdout)
+      fclose(fptr);
+    fprintf(stderr, "decoded %ld items\n", in.count);
+    stream_close(&in);
+    return 0;
+  }
+
+  if (stream_open(&in, source, format))
+    exit(1);
+
+  ItemWriter w;
+  if (item_writer_open(&w, output, scale))
+    exit(1);
+
+  static double values[STREAM_BATCH];
+  static int items[STREAM_BATCH];
+  long n;
+  while ((n = stream_read(&in, values, STREAM_BATCH, -1)) > 0 || !in.eof) {
+    for (long i = 0; i < n; i++)
+      items[i] = lround(values[i] * scale);
+    if (item_writer_put(&w, items, n)) {
+      fprintf(stderr, "Error writing %s\n", output);
+      exit(1);
+    }
+  }
+  stream_close(&in);
+
+  if (item_writer_close(&w)) {
+    fprintf(stderr, "Error writing %s\n", output);
+    exit(1);
+  }
+  fprintf(stderr, "encoded %lu items in %lu bytes (%.2f bits/item, %.2fx vs int32)\n",
+          (unsigned long)w.count, (unsigned long)w.bytes,
+          8.0 * w.bytes / (w.count ? w.count : 1),
+          4.0 * w.count / (double)w.bytes);
+
+  return 0;
+}
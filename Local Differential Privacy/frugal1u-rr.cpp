@@ -3,7 +3,17 @@
 // University of Salento, Lecce, Italy
 // June 2024
 
-#include "QuickSelect.h"
+#include "Bootstrap.h"
+#include "CsvImport.h"
+#include "DatasetCache.h"
+#include "ItemBuffer.h"
+#include "ItemStorage.h"
+#include "LdpKernels.h"
+#include "ParallelSelect.h"
+#include "ResultStore.h"
+#include "StreamStats.h"
+#include "TruthCache.h"
+#include "Workload.h"
 #include <cstring>
 #include <getopt.h>
 #include <math.h>
@@ -22,18 +32,6 @@ void log(char active, const char *fmt, ...)
     }
 }
 
-int randomized_response(int q, double p, int x, std::mt19937 &gen1)
-{
-    std::bernoulli_distribution bernoulli_p(p);
-    int u = bernoulli_p(gen1);
-
-    if (u) {
-        return (x > q)? 1 : 0;
-    } else {
-        return (x > q)? 0 : 1;
-    }
-}
-
 void usage(void)
 {
     fprintf(stderr, "Usage:\n");
@@ -52,7 +50,20 @@ void usage(void)
                     "default: depends on selected distribution\n");
     fprintf(stderr, "-s <seed> the seed to be used for pseudo-random number "
                     "generator default: 1234\n");
-    fprintf(stderr, "-f <filename>\n");
+    fprintf(stderr, "-f <filename> CSV file, or a .dpqr result store to append the row to\n");
+    fprintf(stderr, "-i <input stream> read the items from a stream instead of generating them: "
+                    "- (stdin), a file or FIFO path, or unix:<socket path>\n");
+    fprintf(stderr, "-m <input format: text|binary|packed|csv> newline delimited values, raw float64, "
+                    "block-compressed items (a stream needs -r) or a column of a CSV file default: text\n");
+    fprintf(stderr, "-c <column> CSV column (0-based index or header name) default: 0\n");
+    fprintf(stderr, "-C <directory> cache generated items in directory default: $DPQ_CACHE\n");
+    fprintf(stderr, "-Q <q1,q2,...> also compute the true values of these quantiles and keep them in the cache\n");
+    fprintf(stderr, "-T <item storage: f64|f32|q16> type the estimator reads the items as default: f64\n");
+    fprintf(stderr, "-N <items> print the current estimate every N input items\n");
+    fprintf(stderr, "-t <milliseconds> print the current estimate every t milliseconds\n");
+    fprintf(stderr, "-r <lo,hi> public domain of the items: clamp them to it instead of scanning the stream for its range\n");
+    fprintf(stderr, "-B <replicas> Poisson bootstrap: also run this many replicas of the estimator in the same pass, "
+                    "and report the spread and a 95%% interval of the estimate default: 0\n");
 }
 
 int main(int argc, char **argv)
@@ -62,7 +73,7 @@ int main(int argc, char **argv)
     double *items   = NULL;
     long len        = 10000000;
     long dist       = 1;
-    char *diststr   = NULL;
+    const char *diststr   = NULL;
     double param1, param2;
     char *filename = NULL;
     FILE *fptr     = NULL;
@@ -74,9 +85,26 @@ int main(int argc, char **argv)
     double eps          = 2.0;      // privacy budget
     double prec         = 1000000.0;
 
+    char *source = NULL;
+    bool csv_input = false;
+    int format = STREAM_TEXT;
+    long every_items = 0;
+    long every_ms = 0;
+    CsvOptions csv;
+    const char *cache_dir = NULL;
+    const char *extra_quantiles = NULL;
+    bool cached = false;
+    int storage = STORE_F64;
+    double storage_error = 0.0;
+    bool clip = false; // normalise to a public domain, not the stream range
+    double clip_lo = 0.0, clip_hi = 0.0;
+    int replicas = 0; // bootstrap replicas of the estimator
+
     int opt;
 
-    while ((opt = getopt(argc, argv, ":n:q:e:d:a:b:s:f:p:h")) != -1) {
+    csv_options_init(&csv);
+
+    while ((opt = getopt(argc, argv, ":n:q:e:d:a:b:s:f:i:m:N:t:c:C:Q:T:r:p:B:h")) != -1) {
         switch (opt) {
             case 'n':
                 len = strtol(optarg, NULL, 10);
@@ -104,6 +132,52 @@ int main(int argc, char **argv)
             case 's':
                 seed = strtol(optarg, NULL, 10);
                 break;
+            case 'i':
+                source = optarg;
+                break;
+            case 'm':
+                csv_input = !strcmp(optarg, "csv");
+                format = csv_input ? STREAM_TEXT : stream_format(optarg);
+                if (format < 0) {
+                    log(! file_output, "Unknown input format: %s\n", optarg);
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'c':
+                csv.column = optarg;
+                break;
+            case 'C':
+                cache_dir = optarg;
+                break;
+            case 'Q':
+                extra_quantiles = optarg;
+                break;
+            case 'T':
+                storage = storage_type(optarg);
+                if (storage != STORE_F64 && storage != STORE_F32 && storage != STORE_Q16) {
+                    log(! file_output, "Unknown item storage: %s\n", optarg);
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'N':
+                every_items = strtol(optarg, NULL, 10);
+                break;
+            case 't':
+                every_ms = strtol(optarg, NULL, 10);
+                break;
+            case 'B':
+                replicas = strtol(optarg, NULL, 10);
+                break;
+            case 'r':
+                if (ldp_domain(optarg, &clip_lo, &clip_hi)) {
+                    log(! file_output, "Bad domain: %s\n", optarg);
+                    usage();
+                    exit(1);
+                }
+                clip = true;
+                break;
             case 'f':
                 filename = (char *) calloc(strlen(optarg) + 1, sizeof(char));
                 if (! filename) {
@@ -130,10 +204,17 @@ int main(int argc, char **argv)
         }
     }
 
-    /* allocate items */
-    items = (double *) calloc(len, sizeof(double));
-    if (! items) {
-        log(! file_output, "Not enough memory\n");
+    // a stream is read once, so its items are clamped to a public domain
+    // rather than scanned for their range, and it has no true quantile
+    bool streaming = source && ! csv_input;
+    if (streaming && ! clip) {
+        log(! file_output, "a stream needs its public domain (-r)\n");
+        usage();
+        exit(1);
+    }
+    if (streaming && storage != STORE_F64) {
+        log(! file_output, "-T applies to generated or CSV items, not to a stream\n");
+        usage();
         exit(1);
     }
 
@@ -141,238 +222,90 @@ int main(int argc, char **argv)
     // std::chrono::steady_clock::now().time_since_epoch().count();
 
     // set default parameter values depending on the distribution
-    switch (dist) {
-
-        case 1:
-            if (param1_default)
-                param1 = 0.0;
-            if (param2_default)
-                param2 = 1.0;
-            break;
-        case 2:
-            if (param1_default)
-                param1 = 0.0;
-            if (param2_default)
-                param2 = 1.0;
-            break;
-        case 3:
-            if (param1_default)
-                param1 = -1.0;
-            if (param2_default)
-                param2 = 1.0;
-            break;
-        case 4:
-            if (param1_default)
-                param1 = 0.5;
-            if (param2_default)
-                param2 = -1.0;      // not used
-            break;
-        case 5:
-            if (param1_default)
-                param1 = 5.0;
-            if (param2_default)
-                param2 = -1.0;      // not used
-            break;
-        case 6:
-            if (param1_default)
-                param1 = 3.0;
-            if (param2_default)
-                param2 = 2.0;
-            break;
-        case 7:
-            if (param1_default)
-                param1 = 0.0;
-            if (param2_default)
-                param2 = 0.5;
-            break;
-        case 8:
-            if (param1_default)
-                param1 = 1.5;
-            if (param2_default)
-                param2 = 3.0;
-            break;
-        default:
-            param1 = 0.0;
-            param2 = 1.0;
-            break;
-    }
+    ldp_dist_defaults(dist, &param1, &param2, param1_default, param2_default);
 
-    std::srand(seed);
-    long seed1 = std::rand();
-    long seed2 = std::rand();
-    long seed3 = std::rand();
-    long seed4 = std::rand();
-
-    log(! file_output, "Seeds generated: %ld, %ld, %ld\n", seed1, seed2, seed3);
-
-    std::mt19937 mtgenerator(seed1);
-    std::mt19937 mtgenerator1(seed2);
-    std::mt19937 mtgenerator2(seed3);
-    std::mt19937 mtgenerator3(seed4);
-
-    std::normal_distribution<double> normaldistribution(param1, param2);
-    std::cauchy_distribution<double> cauchydistribution(param1, param2);
-    std::uniform_real_distribution<double> uniformrealdistribution(param1, param2);
-    std::exponential_distribution<double> exponentialdistribution(param1);
-    std::chi_squared_distribution<double> chisquareddistribution(param1);
-    std::gamma_distribution<double> gammadistribution(param1, param2);
-    std::lognormal_distribution<double> lognormaldistribution(param1, param2);
-    std::extreme_value_distribution<double> extremevaluedistribution(param1, param2);
-
-    switch (dist) {
-        case 1:
-            for (long i = 0; i < len; i++) {
-                items[i] = normaldistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "normal", sizeof("normal"));
-            break;
-        case 2:
-            for (long i = 0; i < len; i++) {
-                items[i] = cauchydistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "cauchy", sizeof("cauchy"));
-            break;
-        case 3:
-            for (long i = 0; i < len; i++) {
-                items[i] = uniformrealdistribution(mtgenerator);
-                ;
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "uniform", sizeof("uniform"));
-            break;
-        case 4:
-            for (long i = 0; i < len; i++) {
-                items[i] = exponentialdistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "exponential", sizeof("exponential"));
-            break;
-        case 5:
-            for (long i = 0; i < len; i++) {
-                items[i] = chisquareddistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "chisquared", sizeof("chisquared"));
-            break;
-        case 6:
-            for (long i = 0; i < len; i++) {
-                items[i] = gammadistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "gamma", sizeof("gamma"));
-            break;
-        case 7:
-            for (long i = 0; i < len; i++) {
-                items[i] = lognormaldistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "lognormal", sizeof("lognormal"));
-            break;
-        case 8:
-            for (long i = 0; i < len; i++) {
-                items[i] = extremevaluedistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
-                exit(1);
-            }
-            memcpy(diststr, "extremevalue", sizeof("extremevalue"));
-            break;
-        default:
-            for (long i = 0; i < len; i++) {
-                items[i] = normaldistribution(mtgenerator);
-            }
-            diststr = (char *) calloc(16, sizeof(char));
-            if (! diststr) {
-                log(! file_output, "not enough memory\n");
+    const LdpSeeds seeds = ldp_seeds(seed);
+
+    log(! file_output, "Seeds generated: %ld, %ld, %ld\n", seeds.seed1, seeds.seed2, seeds.seed3);
+
+    std::mt19937 mtgenerator(seeds.seed1);
+
+    DatasetCache cache;
+    std::string key;
+
+    if (streaming) {
+        diststr = "stream";
+    } else if (source) {
+        len = csv_import(source, &csv, &items);
+        if (len <= 0) {
+            if (len == 0)
+                log(! file_output, "No values in %s\n", source);
+            exit(1);
+        }
+        diststr = "csv";
+        log(! file_output, "read %ld items from %s\n", len, source);
+    } else {
+        if (dataset_cache_open(&cache, cache_dir))
+            exit(1);
+        // the four LDP binaries generate the same items
+        key = dataset_cache_key("ldp-f64", dist, param1, param2, seed, len);
+        std::string state;
+
+        items = (double *) dataset_cache_load(&cache, key, sizeof(double), len, &state);
+        cached = (items != NULL);
+        if (! cached) {
+            /* allocate items */
+            items = (double *) item_alloc(len * sizeof(double));
+            if (! items) {
+                log(! file_output, "Not enough memory\n");
                 exit(1);
             }
-            memcpy(diststr, "normal", sizeof("normal"));
-            break;
+        }
+        if (! cached)
+            ldp_generate(items, len, dist, param1, param2, mtgenerator);
+        diststr = dist_name(dist);
+
+        if (cached) {
+            log(! file_output, "loaded %ld cached items\n", len);
+        } else {
+            log(! file_output, "generated random %ld items\n", len);
+            dataset_cache_store(&cache, key, items, sizeof(double), len, "");
+        }
+        if (dist_known(dist))
+            log(! file_output, "%s\n",
+                    dist_description(dist, param1, param2, seeds.seed1).c_str());
+
+        // stream min and max
     }
 
-    log(! file_output, "generated random %ld items\n", len);
-    if (dist == 1)
-        log(! file_output,
-                    "using the normal distribution with parameters mu=%.6f and sigma=%.6f "
-                    "and seed %ld\n",
-                    param1, param2, seed1);
-    if (dist == 2)
-        log(! file_output,
-                    "using the cauchy distribution with parameters a=%.6f and b=%.6f and "
-                    "seed %ld\n",
-                    param1, param2, seed1);
-    if (dist == 3)
-        log(! file_output,
-                    "using the uniform distribution with parameters a=%.6f and b=%.6f and "
-                    "seed %ld\n",
-                    param1, param2, seed1);
-    if (dist == 4)
-        log(! file_output,
-                    "using the exponential distribution with parameter a=%.6f and seed "
-                    "%ld\n",
-                    param1, seed1);
-    if (dist == 5)
-        log(! file_output,
-                    "using the chi squared distribution with parameter a=%.6f and seed "
-                    "%ld\n",
-                    param1, seed1);
-    if (dist == 6)
-        log(! file_output,
-                    "using the gamma distribution with parameters a=%.6f and b=%.6f and "
-                    "seed %ld\n",
-                    param1, param2, seed1);
-    if (dist == 7)
-        log(! file_output,
-                    "using the lognormal distribution with parameters a=%.6f and b=%.6f "
-                    "and seed %ld\n",
-                    param1, param2, seed1);
-    if (dist == 8)
-        log(! file_output,
-                    "using the extreme value distribution with parameters a=%.6f and "
-                    "b=%.6f and seed %ld\n",
-                    param1, param2, seed1);
-
-    // stream min and max
-    double smax = std::numeric_limits<double>::min();
-    double smin = std::numeric_limits<double>::max();
-    for (int i = 0; i < len; i++) {
-        if (items[i] < smin)
-            smin = items[i];
-        if (items[i] > smax)
-            smax = items[i];
+    ItemPages pages;
+    if (items && ! cached && ! item_pages(items, &pages))
+        log(! file_output, "item buffer %ld MB: %ld KB pages, %ld MB in transparent huge pages\n",
+            pages.size_kb >> 10, pages.page_kb, pages.huge_kb >> 10);
+
+    // exact statistics of the stream, unless the truth cache holds them
+    StreamTruth truth;
+    std::vector<long> ranks;
+    if (truth_ranks(quantile, extra_quantiles,
+                    [&](double q) { return (long) (len * (double) (float) q); }, &ranks)) {
+        log(! file_output, "Bad quantile list: %s\n", extra_quantiles);
+        exit(1);
     }
+    if (! source)
+        truth_cache_load(&cache, key, &truth);
+    bool update = false;
+    if (! clip && ! truth.has_range) {
+        StreamStats stats = stream_stats(items, len);
+        truth.min = stats.min;
+        truth.max = stats.max;
+        truth.has_range = true;
+        update = true;
+    }
+    // a public domain takes the place of the range, so the items are read once
+    double smin = clip ? clip_lo : truth.min;
+    double smax = clip ? clip_hi : truth.max;
+    if (clip)
+        log(! file_output, "public domain [%.3f, %.3f]: items outside it are clamped\n", clip_lo, clip_hi);
     // stream range
     double range = smax - smin;
 
@@ -380,40 +313,85 @@ int main(int argc, char **argv)
                 "stream min = %.3f; stream max = %.3f; stream range = %.3f \n", smin,
                 smax, range);
 
-    true_quantile = quickselect(items, len, (long) (len * quantile));
-    log(! file_output, "the true quantile %.2f is %.3f\n", quantile,
-                true_quantile);
-
-    std::uniform_real_distribution<> dis(0.0, 1.0);
+    // with -B, replicas fed Poisson(1) resamples in the same pass (Bootstrap.h)
+    Bootstrapped<Frugal1URR> frugal(Frugal1URR(quantile, eps, prec, seeds.seed2, seeds.seed4), replicas,
+                                    bootstrap_seed(seed, 0), [&](int r) {
+                                        return Frugal1URR(quantile, eps, prec, bootstrap_seed(seeds.seed2, r),
+                                                          bootstrap_seed(seeds.seed4, r));
+                                    });
 
-    // set the estimated quantile to the value of the first item
-    int integer_norm_quantile = (items[0]-smin)/range * prec;
-
-    double p = exp(eps) / (exp(eps) + 1);
-
-    clock_t begin_time = clock();
-    for (long i = 1; i < len; ++i) {
-
-        double norm_item      = (items[i] - smin) / range;
-        int integer_norm_item = norm_item * prec;
-        int s  = randomized_response(integer_norm_quantile, p, integer_norm_item, mtgenerator1);
-
-        float rnd = dis(mtgenerator3);
-        if (s && rnd > 1.0 - quantile)
-            integer_norm_quantile += 1;
-        else if (!s && rnd > quantile)
-            integer_norm_quantile -= 1;
+    if (streaming) {
+        StreamInput in;
+        if (stream_open(&in, source, format))
+            exit(1);
+        len = ldp_stream(frugal, &in, smin, range, every_items, every_ms,
+                         [&](long count) {
+                             fprintf(stdout, "items %ld estimated quantile: %.6f\n", count,
+                                     (double)frugal.integer_norm_quantile / prec * range + smin);
+                             fflush(stdout);
+                         },
+                         &elapsed);
+        stream_close(&in);
+        if (len == 0) {
+            log(! file_output, "Empty input stream\n");
+            exit(1);
+        }
+        log(! file_output, "read %ld items from %s\n", len, source);
+        true_quantile = NAN;
+    } else {
+        elapsed = ldp_run(frugal, storage, items, len, smin, range, clip,
+                            [&]() {
+                                // the estimator is done with the items (or their copy): select in
+                                // place, unless they are the mapped cache file
+                                update |= truth_select(&truth, items, len, ranks,
+                                                       [&](double *v, long n, const long *r, int m, double *out) {
+                                                           if (cached)
+                                                               parallel_multi_select(v, n, r, m, out);
+                                                           else
+                                                               multi_select(v, n, r, m, out);
+                                                       }) > 0;
+                                if (cached)
+                                    dataset_cache_unmap(items, sizeof(double), len);
+                                else
+                                    item_free(items);
+                                items = NULL;
+                            },
+                            &storage_error);
+        if (elapsed < 0) {
+            log(! file_output, "Not enough memory\n");
+            exit(1);
+        }
+        if (! update)
+            log(! file_output, "read the true quantile and range from the truth cache\n");
+        else if (! source)
+            truth_cache_store(&cache, key, truth);
+        true_quantile = truth.ranks[(long) (len * quantile)];
+        log(! file_output, "the true quantile %.2f is %.3f\n", quantile,
+                    true_quantile);
     }
+    log(! file_output, "peak memory %ld MB\n", peak_rss_mb());
+    if (storage != STORE_F64)
+        log(! file_output, "item storage %s: max storage error %g (%g of the range)\n",
+                    storage_name(storage), storage_error, storage_error / range);
 
-    clock_t end_time = clock();
-    elapsed          = (double) (end_time - begin_time) / CLOCKS_PER_SEC;
-
-    free(items), items = NULL;
-    double estimated_quantile = (double)integer_norm_quantile / prec * range + smin;
+    double estimated_quantile = (double)frugal.integer_norm_quantile / prec * range + smin;
     double abs_error          = fabs(estimated_quantile - true_quantile);
     double norm_abs_error     = abs_error / range;
     double relative_error     = abs_error / true_quantile;
 
+    // the replicas of -B are timed apart, in the btime column
+    elapsed -= frugal.replica_seconds;
+
+    // spread of the estimate over the bootstrap replicas
+    char boot_cols[64] = "";
+    if (replicas > 0) {
+        BootstrapSummary boot = bootstrap_summary(frugal, [&](const Frugal1URR &r) { return (double)r.integer_norm_quantile / prec * range + smin; });
+        log(! file_output, "Bootstrap of %d replicas: std %.6f, 95%% interval [%.6f, %.6f], time %.6f\n",
+            replicas, boot.std, boot.lo, boot.hi, frugal.replica_seconds);
+        snprintf(boot_cols, sizeof(boot_cols), ",%.6f,%.6f,%.6f,%.6f", boot.std, boot.lo, boot.hi,
+                 frugal.replica_seconds);
+    }
+
     log(! file_output, "Epsilon: %.2f\n", eps);
     log(! file_output, "Private estimated quantile: %.6f\n", estimated_quantile);
     log(! file_output, "Elapsed time %.6f\n", elapsed);
@@ -422,30 +400,43 @@ int main(int argc, char **argv)
     log(! file_output, "Absolute error: %.6f\n", abs_error);
 
     if (file_output) {
-        fptr = fopen(filename, "w");
-        if (! fptr) {
-            log(1, "Error opening file %s\n", filename);
-            free(filename), filename = NULL;
-            exit(1);
-        }
+        std::string row = ldp_row(len, quantile, eps, diststr, param1, param2, seed,
+                                  estimated_quantile, true_quantile, relative_error,
+                                  abs_error, norm_abs_error, range, smin, smax,
+                                  elapsed) +
+                          boot_cols + "\n";
+
+        if (result_store(filename)) {
+            // a row of a store shared by many runs (ResultStore.h)
+            std::string line = std::string("frugal1u-rr,") + row;
+            if (result_append(filename,
+                              replicas > 0 ? RESULT_LDP_HEADER BOOTSTRAP_HEADER : RESULT_LDP_HEADER,
+                              replicas > 0 ? RESULT_LDP_TYPES BOOTSTRAP_TYPES : RESULT_LDP_TYPES,
+                              line.c_str())) {
+                log(1, "Error writing store %s\n", filename);
+                free(filename), filename = NULL;
+                exit(1);
+            }
+        } else {
+            fptr = fopen(filename, "w");
+            if (! fptr) {
+                log(1, "Error opening file %s\n", filename);
+                free(filename), filename = NULL;
+                exit(1);
+            }
+
+            // writing to csv file the following information:
+            //<n>, <quantile>, <eps>, <distribution>, <param1>, <param2>, <seed>,
+            //<estimated
+            // quantile>, <true quantile>, <relative error>, <absolute error>, <input
+            // range>, <stream min>, <stream max>, <elapsed time>, <updates/s>
+            fprintf(fptr, "n,q,e,d,a,b,s,qv,tqv,re,ae,nae,rg,min,max,time,upd%s\n",
+                    replicas > 0 ? BOOTSTRAP_HEADER : "");
+            fputs(row.c_str(), fptr);
 
-        // writing to csv file the following information:
-        //<n>, <quantile>, <eps>, <distribution>, <param1>, <param2>, <seed>,
-        //<estimated
-        // quantile>, <true quantile>, <relative error>, <absolute error>, <input
-        // range>, <stream min>, <stream max>, <elapsed time>, <updates/s>
-        fprintf(fptr, "n,q,e,d,a,b,s,qv,tqv,re,ae,nae,rg,min,max,time,upd\n");
-        fprintf(fptr,
-                    "%ld,%.2f,%.3f,%s,%.6f,%.6f,%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,"
-                    "%.6f,%.6f,%ld\n",
-                    len, quantile, eps, diststr, param1, param2, seed, estimated_quantile,
-                    true_quantile, relative_error, abs_error, norm_abs_error, range,
-                    smin, smax, elapsed, lround(len / elapsed));
-
-        fclose(fptr);
+            fclose(fptr);
+        }
         free(filename), filename = NULL;
     }
-
-    free(diststr), diststr = NULL;
     return 0;
 }
@@ -0,0 +1,899 @@
+/*
+ * In-process sweep over the LDP estimators, and the central Frugal ones.
+ *
+ * Reads a grid (algorithms, quantiles, epsilons, chunks, distributions,
+ * stream lengths and seeds) and runs every cell of it, writing one result
+ * file with a row per cell. Each stream, identified by distribution, length
+ * and seed, is generated once, its range and true quantiles are found once,
+ * and every algorithm, quantile and epsilon then runs on it in memory.
+ * Streams, seeds and results are those of the binaries run with the same
+ * options, one process per cell (as runall.sh and testfrugal1.py do); the
+ * rows are theirs with the algorithm prepended.
+ *
+ * The LDP binaries share one stream of doubles per distribution, length and
+ * seed. frugal_1u and frugal_2u each draw their own: items scaled by 1000 to
+ * ints, with their own distribution defaults and generators, shared by all
+ * the quantiles, epsilons and (frugal_2u) chunks of the algorithm. The rows
+ * of the central algorithms have their binaries' columns, not those of the
+ * LDP ones: a grid mixing them is written to a .dpqr store (-o, -A), whose
+ * blocks name their own columns, rather than to CSV.
+ *
+ * Streams and cells are tasks of a work-stealing pool (TaskPool.h): the
+ * worker that generates a stream queues its cells, idle workers steal them,
+ * and the next streams are generated while the cells of the previous ones
+ * still run, so that no core waits at the end of a stream. A few streams
+ * are held in memory at a time (-m) and each is freed by its last task.
+ *
+ * A task runs several cells of a stream in one fused pass: it feeds each
+ * block of SWEEP_BLOCK items (-b) to every cell in turn, so the stream is
+ * read from memory once per pass rather than once per cell; each cell keeps
+ * its own estimator and generators (the central ones too: Frugal.h takes
+ * its items a batch at a time, and the release noise is drawn per cell),
+ * and its results do not depend on the blocking. A stream gets one pass per
+ * worker (at most one per cell, -F sets the cells per pass), so that its
+ * passes still spread over the cores.
+ *
+ * With -A, the rows are also aggregated as each stream completes into one
+ * row per cell of the grid over the seeds (ResultAggregate.h: the means,
+ * and the std and confidence interval of nae the analysis notebook uses),
+ * written at the end; the per-seed rows are then written only if -o is
+ * given.
+ *
+ * With -C (or $DPQ_CACHE), every row is also memoised in a directory
+ * (ResultCache.h) under a key of the algorithm and its version, the
+ * parameters and the seed, and the cells found there are not run again: an
+ * interrupted sweep restarted with the same options runs only the cells it
+ * had not finished, and streams whose cells are all cached are not even
+ * generated. The version of an algorithm (alg_versions) is bumped when its
+ * results change, so that only its cells are run again. -R reports how much
+ * of the grid the cache covers, without running anything.
+ *
+ * Grid file: one "key = values" line per dimension, values separated by
+ * commas or blanks, # starts a comment. Keys and defaults (those of the
+ * binaries):
+ *
+ *   alg   = ezq-sw, frugal2u-sw, frugal1u-rr, ldpq,  (the four LDP ones)
+ *           frugal_1u, frugal_2u
+ *   q     = quantiles                                (0.99)
+ *   e     = epsilons                                 (2.0, central: 0.1)
+ *   k     = chunks of frugal_2u, 2 to 32             (4)
+ *   d     = distributions, 1 to 8                    (1)
+ *   n     = stream lengths                           (10000000)
+ *   seeds = seed list, or base:step:count            (1234)
+ *
+ */
+
+#include "Frugal.h"
+#include "ItemBuffer.h"
+#include "LdpKernels.h"
+#include "ParallelSelect.h"
+#include "ResultAggregate.h"
+#include "ResultCache.h"
+#include "ResultStore.h"
+#include "StreamStats.h"
+#include "TaskPool.h"
+#include "Workload.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <getopt.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+enum {
+  ALG_EZQ_SW,
+  ALG_FRUGAL2U_SW,
+  ALG_FRUGAL1U_RR,
+  ALG_LDPQ,
+  ALG_FRUGAL_1U,
+  ALG_FRUGAL_2U,
+  ALGS
+};
+static const char *alg_names[ALGS] = {"ezq-sw", "frugal2u-sw", "frugal1u-rr",
+                                      "ldpq",   "frugal_1u",   "frugal_2u"};
+// Versions of what a memoised row depends on: an algorithm's is bumped when
+// its estimator changes, SWEEP_VERSION when the streams or the rows do.
+#define SWEEP_VERSION 2
+static const int alg_versions[ALGS] = {1, 1, 1, 1, 1, 1};
+
+// The kinds of stream: the doubles the LDP binaries share, and the int items
+// of each central binary. The rows of a kind have its columns.
+enum { STREAM_LDP, STREAM_FRUGAL_1U, STREAM_FRUGAL_2U, STREAM_KINDS };
+static const struct {
+  const char *header;
+  const char *types;
+  const char *keys; // of the aggregate (ResultAggregate.h)
+  const char *measure;
+} stream_rows[STREAM_KINDS] = {
+    {RESULT_LDP_HEADER, RESULT_LDP_TYPES, AGGREGATE_KEYS, AGGREGATE_MEASURE},
+    {RESULT_FRUGAL_1U_HEADER, RESULT_FRUGAL_1U_TYPES, AGGREGATE_KEYS, "lre"},
+    {RESULT_FRUGAL_2U_HEADER, RESULT_FRUGAL_2U_TYPES, AGGREGATE_KEYS ",chunks",
+     "lre"}};
+
+static int alg_stream(int alg) {
+  return (alg == ALG_FRUGAL_1U)   ? STREAM_FRUGAL_1U
+         : (alg == ALG_FRUGAL_2U) ? STREAM_FRUGAL_2U
+                                  : STREAM_LDP;
+}
+
+// the options of the central binaries the grid does not sweep
+static const int central_sensitivity = 2; // of frugal_1u
+static const float central_delta = 0.04;
+static const float central_rho = 0.1;
+
+struct Grid {
+  std::vector<int> algs;
+  // quantiles and epsilons are kept as given, and parsed as each binary
+  // parses its options
+  std::vector<std::string> q;
+  std::vector<std::string> e; // empty: the default of each binary
+  std::vector<long> k;
+  std::vector<long> d;
+  std::vector<long> n;
+  std::vector<long> seeds;
+};
+
+// a generated stream and its exact statistics
+struct Stream {
+  int kind;
+  double *items; // STREAM_LDP
+  int *ints;     // the central kinds: values scaled by 1000
+  long len;
+  long dist;
+  double param1;
+  double param2;
+  long seed;
+  LdpSeeds seeds; // those the LDP binaries derive from seed
+  double smin;
+  double smax;
+  std::map<long, double> truth; // rank -> item
+  // frugal_1u: the generator after the items, which draws the Gaussian and
+  // zCDP noise of the releases
+  std::mt19937 generator;
+};
+
+// items fed to every cell of a pass: 32 KB of doubles, 16 KB of ints
+#define SWEEP_BLOCK 4096
+
+struct Cell {
+  int alg;
+  const char *q;
+  const char *e;
+  long k; // chunks of frugal_2u, 0 for the others
+};
+
+void usage(void) {
+  fprintf(stderr, "Usage:\n");
+  fprintf(stderr, "-g <grid file> the grid to sweep (see the head of ldp-sweep.cpp) default: the binaries' defaults\n");
+  fprintf(stderr, "-o <filename> consolidated results, CSV or a .dpqr store (ResultStore.h) default: stdout\n");
+  fprintf(stderr, "-A <filename> results aggregated over the seeds, CSV or a .dpqr store default: none\n");
+  fprintf(stderr, "-C <directory> memoise the rows in directory and run only the cells not found there default: $DPQ_CACHE\n");
+  fprintf(stderr, "-R report the coverage of the grid by the memoised rows of -C, and exit\n");
+  fprintf(stderr, "-j <threads> cells run at a time default: all cores\n");
+  fprintf(stderr, "-F <cells> cells fed by one pass over a stream default: cells / threads\n");
+  fprintf(stderr, "-b <items> items fed to every cell of a pass at a time default: 4096\n");
+  fprintf(stderr, "-m <streams> streams held in memory at a time default: enough to keep every thread busy\n");
+}
+
+static std::vector<std::string> split(const char *s) {
+  std::vector<std::string> out;
+  std::string cur;
+  for (; *s; s++) {
+    if (*s == ',' || *s == ' ' || *s == '\t' || *s == '\n' || *s == '\r') {
+      if (!cur.empty())
+        out.push_back(cur);
+      cur.clear();
+    } else {
+      cur += *s;
+    }
+  }
+  if (!cur.empty())
+    out.push_back(cur);
+  return out;
+}
+
+static bool parse_long(const std::string &s, long *v) {
+  char *end;
+  *v = strtol(s.c_str(), &end, 10);
+  return end != s.c_str() && *end == '\0';
+}
+
+static bool parse_number(const std::string &s) {
+  char *end;
+  strtod(s.c_str(), &end);
+  return end != s.c_str() && *end == '\0';
+}
+
+// Reads the grid file at path into grid. Returns -1 (with a message on
+// stderr) on a malformed line.
+static int grid_read(const char *path, Grid *grid) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "Error opening grid file %s\n", path);
+    return -1;
+  }
+  char line[4096];
+  int lineno = 0, status = 0;
+  while (status == 0 && fgets(line, sizeof(line), fp)) {
+    lineno++;
+    char *hash = strchr(line, '#');
+    if (hash)
+      *hash = '\0';
+    char *eq = strchr(line, '=');
+    std::vector<std::string> key = split(eq ? (*eq = '\0', line) : line);
+    if (!eq) {
+      if (!key.empty())
+        status = -1;
+      continue;
+    }
+    std::vector<std::string> values = split(eq + 1);
+    if (key.size() != 1 || values.empty()) {
+      status = -1;
+      continue;
+    }
+
+    if (key[0] == "alg") {
+      grid->algs.clear();
+      for (const std::string &v : values) {
+        int a = 0;
+        while (a < ALGS && v != alg_names[a])
+          a++;
+        if (a == ALGS)
+          status = -1;
+        grid->algs.push_back(a);
+      }
+    } else if (key[0] == "q" || key[0] == "e") {
+      for (const std::string &v : values)
+        if (!parse_number(v))
+          status = -1;
+      (key[0] == "q" ? grid->q : grid->e) = values;
+    } else if (key[0] == "d" || key[0] == "n" || key[0] == "k") {
+      std::vector<long> &out =
+          (key[0] == "d") ? grid->d : (key[0] == "n") ? grid->n : grid->k;
+      out.clear();
+      for (const std::string &v : values) {
+        long x;
+        if (!parse_long(v, &x) || x < 1 || (key[0] == "d" && x > 8) ||
+            (key[0] == "k" && (x < 2 || x > 32)))
+          status = -1;
+        out.push_back(x);
+      }
+    } else if (key[0] == "seeds") {
+      long base, step, count;
+      grid->seeds.clear();
+      if (values.size() == 1 &&
+          sscanf(values[0].c_str(), "%ld:%ld:%ld", &base, &step, &count) == 3) {
+        for (long i = 0; i < count; i++)
+          grid->seeds.push_back(base + i * step);
+      } else {
+        for (const std::string &v : values) {
+          long x;
+          if (!parse_long(v, &x))
+            status = -1;
+          grid->seeds.push_back(x);
+        }
+      }
+    } else {
+      status = -1;
+    }
+  }
+  fclose(fp);
+  if (status)
+    fprintf(stderr, "Bad grid file %s, line %d\n", path, lineno);
+  return status;
+}
+
+// the items the binaries generate for dist, param1, param2 and seed
+// (Workload.h): frugal_1u from a mt19937, frugal_2u from a
+// default_random_engine, both seeded with seed
+static void stream_generate(Stream *s) {
+  if (s->kind == STREAM_FRUGAL_1U) {
+    std::mt19937 gen(s->seed);
+    central_generate(s->ints, s->len, s->dist, s->param1, s->param2, gen);
+    s->generator = gen;
+    return;
+  }
+  if (s->kind == STREAM_FRUGAL_2U) {
+    std::default_random_engine gen(s->seed);
+    central_generate(s->ints, s->len, s->dist, s->param1, s->param2, gen);
+    return;
+  }
+
+  s->seeds = ldp_seeds(s->seed);
+  std::mt19937 gen(s->seeds.seed1);
+  ldp_generate(s->items, s->len, s->dist, s->param1, s->param2, gen);
+}
+
+static double thread_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// One cell's estimator, fed the stream a block at a time, with the
+// parameters parsed as the binary of its algorithm parses them and the
+// generators it seeds. Only the estimator of the cell's algorithm is set.
+struct CellRun {
+  const Cell *cell;
+  double quantile;
+  double eps;
+  std::unique_ptr<EasyQuantile> ezq;
+  std::unique_ptr<Frugal2USW> frugal2u;
+  std::unique_ptr<Frugal1URR> frugal1u;
+  std::unique_ptr<LDPQ> ldpq;
+  std::unique_ptr<Frugal1U> frugal_1u;
+  std::unique_ptr<Frugal2U> frugal_2u;
+  double elapsed; // thread CPU seconds in update
+};
+
+static const double prec = 1000000.0;
+
+// an option of a cell as its binary parses it: ezq-sw and frugal2u-sw read
+// the options as doubles, the others as floats
+static double cell_param(const Cell &c, const char *value) {
+  const bool single = (c.alg != ALG_EZQ_SW && c.alg != ALG_FRUGAL2U_SW);
+  return single ? strtof(value, NULL) : strtod(value, NULL);
+}
+
+// the key of the row of a cell on a stream in the result cache
+static std::string cell_key(const Cell &c, const Stream &s) {
+  char key[256], chunks[32] = "";
+  if (c.alg == ALG_FRUGAL_2U)
+    snprintf(chunks, sizeof(chunks), " k=%ld", c.k);
+  snprintf(key, sizeof(key),
+           "ldp-sweep/%d %s/%d q=%a e=%a%s d=%ld a=%a b=%a n=%ld s=%ld",
+           SWEEP_VERSION, alg_names[c.alg], alg_versions[c.alg],
+           cell_param(c, c.q), cell_param(c, c.e), chunks, s.dist, s.param1,
+           s.param2, s.len, s.seed);
+  return key;
+}
+
+static void cell_start(CellRun *r, const Cell &c, const Stream &s) {
+  r->cell = &c;
+  r->quantile = cell_param(c, c.q);
+  r->eps = cell_param(c, c.e);
+  r->elapsed = 0.0;
+
+  // the central binaries seed their estimator with the seed itself
+  if (c.alg == ALG_FRUGAL_1U) {
+    r->frugal_1u.reset(new Frugal1U(r->quantile, s.seed));
+    return;
+  }
+  if (c.alg == ALG_FRUGAL_2U) {
+    r->frugal_2u.reset(new Frugal2U(r->quantile, (int)c.k, s.seed));
+    return;
+  }
+
+  const double quantile = r->quantile, eps = r->eps;
+  double q, l;
+  square_wave_params(eps, &q, &l);
+  if (c.alg == ALG_EZQ_SW)
+    r->ezq.reset(new EasyQuantile(quantile, q, l, ezq_mode(quantile), s.seeds.seed2));
+  else if (c.alg == ALG_FRUGAL2U_SW)
+    r->frugal2u.reset(new Frugal2USW(quantile, q, l, prec, s.seeds.seed2, s.seeds.seed3));
+  else if (c.alg == ALG_FRUGAL1U_RR)
+    r->frugal1u.reset(new Frugal1URR(quantile, eps, prec, s.seeds.seed2, s.seeds.seed4));
+  else
+    r->ldpq.reset(new LDPQ(quantile, eps, s.seeds.seed2, s.seeds.seed3));
+}
+
+// feeds items [i, i + n) of the stream to the cell
+static void cell_update(CellRun *r, const Stream &s, long i, long n,
+                        NormRange norm) {
+  const double *items = s.items + i;
+  const double begin = thread_seconds();
+  if (r->frugal_1u)
+    r->frugal_1u->update(s.ints + i, n);
+  else if (r->frugal_2u)
+    r->frugal_2u->update(s.ints + i, n);
+  else if (r->ezq)
+    r->ezq->update(items, n, norm);
+  else if (r->frugal2u)
+    r->frugal2u->update(items, n, norm);
+  else if (r->frugal1u)
+    r->frugal1u->update(items, n, norm);
+  else
+    r->ldpq->update(items, n, norm);
+  r->elapsed += thread_seconds() - begin;
+}
+
+// The row of a central cell: the estimate and its releases, drawn and
+// written as the binary draws and writes them (Workload.h).
+static std::string central_row(const CellRun &r, const Stream &s) {
+  const Cell &c = *r.cell;
+  const float quantile = r.quantile, epsilon = r.eps;
+  const int true_quantile = (int)s.truth.at((long)(s.len * quantile));
+  std::string row = std::string(alg_names[c.alg]) + ", ";
+
+  if (r.frugal_1u) {
+    std::mt19937 generator = s.generator;
+    const Frugal1URelease dp = frugal_1u_release(
+        r.frugal_1u->estimate, true_quantile, true, central_sensitivity,
+        epsilon, central_delta, central_rho, s.seed, generator);
+    row += frugal_1u_row(s.len, quantile, dist_name(s.dist), s.param1,
+                         s.param2, s.seed, r.frugal_1u->estimate,
+                         true_quantile, true, r.elapsed, central_sensitivity,
+                         epsilon, central_delta, central_rho, dp);
+  } else {
+    // the sensitivity of the chunk average comes from the stream range
+    const int chunks = (int)c.k;
+    const float eq = r.frugal_2u->mean();
+    const Frugal2URelease dp = frugal_2u_release(
+        eq, true_quantile, true, (float)(s.smin / 1000.0),
+        (float)(s.smax / 1000.0), chunks, epsilon, s.seed);
+    row += frugal_2u_row(s.len, quantile, dist_name(s.dist), s.param1,
+                         s.param2, s.seed, eq, true_quantile, true, r.elapsed,
+                         epsilon, chunks, dp);
+  }
+  return row + "\n";
+}
+
+// the CSV row of a cell fed the whole stream, computed as the binary of the
+// algorithm computes it
+static std::string cell_row(const CellRun &r, const Stream &s) {
+  const Cell &c = *r.cell;
+  if (s.kind != STREAM_LDP)
+    return central_row(r, s);
+  const double range = s.smax - s.smin;
+  const double quantile = r.quantile;
+
+  double norm_estimate;
+  if (r.ezq)
+    norm_estimate = r.ezq->norm_quantile;
+  else if (r.frugal2u)
+    norm_estimate = (double)r.frugal2u->integer_norm_quantile / prec;
+  else if (r.frugal1u)
+    norm_estimate = (double)r.frugal1u->integer_norm_quantile / prec;
+  else
+    norm_estimate = r.ldpq->Qn;
+
+  const double true_quantile = s.truth.at((long)(s.len * quantile));
+  const double estimated_quantile = norm_estimate * range + s.smin;
+  const double abs_error = fabs(estimated_quantile - true_quantile);
+  // frugal1u-rr keeps the sign of the true quantile; ldpq writes the
+  // normalised estimate
+  const double relative_error = (c.alg == ALG_FRUGAL1U_RR)
+                                    ? abs_error / true_quantile
+                                    : abs_error / fabs(true_quantile);
+  const double written = (c.alg == ALG_LDPQ) ? norm_estimate : estimated_quantile;
+
+  return std::string(alg_names[c.alg]) + "," +
+         ldp_row(s.len, quantile, r.eps, dist_name(s.dist), s.param1,
+                 s.param2, s.seed, written, true_quantile, relative_error,
+                 abs_error, abs_error / range, range, s.smin, s.smax,
+                 r.elapsed) +
+         "\n";
+}
+
+// A sweep in progress: streams are started in grid order, at most max_live
+// at a time, and their rows are written in that order as they complete.
+struct Sweep {
+  const Grid *grid;
+  std::vector<Cell> cells;
+  std::vector<Stream> streams;
+  std::vector<std::vector<std::string>> rows;
+  std::vector<std::vector<int>> todo; // cells of each stream not cached
+  std::vector<std::atomic<long>> left; // passes of the stream still to run
+  std::vector<char> done;
+  std::mutex lock;
+  long started;
+  long written;
+  int live;
+  int max_live;
+  int passes;  // fused passes per stream
+  long block; // items fed to every cell of a pass at a time
+  FILE *fptr;
+  // per kind of stream: instead of fptr, for a .dpqr output
+  ResultWriter *store[STREAM_KINDS];
+  ResultAggregate *agg[STREAM_KINDS]; // or NULL
+  ResultCache *cache;
+
+  explicit Sweep(long count) : streams(count), rows(count), todo(count),
+                               left(count), done(count, 0), started(0),
+                               written(0), live(0) {}
+};
+
+// writes the rows of every stream completed in order; sw->lock is held
+static void write_completed(Sweep *sw) {
+  for (; sw->written < (long)sw->streams.size() && sw->done[sw->written];
+       sw->written++) {
+    const int kind = sw->streams[sw->written].kind;
+    ResultWriter *store = sw->store[kind];
+    ResultAggregate *agg = sw->agg[kind];
+    for (const std::string &row : sw->rows[sw->written]) {
+      // the cells of the other kinds of stream have no row here
+      if (row.empty())
+        continue;
+      if ((store ? store->append(row.c_str())
+           : sw->fptr ? fputs(row.c_str(), sw->fptr) < 0 : 0) ||
+          (agg && agg->add_csv(row.c_str()))) {
+        fprintf(stderr, "Error writing results\n");
+        exit(1);
+      }
+    }
+    sw->rows[sw->written].clear();
+    sw->rows[sw->written].shrink_to_fit();
+    fprintf(stderr, "#");
+  }
+  for (ResultWriter *store : sw->store)
+    if (store)
+      store->flush();
+  if (sw->fptr)
+    fflush(sw->fptr);
+}
+
+// Task of the worker that generates a stream: its pages are first touched
+// here, and its cells go to this worker's deque, so that they run on this
+// core unless another one runs out of work.
+static void stream_task(Sweep *sw, TaskPool *pool, long k, int worker) {
+  Stream &s = sw->streams[k];
+  const long len = s.len;
+  const bool central = (s.kind != STREAM_LDP);
+  if (central)
+    s.ints = (int *)item_alloc(len * sizeof(int), false);
+  else
+    s.items = (double *)item_alloc(len * sizeof(double), false);
+  if (!s.items && !s.ints) {
+    fprintf(stderr, "Not enough memory\n");
+    exit(1);
+  }
+  stream_generate(&s);
+
+  // the other workers are busy with cells: one thread each
+  StreamStats stats = central ? stream_stats(s.ints, len, 1)
+                              : stream_stats(s.items, len, 1);
+  s.smin = stats.min;
+  s.smax = stats.max;
+
+  // the ranks of every quantile, as the binaries compute them: the LDP ones
+  // in double from a double or a float quantile, the central ones in float
+  std::vector<long> ranks;
+  for (const std::string &q : sw->grid->q) {
+    if (central) {
+      ranks.push_back((long)(len * strtof(q.c_str(), NULL)));
+      continue;
+    }
+    ranks.push_back((long)(len * strtod(q.c_str(), NULL)));
+    ranks.push_back((long)(len * (double)strtof(q.c_str(), NULL)));
+  }
+  std::sort(ranks.begin(), ranks.end());
+  ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+  if (central) {
+    std::vector<int> values(ranks.size());
+    parallel_multi_select(s.ints, len, ranks.data(), (int)ranks.size(),
+                          values.data(), 1);
+    for (size_t i = 0; i < ranks.size(); i++)
+      s.truth[ranks[i]] = values[i];
+  } else {
+    std::vector<double> values(ranks.size());
+    parallel_multi_select(s.items, len, ranks.data(), (int)ranks.size(),
+                          values.data(), 1);
+    for (size_t i = 0; i < ranks.size(); i++)
+      s.truth[ranks[i]] = values[i];
+  }
+
+  // Pass p feeds the cells to run p, p + passes, ... (a mix of algorithms,
+  // quantiles, epsilons and chunks, whose costs differ) one block at a time,
+  // while the block is in cache.
+  // The owner takes its newest task first: push the last pass first.
+  const std::vector<int> &todo = sw->todo[k];
+  const int passes = std::min(sw->passes, (int)todo.size());
+  sw->left[k] = passes;
+  for (int p = passes - 1; p >= 0; p--)
+    pool->push(worker, [sw, k, p, passes](int w) {
+      const Stream &s = sw->streams[k];
+      const std::vector<int> &todo = sw->todo[k];
+      const NormRange norm = {s.smin, 1.0 / (s.smax - s.smin)};
+      std::vector<CellRun> runs;
+      for (size_t j = p; j < todo.size(); j += passes) {
+        runs.emplace_back();
+        cell_start(&runs.back(), sw->cells[todo[j]], s);
+      }
+      for (long i = 0; i < s.len; i += sw->block) {
+        const long m = std::min(sw->block, s.len - i);
+        for (CellRun &r : runs)
+          cell_update(&r, s, i, m, norm);
+      }
+      for (size_t j = 0; j < runs.size(); j++) {
+        const int c = todo[p + j * passes];
+        std::string &row = sw->rows[k][c];
+        row = cell_row(runs[j], s);
+        if (sw->cache->enabled() &&
+            sw->cache->store(cell_key(sw->cells[c], s),
+                             row.substr(0, row.size() - 1))) {
+          fprintf(stderr, "Error writing the result cache\n");
+          exit(1);
+        }
+      }
+      if (--sw->left[k] > 0)
+        return;
+
+      // last pass over the stream: release it, then write every stream
+      // completed in order
+      item_free(sw->streams[k].items ? (void *)sw->streams[k].items
+                                     : (void *)sw->streams[k].ints);
+      sw->streams[k].truth.clear();
+      std::lock_guard<std::mutex> guard(sw->lock);
+      sw->live--;
+      sw->done[k] = 1;
+      write_completed(sw);
+    });
+}
+
+int main(int argc, char **argv) {
+  const char *grid_file = NULL;
+  const char *output = NULL;
+  const char *aggregated = NULL;
+  const char *cache_dir = NULL;
+  bool report = false;
+  int threads = 0;
+  int max_live = 0;
+  int fused = 0;
+  long block = SWEEP_BLOCK;
+  int opt;
+
+  while ((opt = getopt(argc, argv, ":g:o:A:C:Rj:m:F:b:h")) != -1) {
+    switch (opt) {
+    case 'g':
+      grid_file = optarg;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'A':
+      aggregated = optarg;
+      break;
+    case 'C':
+      cache_dir = optarg;
+      break;
+    case 'R':
+      report = true;
+      break;
+    case 'j':
+      threads = strtol(optarg, NULL, 10);
+      break;
+    case 'm':
+      max_live = strtol(optarg, NULL, 10);
+      break;
+    case 'F':
+      fused = strtol(optarg, NULL, 10);
+      break;
+    case 'b':
+      block = strtol(optarg, NULL, 10);
+      break;
+    case 'h':
+      usage();
+      exit(1);
+      break;
+    case '?':
+      fprintf(stderr, "Unknown option: %c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    case ':':
+      fprintf(stderr, "Missing argument for option -%c\n", optopt);
+      usage();
+      exit(1);
+      break;
+    }
+  }
+
+  Grid grid;
+  grid.algs = {ALG_EZQ_SW, ALG_FRUGAL2U_SW, ALG_FRUGAL1U_RR, ALG_LDPQ};
+  grid.q = {"0.99"};
+  grid.k = {4};
+  grid.d = {1};
+  grid.n = {10000000};
+  grid.seeds = {1234};
+  if (grid_file && grid_read(grid_file, &grid))
+    exit(1);
+
+  // the cells of every kind of stream; only frugal_2u has chunks
+  const std::vector<std::string> ldp_eps = {"2.0"}, central_eps = {"0.1"};
+  const std::vector<long> no_chunks = {0};
+  std::vector<Cell> cells;
+  std::vector<int> kind_cells(STREAM_KINDS, 0);
+  for (int a : grid.algs) {
+    const std::vector<std::string> &es =
+        !grid.e.empty() ? grid.e
+        : (alg_stream(a) == STREAM_LDP) ? ldp_eps : central_eps;
+    for (const std::string &q : grid.q)
+      for (const std::string &e : es)
+        for (long chunks : (a == ALG_FRUGAL_2U) ? grid.k : no_chunks) {
+          cells.push_back({a, q.c_str(), e.c_str(), chunks});
+          kind_cells[alg_stream(a)]++;
+        }
+  }
+  std::vector<int> kinds;
+  for (int kind = 0; kind < STREAM_KINDS; kind++)
+    if (kind_cells[kind] > 0)
+      kinds.push_back(kind);
+
+  Sweep sw((long)(grid.d.size() * grid.n.size() * grid.seeds.size() *
+                  kinds.size()));
+  sw.grid = &grid;
+  sw.cells = cells;
+  long k = 0, nrows = 0;
+  for (long dist : grid.d)
+    for (long len : grid.n)
+      for (long seed : grid.seeds)
+        for (int kind : kinds) {
+          Stream &s = sw.streams[k++];
+          s.kind = kind;
+          s.items = NULL;
+          s.ints = NULL;
+          s.len = len;
+          s.dist = dist;
+          if (kind == STREAM_LDP)
+            ldp_dist_defaults(dist, &s.param1, &s.param2);
+          else
+            central_dist_defaults(dist, &s.param1, &s.param2);
+          s.seed = seed;
+          nrows += kind_cells[kind];
+        }
+
+  // the cached rows, and the cells left to run on each stream
+  ResultCache cache;
+  sw.cache = &cache;
+  if (cache.open(cache_dir)) {
+    fprintf(stderr, "Error opening the result cache\n");
+    exit(1);
+  }
+  std::vector<long> cached(ALGS, 0), total(ALGS, 0);
+  for (long k = 0; k < (long)sw.streams.size(); k++) {
+    sw.rows[k].resize(sw.cells.size());
+    for (int c = 0; c < (int)sw.cells.size(); c++) {
+      const int a = sw.cells[c].alg;
+      if (alg_stream(a) != sw.streams[k].kind)
+        continue;
+      total[a]++;
+      if (cache.enabled() &&
+          cache.find(cell_key(sw.cells[c], sw.streams[k]), &sw.rows[k][c])) {
+        sw.rows[k][c] += '\n';
+        cached[a]++;
+      } else {
+        sw.todo[k].push_back(c);
+      }
+    }
+  }
+  if (report) {
+    if (!cache.enabled()) {
+      fprintf(stderr, "No result cache: give -C or set DPQ_CACHE\n");
+      exit(1);
+    }
+    long streams = 0;
+    for (long k = 0; k < (long)sw.streams.size(); k++)
+      streams += sw.todo[k].empty();
+    printf("alg,cached,cells,coverage\n");
+    for (int a : grid.algs)
+      printf("%s,%ld,%ld,%.4f\n", alg_names[a], cached[a], total[a],
+             (double)cached[a] / total[a]);
+    printf("# %ld of %zu streams complete, %ld entries in the cache\n", streams,
+           sw.streams.size(), cache.size());
+    return 0;
+  }
+
+  TaskPool pool(threads);
+  threads = pool.size();
+  // one pass per worker unless -F says otherwise; enough streams to give
+  // every worker a pass, and one more being generated
+  const int ncells = *std::max_element(kind_cells.begin(), kind_cells.end());
+  if (fused <= 0)
+    fused = (ncells + threads - 1) / threads;
+  sw.passes = (ncells + fused - 1) / fused;
+  sw.block = (block > 0) ? block : 1;
+  sw.max_live =
+      (max_live > 0) ? max_live : (threads + sw.passes - 1) / sw.passes + 1;
+
+  // A store gets the rows of every stream as one block, through a writer
+  // per kind of stream: the writers append blocks of their own columns to
+  // the same store. A CSV file has the columns of a single kind.
+  const bool rows_out = output || !aggregated;
+  const bool rows_store = output && result_store(output);
+  if ((rows_out && !rows_store) || (aggregated && !result_store(aggregated))) {
+    if (kinds.size() > 1) {
+      fprintf(stderr, "The rows of the LDP and the central algorithms have "
+                      "different columns: write them to a .dpqr store\n");
+      exit(1);
+    }
+  }
+  ResultWriter stores[STREAM_KINDS];
+  ResultAggregate aggs[STREAM_KINDS];
+  sw.fptr = (rows_store || !rows_out) ? NULL : output ? fopen(output, "w") : stdout;
+  if (rows_out && !rows_store && !sw.fptr) {
+    fprintf(stderr, "Error opening file %s\n", output);
+    exit(1);
+  }
+  for (int kind = 0; kind < STREAM_KINDS; kind++) {
+    sw.store[kind] = NULL;
+    sw.agg[kind] = NULL;
+    if (!kind_cells[kind])
+      continue;
+    std::vector<ResultColumn> columns;
+    result_columns(stream_rows[kind].header, stream_rows[kind].types, &columns);
+    if (rows_store) {
+      sw.store[kind] = &stores[kind];
+      if (stores[kind].open(output, columns)) {
+        fprintf(stderr, "Error opening file %s\n", output);
+        exit(1);
+      }
+    }
+    if (aggregated) {
+      sw.agg[kind] = &aggs[kind];
+      aggs[kind].open(columns, stream_rows[kind].keys, stream_rows[kind].measure);
+    }
+    if (sw.fptr)
+      fprintf(sw.fptr, "%s\n", stream_rows[kind].header);
+  }
+
+  fprintf(stderr,
+          "sweeping %zu cells on %zu streams in up to %d passes of "
+          "%ld-item blocks, with %d threads (%s), %d streams in memory\n",
+          sw.cells.size(), sw.streams.size(), sw.passes, sw.block, threads,
+          (pool.cpu(0) >= 0) ? "pinned" : "unpinned", sw.max_live);
+  if (cache.enabled()) {
+    long hits = 0;
+    for (long c : cached)
+      hits += c;
+    fprintf(stderr, "%ld of %ld rows found in the result cache\n", hits, nrows);
+  }
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  pool.run([&sw, &pool](int worker) {
+    long k;
+    {
+      std::lock_guard<std::mutex> guard(sw.lock);
+      // streams whose rows are all cached are done without generating them
+      while (sw.started < (long)sw.streams.size() &&
+             sw.todo[sw.started].empty()) {
+        sw.done[sw.started++] = 1;
+        write_completed(&sw);
+      }
+      if (sw.started == (long)sw.streams.size() || sw.live >= sw.max_live)
+        return false;
+      k = sw.started++;
+      sw.live++;
+    }
+    pool.push(worker, [&sw, &pool, k](int w) { stream_task(&sw, &pool, k, w); });
+    return true;
+  });
+
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  fprintf(stderr, "\n%ld rows in %.2f s, %ld tasks stolen\n", nrows,
+          (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9,
+          pool.steals());
+  for (ResultWriter *store : sw.store)
+    if (store && store->close()) {
+      fprintf(stderr, "Error writing store %s\n", output);
+      exit(1);
+    }
+  if (sw.fptr && sw.fptr != stdout)
+    fclose(sw.fptr);
+
+  for (ResultAggregate *agg : sw.agg) {
+    if (!agg)
+      continue;
+    ResultTable cells;
+    agg->result(&cells);
+    FILE *fp = NULL;
+    if (result_store(aggregated) ? result_write(aggregated, cells, 0, cells.rows)
+                                 : !(fp = fopen(aggregated, "w")) ||
+                                       result_csv(fp, cells)) {
+      fprintf(stderr, "Error writing file %s\n", aggregated);
+      exit(1);
+    }
+    if (fp)
+      fclose(fp);
+  }
+  return 0;
+}
@@ -41,6 +41,16 @@ def print_to_stderr(msg):
     sys.stderr.flush()
     return
 
+def run(args, outputfile):
+    # An output holding its header and row, written since the binary was
+    # last built, is kept: an interrupted sweep resumes where it stopped,
+    # and rebuilding an algorithm re-runs its own sweep only.
+    if os.path.exists(outputfile) and os.path.getmtime(outputfile) >= os.path.getmtime(exec_name):
+        with open(outputfile) as f:
+            if len(f.read().splitlines()) >= 2:
+                return
+    sbc.run([exec_name] + args + ["-f", outputfile])
+
 def test_on_q(outdir):
     for q in q_values:
         outputdir = outdir + "/test_q_" + str(q)
@@ -52,7 +62,7 @@ def test_on_q(outdir):
                 rep = 1
                 for seed in range(s_base, s_base + (reps * s_step), s_step):
                     outputfile = f"{outputdir}/test_q_{q}_e_{e}_d_{d}_{rep}.csv"
-                    sbc.run([exec_name, "-n", n_default, "-q" , q, "-d", d, "-e", e, "-f", outputfile, "-s", str(seed)])
+                    run(["-n", n_default, "-q" , q, "-Q", ",".join(q_values), "-d", d, "-e", e, "-s", str(seed)], outputfile)
 
                     rep = rep + 1
                     print_to_stderr("#")
@@ -73,7 +83,7 @@ def test_on_n(outdir):
         for seed in range(s_base, s_base + (reps * s_step), s_step):
             for e in e_default:
                 outputfile = f"{outputdir}/test_n_{n}_e_{e}_{rep}.csv"
-                sbc.run([exec_name, "-n", n, "-q" , q_default, "-d", d_default, "-e", e, "-f", outputfile, "-s", str(seed)])
+                run(["-n", n, "-q" , q_default, "-d", d_default, "-e", e, "-s", str(seed)], outputfile)
             
             rep = rep + 1
             print_to_stderr("#")
@@ -94,7 +104,7 @@ def test_on_d(outdir):
         for seed in range(s_base, s_base + (reps * s_step), s_step):
             for e in e_default:
                 outputfile = f"{outputdir}/test_d_{d}_e_{e}_{rep}.csv"
-                sbc.run([exec_name, "-n", n_default, "-q" , q_default, "-d", d, "-e", e, "-f", outputfile, "-s", str(seed)])
+                run(["-n", n_default, "-q" , q_default, "-d", d, "-e", e, "-s", str(seed)], outputfile)
             
             rep = rep + 1
             print_to_stderr("#")
@@ -113,7 +123,7 @@ def test_on_e(outdir):
         rep = 1
         for seed in range(s_base, s_base + (reps * s_step), s_step):
             outputfile = outputdir + "/test_e_" + str(e) + "_" + str(rep) + ".csv"
-            sbc.run([exec_name, "-n", n_default, "-q" , q_default, "-d", d_default, "-e", e, "-f", outputfile, "-s", str(seed)])
+            run(["-n", n_default, "-q" , q_default, "-d", d_default, "-e", e, "-s", str(seed)], outputfile)
             
             rep = rep + 1
             print_to_stderr("#")